@@ -0,0 +1,115 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    bin_frame.h
+  * @brief   Compact binary telemetry frame encoder
+  ******************************************************************************
+  *
+  * Frame layout (multi-byte header fields little-endian):
+  *
+  *   off size field
+  *     0   2  magic 'E','F'
+  *     2   1  version (BIN_FRAME_VERSION)
+  *     3   1  channel count N
+  *     4   4  device id
+  *     8   4  frame sequence number
+  *    12   4  base timestamp (ms, tick of the first sample)
+  *    16   2  sample count
+  *    18   2  boot id (differs from the previous boot's, so a receiver
+  *              can tell a restarted sequence from a replayed one)
+  *    20   .. samples, by version:
+  *              1: varint(t - prev_t), then N x zigzag varint(v - prev_v)
+  *                 (prev_t starts at base timestamp, prev_v at 0)
+  *              2: ts_codec.h bit stream (delta-of-delta timestamps,
+  *                 bucketed zigzag value deltas), zero-padded to a byte
+  *   end   2  CRC-16/CCITT-FALSE over all preceding bytes
+  *
+  * Decoded by server/bin_frame.js.
+  */
+
+#ifndef BIN_FRAME_H
+#define BIN_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "ts_codec.h"
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define BIN_FRAME_VERSION_VARINT    1
+#define BIN_FRAME_VERSION_TS_CODEC  2
+
+/* Sample encoding written by bin_frame_begin(); the server decodes both */
+#ifndef BIN_FRAME_VERSION
+#define BIN_FRAME_VERSION       BIN_FRAME_VERSION_TS_CODEC
+#endif
+
+#define BIN_FRAME_HEADER_SIZE   20
+#define BIN_FRAME_CRC_SIZE      2
+#define BIN_FRAME_MAX_CHANNELS  16
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint8_t *buffer;                         // Output buffer
+    uint16_t size;                           // Buffer size
+    uint16_t pos;                            // Current position
+    uint16_t count;                          // Samples written
+    uint8_t  channels;                       // Values per sample
+    uint32_t prev_t;                         // Previous timestamp
+    int32_t  prev[BIN_FRAME_MAX_CHANNELS];   // Previous value per channel
+#if BIN_FRAME_VERSION == BIN_FRAME_VERSION_TS_CODEC
+    ts_encoder_t ts;                         // Sample bit stream after the header
+#endif
+} bin_frame_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Start a frame and write its header
+  * @param  bf: Frame handle
+  * @param  buf: Output buffer
+  * @param  buf_size: Buffer size
+  * @param  device_id: Device identifier
+  * @param  boot_id: Boot identifier
+  * @param  seq: Frame sequence number
+  * @param  base_t: Timestamp of the first sample (ms)
+  * @param  channels: Values per sample (1..BIN_FRAME_MAX_CHANNELS)
+  * @retval 0 on success, -1 on buffer overflow or bad arguments
+  */
+int bin_frame_begin(bin_frame_t *bf, uint8_t *buf, uint16_t buf_size,
+                    uint32_t device_id, uint16_t boot_id, uint32_t seq, uint32_t base_t,
+                    uint8_t channels);
+
+/**
+  * @brief  Append one sample (timestamp plus one value per channel)
+  * @param  bf: Frame handle
+  * @param  t: Sample timestamp (ms)
+  * @param  values: Array of bf->channels values
+  * @retval 0 on success, -1 on buffer overflow (frame left unchanged)
+  */
+int bin_frame_add(bin_frame_t *bf, uint32_t t, const int32_t *values);
+
+/**
+  * @brief  Patch the sample count and append the CRC
+  * @note   Never overflows: CRC space is reserved by bin_frame_begin()
+  * @param  bf: Frame handle
+  * @retval Total frame length
+  */
+int bin_frame_end(bin_frame_t *bf);
+
+/**
+  * @brief  CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+  * @param  data: Input bytes
+  * @param  len: Number of bytes
+  * @retval CRC value
+  */
+uint16_t bin_frame_crc16(const uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BIN_FRAME_H */
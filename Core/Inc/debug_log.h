@@ -0,0 +1,71 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    debug_log.h
+  * @brief   Non-blocking debug output: ring buffer drained by UART TX DMA
+  ******************************************************************************
+  *
+  * debug_log_write() only copies into the ring and, if the UART is idle,
+  * starts a DMA transfer of the contiguous pending chunk. The TX complete
+  * interrupt advances the ring and chains the next chunk. When the ring is
+  * full the whole write is dropped and counted; callers never wait.
+  */
+
+#ifndef DEBUG_LOG_H
+#define DEBUG_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DEBUG_LOG_BUF_SIZE  2048   // Must be a power of two
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach the log to a UART whose TX is linked to a DMA stream
+  * @note   Output written before this call is kept and sent now.
+  * @param  huart: UART handle (hdmatx must be set up by the MSP)
+  * @retval None
+  */
+void debug_log_init(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  Queue bytes for output
+  * @param  data: Bytes to send
+  * @param  len: Number of bytes
+  * @retval 0 if queued, -1 if dropped because the ring is full
+  */
+int debug_log_write(const uint8_t *data, uint16_t len);
+
+/**
+  * @brief  Chain the next DMA chunk; call from HAL_UART_TxCpltCallback()
+  * @param  huart: UART handle that completed
+  * @retval None
+  */
+void debug_log_tx_complete(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  Recover from a TX DMA error; call from HAL_UART_ErrorCallback()
+  * @note   The chunk in flight is discarded.
+  * @param  huart: UART handle that reported the error
+  * @retval None
+  */
+void debug_log_error(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  Number of writes dropped because the ring was full
+  * @retval Drop count
+  */
+uint32_t debug_log_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEBUG_LOG_H */
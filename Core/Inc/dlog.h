@@ -0,0 +1,72 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    dlog.h
+  * @brief   Deferred binary logging: format on the host, not on the MCU
+  ******************************************************************************
+  *
+  * DLOG(fmt, ...) keeps the format string in the .dlog_fmt ELF section,
+  * which the linker script marks INFO (never loaded to flash), and emits
+  * only its offset plus the raw arguments into the debug log ring:
+  *
+  *   0xDB | id (u16 LE) | nargs (u8) | args (u32 LE each) | xor of id..args
+  *
+  * tools/dlog_decode.js reads the format table from the ELF and turns a
+  * capture of the debug UART back into text; plain printf output on the
+  * same UART passes through unchanged.
+  *
+  * Arguments must be integers (cast pointers); %s is not supported.
+  */
+
+#ifndef DLOG_H
+#define DLOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* 1 = DLOG() emits binary records; 0 = DLOG() is plain printf */
+#ifndef DLOG_DEFERRED
+#define DLOG_DEFERRED   1
+#endif
+
+#define DLOG_SYNC       0xDBU
+#define DLOG_MAX_ARGS   8
+
+/* Exported macros -----------------------------------------------------------*/
+#if DLOG_DEFERRED
+#define DLOG(fmt, ...)                                                          \
+    do {                                                                        \
+        static const char dlog_fmt_[]                                           \
+            __attribute__((section(".dlog_fmt"), used)) = fmt;                  \
+        const uint32_t dlog_args_[] = { 0, ##__VA_ARGS__ };                     \
+        _Static_assert(sizeof(dlog_args_) <= (DLOG_MAX_ARGS + 1) * 4,           \
+                       "DLOG: too many arguments");                            \
+        dlog_write((uint16_t)(uintptr_t)dlog_fmt_, &dlog_args_[1],              \
+                   (uint8_t)(sizeof(dlog_args_) / 4 - 1));                      \
+    } while (0)
+#else
+#define DLOG(fmt, ...)  printf(fmt, ##__VA_ARGS__)
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Emit one deferred log record (use the DLOG macro instead)
+  * @param  id: Offset of the format string in .dlog_fmt
+  * @param  args: Raw arguments
+  * @param  nargs: Number of arguments (<= DLOG_MAX_ARGS)
+  * @retval None
+  */
+void dlog_write(uint16_t id, const uint32_t *args, uint8_t nargs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLOG_H */
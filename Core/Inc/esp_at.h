@@ -24,7 +24,8 @@ typedef enum {
     ESP_AT_OK = 0,
     ESP_AT_ERROR,
     ESP_AT_TIMEOUT,
-    ESP_AT_BUSY
+    ESP_AT_BUSY,
+    ESP_AT_HTTP_ERROR      // Delivered, but the server answered non-2xx
 } esp_at_status_t;
 
 typedef enum {
@@ -37,21 +38,150 @@ typedef enum {
     ESP_STATE_ERROR
 } esp_state_t;
 
+/**
+  * @brief  Completion callback for queued (asynchronous) AT commands
+  * @param  status: Final status of the command
+  * @param  response: Raw response text received for the command
+  * @param  ctx: User context passed at enqueue time
+  */
+typedef void (*esp_at_cmd_cb_t)(esp_at_status_t status, const char *response, void *ctx);
+
+/* Streamed request body: fill buf with the next 1..size bytes and return how
+ * many, or -1 on failure. Called from esp_at_poll() as the UART drains. */
+typedef int (*esp_at_body_fn_t)(uint8_t *buf, uint16_t size, void *ctx);
+
+/* Boot stage timestamps (HAL ticks, ms since MCU reset; 0 = not reached) */
+typedef struct {
+    uint32_t start;        // esp_at_init() / esp_at_reset()
+    uint32_t ready;        // "ready", or the first AT reply from a running module
+    uint32_t got_ip;       // "WIFI GOT IP" (auto-connect or AT+CWJAP)
+    uint32_t link_up;      // First TCP/UDP link established
+    uint32_t first_send;   // First HTTP post answered (UDP datagrams do not count)
+} esp_at_boot_times_t;
+
+/* HTTP responses parsed from "+IPD" data (raw data in passthrough) */
+typedef struct {
+    uint16_t last_status;     // Status code of the latest response, 0 = none yet
+    uint32_t last_rtt_ms;     // Request handed to the UART -> status line received
+    uint32_t retry_after_ms;  // Retry-After / X-Retry-After-Ms of the latest response, 0 = none
+    uint32_t responses;       // Responses parsed
+    uint32_t status_2xx;
+    uint32_t status_4xx;
+    uint32_t status_5xx;
+    uint32_t throttled;       // 429 / 503, or any response carrying a retry delay
+    uint32_t timeouts;        // Posts that got no response within the timeout
+} esp_at_http_stats_t;
+
 /* Exported constants --------------------------------------------------------*/
 #define ESP_AT_RX_BUFFER_SIZE  512
 #define ESP_AT_TX_BUFFER_SIZE  256
 #define ESP_AT_RESPONSE_TIMEOUT_MS  5000
 #define ESP_AT_WIFI_TIMEOUT_MS      15000
 
+#define ESP_AT_RX_RING_SIZE    512   // Must be a power of two; ~5 ms of RX at 921600
+#define ESP_AT_CMD_QUEUE_LEN   8
+#define ESP_AT_CMD_MAX_LEN     128
+#define ESP_AT_HTTP_BUFFER_SIZE 2048  // Batched posts; ESP-AT CIPSEND limit is 2048
+#ifndef ESP_AT_HTTP_HEADER_RESERVE
+#define ESP_AT_HTTP_HEADER_RESERVE 176 // Request line + headers, framed in front of the body
+#endif
+#define ESP_AT_HTTP_BODY_MAX   (ESP_AT_HTTP_BUFFER_SIZE - ESP_AT_HTTP_HEADER_RESERVE)
+#ifndef ESP_AT_HTTP_CHUNK_SIZE
+#define ESP_AT_HTTP_CHUNK_SIZE 256    // Streamed body: bytes pulled per UART transfer
+#endif
+
+#define ESP_AT_ESCAPE_GUARD_MS 50     // Idle line before "+++" (ESP-AT needs >= 20 ms)
+#define ESP_AT_ESCAPE_EXIT_MS  1000   // Idle line after "+++" before the next command
+
+/* Link rate negotiated at bring-up (esp_at_init*) with AT+UART_CUR (0 keeps the
+ * CubeMX rate). Not persistent on the module: AT+RST returns it to the
+ * CubeMX rate, and esp_at_reset() negotiates again. */
+#ifndef ESP_AT_LINK_BAUD
+#define ESP_AT_LINK_BAUD       921600
+#endif
+#ifndef ESP_AT_LINK_FLOW_CTRL
+#define ESP_AT_LINK_FLOW_CTRL  1      // RTS/CTS (PB14/PB13); retried without it on failure
+#endif
+#define ESP_AT_BAUD_TIMEOUT_MS 500    // Per command while probing/verifying a rate
+#define ESP_AT_BAUD_SWITCH_MS  20     // Module applies the new rate after its "OK"
+#define ESP_AT_BAUD_VERIFY_ROUNDS 2   // AT + AT+GMR round trips that must all pass
+
+/* Boot and join. The module announces itself with "ready" and, with an AP
+ * stored by an earlier AT+CWJAP and auto-connect on, rejoins by itself and
+ * prints "WIFI GOT IP"; both are picked up from the RX stream instead of
+ * waiting fixed delays. */
+#ifndef ESP_AT_BOOT_TIMEOUT_MS
+#define ESP_AT_BOOT_TIMEOUT_MS 1500   // Power-on / AT+RST until "ready"
+#endif
+#define ESP_AT_READY_PROBE_MS  50     // "AT" probe period while waiting for boot
+#ifndef ESP_AT_AUTOCONN
+#define ESP_AT_AUTOCONN        1      // Keep the AP stored and auto-connect on (AT+CWAUTOCONN=1)
+#endif
+#define ESP_AT_AUTOCONN_WAIT_MS 5000  // Stored-AP rejoin in progress: wait this long before AT+CWJAP
+
+/* HTTP posts complete once the server's status line and headers have
+ * arrived, not on SEND OK, so errors and Retry-After reach the caller.
+ * 0 restores completion on SEND OK (responses are still parsed). */
+#ifndef ESP_AT_HTTP_WAIT_RESPONSE
+#define ESP_AT_HTTP_WAIT_RESPONSE 1
+#endif
+#define ESP_AT_HTTP_RESPONSE_TIMEOUT_MS 3000  // SEND OK -> response headers
+
 /* Exported functions --------------------------------------------------------*/
 
 /**
-  * @brief  Initialize ESP-AT module
+  * @brief  Initialize ESP-AT module without blocking
+  * @note   Starts interrupt-driven reception; see esp_at_uart_rx_callback().
+  *         esp_at_poll() then waits for the module ("ready" or an AT reply,
+  *         at most ESP_AT_BOOT_TIMEOUT_MS), asks whether it still holds an
+  *         IP, and with ESP_AT_LINK_BAUD set switches the link to that rate;
+  *         if the module does not answer or the new rate fails verification,
+  *         the CubeMX rate is kept. esp_at_is_busy() stays true and queueing
+  *         functions return ESP_AT_BUSY until then.
+  * @param  huart: UART handle for ESP32 communication
+  * @retval esp_at_status_t
+  */
+esp_at_status_t esp_at_init_async(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  Initialize ESP-AT module, blocking until the bring-up described
+  *         for esp_at_init_async() is done
   * @param  huart: UART handle for ESP32 communication
   * @retval esp_at_status_t
   */
 esp_at_status_t esp_at_init(UART_HandleTypeDef *huart);
 
+/**
+  * @brief  Switch module and UART to a new rate (AT+UART_CUR), blocking
+  * @note   The new rate is verified with AT / AT+GMR round trips; on failure
+  *         the previous rate is restored on both ends. Only call while the
+  *         asynchronous engine is idle.
+  * @param  baud: New rate
+  * @param  flow_ctrl: true to enable RTS/CTS hardware flow control
+  * @retval ESP_AT_OK on the new rate, ESP_AT_ERROR if still on the old one,
+  *         ESP_AT_BUSY if commands are in flight
+  */
+esp_at_status_t esp_at_set_baud(uint32_t baud, bool flow_ctrl);
+
+/**
+  * @brief  Current link rate
+  * @retval Baud rate of the ESP UART
+  */
+uint32_t esp_at_get_baud(void);
+
+/**
+  * @brief  Whether the module currently holds an IP ("WIFI GOT IP" seen,
+  *         no "WIFI DISCONNECT" since)
+  * @retval true if joined
+  */
+bool esp_at_wifi_has_ip(void);
+
+/**
+  * @brief  Boot stage timestamps since the last esp_at_init() / esp_at_reset()
+  * @retval Pointer to the internal record
+  */
+const esp_at_boot_times_t *esp_at_get_boot_times(void);
+
 /**
   * @brief  Send AT command and wait for response
   * @param  cmd: AT command string (without \r\n)
@@ -77,6 +207,8 @@ esp_at_status_t esp_at_test(void);
 
 /**
   * @brief  Reset ESP32 (AT+RST)
+  * @note   Returns as soon as the module prints "ready" (probes with AT only
+  *         if it never does), then renegotiates ESP_AT_LINK_BAUD
   * @retval esp_at_status_t
   */
 esp_at_status_t esp_at_reset(void);
@@ -89,6 +221,7 @@ esp_at_status_t esp_at_set_wifi_mode(void);
 
 /**
   * @brief  Connect to Wi‑Fi network
+  * @note   Returns at once if the module already reported "WIFI GOT IP"
   * @param  ssid: Wi‑Fi SSID
   * @param  password: Wi‑Fi password
   * @retval esp_at_status_t
@@ -105,10 +238,11 @@ esp_at_status_t esp_at_connect_tcp(const char *server_ip, uint16_t port);
 
 /**
   * @brief  Send HTTP POST request
+  * @note   Waits for the response like the asynchronous post
   * @param  endpoint: HTTP endpoint (e.g., "/api/energy")
-  * @param  json_data: JSON payload
+  * @param  json_data: JSON payload, copied unless it is the body buffer
   * @param  json_len: JSON payload length
-  * @retval esp_at_status_t
+  * @retval esp_at_status_t (ESP_AT_HTTP_ERROR for a non-2xx status)
   */
 esp_at_status_t esp_at_send_http_post(const char *endpoint, const char *json_data, uint16_t json_len);
 
@@ -132,6 +266,231 @@ esp_state_t esp_at_get_state(void);
   */
 esp_at_status_t esp_at_init_wifi(const char *ssid, const char *password);
 
+/* Asynchronous command engine ----------------------------------------------*/
+
+/**
+  * @brief  UART RX complete hook, call from HAL_UART_RxCpltCallback()
+  * @param  huart: UART handle that completed reception
+  * @retval None
+  */
+void esp_at_uart_rx_callback(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  UART error hook, call from HAL_UART_ErrorCallback()
+  * @param  huart: UART handle that reported the error
+  * @retval None
+  */
+void esp_at_uart_error_callback(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  Queue an AT command without waiting for its response
+  * @param  cmd: AT command string (without \r\n), copied into the queue
+  * @param  expected_response: Expected response string (NULL for "OK")
+  * @param  timeout_ms: Timeout in milliseconds, counted from transmission
+  * @param  cb: Completion callback (may be NULL)
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if the queue is full
+  */
+esp_at_status_t esp_at_enqueue_cmd(const char *cmd, const char *expected_response,
+                                   uint32_t timeout_ms, esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Queue the Wi‑Fi join
+  * @note   Asks AT+CWSTATE? first: already joined completes at once, a
+  *         stored-AP rejoin in progress is waited for ("WIFI GOT IP", up to
+  *         ESP_AT_AUTOCONN_WAIT_MS), otherwise CWMODE, CWAUTOCONN and CWJAP
+  *         are sent (CWJAP stores the AP for the next boot)
+  * @param  ssid: Wi‑Fi SSID
+  * @param  password: Wi‑Fi password
+  * @param  cb: Called once, after the last step or the first failure
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if the queue is full
+  */
+esp_at_status_t esp_at_init_wifi_async(const char *ssid, const char *password,
+                                       esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Queue a TCP connection to the server
+  * @param  server_ip: Server IP address
+  * @param  port: Server port
+  * @param  cb: Completion callback (may be NULL)
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if the queue is full
+  */
+esp_at_status_t esp_at_connect_tcp_async(const char *server_ip, uint16_t port,
+                                         esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Queue a UDP "connection" (fixed remote peer) for datagram telemetry
+  * @param  server_ip: Server IP address
+  * @param  port: Server UDP port
+  * @param  local_port: Local UDP port
+  * @param  cb: Completion callback (may be NULL)
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if the queue is full
+  */
+esp_at_status_t esp_at_connect_udp_async(const char *server_ip, uint16_t port, uint16_t local_port,
+                                         esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Queue raw data on the open link (one UDP datagram per call)
+  * @param  data: Bytes to send, copied into the internal request buffer
+  * @param  len: Number of bytes
+  * @param  cb: Completion callback, called on SEND OK or failure
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if a send is already in flight
+  */
+esp_at_status_t esp_at_send_data_async(const uint8_t *data, uint16_t len,
+                                       esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Borrow the body region of the request buffer
+  * @note   Serializing a payload here and passing this pointer to one of the
+  *         send functions skips the body copy: the request line and headers
+  *         are framed backwards into the ESP_AT_HTTP_HEADER_RESERVE bytes in
+  *         front of it once Content-Length is known (raw sends go out as is).
+  *         The region belongs to the caller until that send is queued.
+  * @param  capacity: Receives the usable body size
+  * @retval Body region, or NULL while an earlier send still owns the buffer
+  */
+uint8_t *esp_at_http_body_buffer(uint16_t *capacity);
+
+/**
+  * @brief  Name this board in every HTTP POST (X-Device-Id header)
+  * @note   The server keys its per-device state by this id. The string is
+  *         not copied and must stay valid; NULL drops the header.
+  * @param  id: Device id, [A-Za-z0-9_-], at most 64 characters
+  * @retval None
+  */
+void esp_at_set_http_device_id(const char *id);
+
+/**
+  * @brief  Tag every HTTP POST with this boot (X-Boot-Id header)
+  * @note   A change tells the server that record seq numbering may have
+  *         restarted. The string is not copied and must stay valid; NULL
+  *         drops the header.
+  * @param  id: Boot id, decimal 0..65535 (the binary frame boot id)
+  * @retval None
+  */
+void esp_at_set_http_boot_id(const char *id);
+
+/**
+  * @brief  Queue an HTTP POST request (CIPSEND handshake driven by esp_at_poll)
+  * @note   With ESP_AT_HTTP_WAIT_RESPONSE the callback gets ESP_AT_OK for a
+  *         2xx response, ESP_AT_HTTP_ERROR for any other status (see
+  *         esp_at_get_http_stats()) and ESP_AT_TIMEOUT if none arrives.
+  * @param  endpoint: HTTP endpoint (e.g., "/api/energy")
+  * @param  json_data: JSON payload, copied unless it is the body buffer
+  * @param  json_len: JSON payload length
+  * @param  cb: Completion callback, called on the response or failure
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if a post is already in flight
+  */
+esp_at_status_t esp_at_send_http_post_async(const char *endpoint, const char *json_data,
+                                            uint16_t json_len, esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Queue an HTTP POST with a binary (application/octet-stream) body
+  * @param  endpoint: HTTP endpoint (e.g., "/api/energy/bin")
+  * @param  data: Body bytes, copied unless they are the body buffer
+  * @param  len: Body length
+  * @param  cb: Completion callback, as for esp_at_send_http_post_async()
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if a post is already in flight
+  */
+esp_at_status_t esp_at_send_http_post_bin_async(const char *endpoint, const uint8_t *data,
+                                                uint16_t len, esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Queue an HTTP POST whose body is produced while it is sent
+  * @note   Only the headers go through the request buffer. After the "> "
+  *         prompt the body is pulled from body_fn up to ESP_AT_HTTP_CHUNK_SIZE
+  *         bytes at a time, each chunk going out while the next is built, so
+  *         the body never exists in RAM as a whole. body_fn must deliver
+  *         exactly body_len bytes; if it fails, the rest is sent as spaces
+  *         (the module expects the announced length) and the post completes
+  *         with ESP_AT_ERROR.
+  * @param  endpoint: HTTP endpoint (e.g., "/api/energy")
+  * @param  content_type: Content-Type header value
+  * @param  body_len: Exact body length, at most ESP_AT_HTTP_BODY_MAX
+  * @param  body_fn: Body producer
+  * @param  body_ctx: Passed to body_fn
+  * @param  cb: Completion callback, as for esp_at_send_http_post_async()
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_BUSY if a post is already in flight
+  */
+esp_at_status_t esp_at_send_http_post_stream_async(const char *endpoint, const char *content_type,
+                                                   uint16_t body_len, esp_at_body_fn_t body_fn,
+                                                   void *body_ctx, esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  HTTP response counters and the latest status / RTT / retry delay
+  * @note   Passthrough posts complete when handed to the UART; their
+  *         responses only show up here (compare the responses counter).
+  * @retval Pointer to the internal record
+  */
+const esp_at_http_stats_t *esp_at_get_http_stats(void);
+
+/**
+  * @brief  Advance the asynchronous engine; never waits
+  * @note   Call periodically from the scheduler
+  * @retval None
+  */
+void esp_at_poll(void);
+
+/**
+  * @brief  Check whether queued commands are pending or in flight, or the
+  *         bring-up is still running
+  * @retval true if the asynchronous engine is busy
+  */
+bool esp_at_is_busy(void);
+
+/* Transparent transmission (passthrough) ------------------------------------*/
+
+/**
+  * @brief  Queue AT+CIPMODE=1 + AT+CIPSEND to turn the TCP link into a raw pipe
+  * @note   Requires ESP_STATE_TCP_CONNECTED. While active, AT commands are
+  *         refused with ESP_AT_BUSY until esp_at_exit_passthrough_async().
+  * @param  cb: Called once the ">" prompt arrives, or on failure
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued
+  */
+esp_at_status_t esp_at_enter_passthrough_async(esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Queue the "+++" escape (with guard times) and AT+CIPMODE=0
+  * @param  cb: Called once AT commands are accepted again, or on failure
+  * @param  ctx: User context passed to the callback
+  * @retval ESP_AT_OK if queued, ESP_AT_ERROR if not in passthrough
+  */
+esp_at_status_t esp_at_exit_passthrough_async(esp_at_cmd_cb_t cb, void *ctx);
+
+/**
+  * @brief  Stream raw bytes into the passthrough pipe (no CIPSEND handshake)
+  * @note   Data is copied; transmission continues in the background.
+  * @param  data: Bytes to send
+  * @param  len: Number of bytes (up to ESP_AT_HTTP_BUFFER_SIZE)
+  * @retval ESP_AT_OK if started, ESP_AT_BUSY if not in passthrough or TX busy
+  */
+esp_at_status_t esp_at_passthrough_send(const uint8_t *data, uint16_t len);
+
+/**
+  * @brief  Stream a complete HTTP POST into the passthrough pipe
+  * @param  endpoint: HTTP endpoint
+  * @param  content_type: Content-Type header value
+  * @param  body: Request body (may be binary), copied unless it is the body buffer
+  * @param  body_len: Body length
+  * @retval ESP_AT_OK if started, ESP_AT_BUSY if not in passthrough or TX busy
+  */
+esp_at_status_t esp_at_passthrough_send_http_post(const char *endpoint, const char *content_type,
+                                                  const uint8_t *body, uint16_t body_len);
+
+/**
+  * @brief  Check whether transparent transmission is active
+  * @retval true in passthrough mode
+  */
+bool esp_at_in_passthrough(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -17,6 +17,20 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Exported constants --------------------------------------------------------*/
+#define JSON_UINT_MAX_LEN        10   // "4294967295"
+#define JSON_INT_MAX_LEN         11   // "-2147483648"
+#define JSON_FIXED_MAX_DECIMALS  9
+#define JSON_FIXED_MAX_LEN       12   // "-2.147483648"
+#ifndef JSON_TEMPLATE_MAX_SLOTS
+#define JSON_TEMPLATE_MAX_SLOTS  8
+#endif
+#ifndef JSON_TEMPLATE_TEXT_MAX
+#define JSON_TEMPLATE_TEXT_MAX   96   // All keys, quotes, colons and commas (<= 255)
+#endif
+#define JSON_TEMPLATE_RENDER_MAX (JSON_TEMPLATE_TEXT_MAX + JSON_TEMPLATE_MAX_SLOTS * JSON_FIXED_MAX_LEN)
+#define JSON_STREAM_MAX_DEPTH    16   // Nested objects/arrays
+
 /* Exported types ------------------------------------------------------------*/
 typedef struct {
     char *buffer;      // Output buffer
@@ -25,6 +39,46 @@ typedef struct {
     uint8_t first;     // First field flag (for comma handling)
 } json_builder_t;
 
+/* Value slot of a template */
+typedef enum {
+    JSON_SLOT_UINT = 0,
+    JSON_SLOT_INT,
+    JSON_SLOT_BOOL,
+    JSON_SLOT_FIXED    // int32_t scaled by 10^decimals
+} json_slot_type_t;
+
+/* Flat object with a fixed key set, prepared once: the literal text between
+ * values ("{\"t\":", ",\"pA\":", ..., "}") is stored back to back and
+ * rendering only copies those runs and formats the values. */
+typedef struct {
+    char     text[JSON_TEMPLATE_TEXT_MAX];
+    uint8_t  run_end[JSON_TEMPLATE_MAX_SLOTS + 1]; // Run i precedes slot i; the last closes
+    uint8_t  type[JSON_TEMPLATE_MAX_SLOTS];
+    uint8_t  decimals[JSON_TEMPLATE_MAX_SLOTS];    // JSON_SLOT_FIXED only
+    uint8_t  slots;
+    uint8_t  len;          // Bytes of text used
+    uint16_t max_len;      // Longest possible rendering
+} json_template_t;
+
+/* Destination of a stream: called with each full buffer and on flush.
+ * Returns 0 when the bytes were taken, -1 to abort the stream. */
+typedef int (*json_sink_t)(void *ctx, const char *data, uint16_t len);
+
+/* Streaming writer: nested objects and arrays of any total size through a
+ * small fixed buffer that is handed to the sink whenever it fills up */
+typedef struct {
+    char       *buffer;    // Chunk buffer
+    uint16_t    size;      // Chunk size
+    uint16_t    pos;       // Bytes pending in the buffer
+    json_sink_t sink;
+    void       *ctx;       // Passed to the sink
+    uint32_t    flushed;   // Bytes already handed to the sink
+    uint16_t    has_items; // Bit n: container at depth n+1 has a member
+    uint16_t    is_object; // Bit n: container at depth n+1 is an object
+    uint8_t     depth;
+    uint8_t     error;     // Sticky: overflow, misuse or sink failure
+} json_stream_t;
+
 /* Exported functions --------------------------------------------------------*/
 
 /**
@@ -52,6 +106,18 @@ void json_start(json_builder_t *jb);
   */
 int json_add_int(json_builder_t *jb, const char *key, int32_t value);
 
+/**
+  * @brief  Add fixed-point decimal field to JSON (no floating point)
+  * @note   The value is an integer count of 10^-decimals units, e.g. 12345
+  *         with 3 decimals is written as 12.345 and -5 with 2 as -0.05.
+  * @param  jb: JSON builder handle
+  * @param  key: Field name
+  * @param  value: Scaled value
+  * @param  decimals: Digits after the point, 0..JSON_FIXED_MAX_DECIMALS
+  * @retval 0 on success, -1 on buffer overflow or bad scale
+  */
+int json_add_fixed(json_builder_t *jb, const char *key, int32_t value, uint8_t decimals);
+
 /**
   * @brief  Add unsigned integer field to JSON
   * @param  jb: JSON builder handle
@@ -73,9 +139,9 @@ int json_add_bool(json_builder_t *jb, const char *key, bool value);
 /**
   * @brief  End JSON object
   * @param  jb: JSON builder handle
-  * @retval None
+  * @retval 0 on success, -1 on buffer overflow
   */
-void json_end(json_builder_t *jb);
+int json_end(json_builder_t *jb);
 
 /**
   * @brief  Get current JSON string length
@@ -84,6 +150,184 @@ void json_end(json_builder_t *jb);
   */
 uint16_t json_get_length(json_builder_t *jb);
 
+/**
+  * @brief  Format an unsigned integer, two digits per step (no division per digit)
+  * @param  out: Destination, at least JSON_UINT_MAX_LEN bytes, not terminated
+  * @param  value: Value
+  * @retval Number of characters written
+  */
+uint8_t json_format_uint(char *out, uint32_t value);
+
+/**
+  * @brief  Format a signed integer
+  * @param  out: Destination, at least JSON_INT_MAX_LEN bytes, not terminated
+  * @param  value: Value
+  * @retval Number of characters written
+  */
+uint8_t json_format_int(char *out, int32_t value);
+
+/**
+  * @brief  Format a fixed-point decimal (see json_add_fixed)
+  * @param  out: Destination, at least JSON_FIXED_MAX_LEN bytes, not terminated
+  * @param  value: Scaled value
+  * @param  decimals: Digits after the point, 0..JSON_FIXED_MAX_DECIMALS
+  * @retval Number of characters written, 0 (nothing written) for a bad scale
+  */
+uint8_t json_format_fixed(char *out, int32_t value, uint8_t decimals);
+
+/**
+  * @brief  Start a template ("{")
+  * @param  tpl: Template handle
+  * @retval None
+  */
+void json_template_init(json_template_t *tpl);
+
+/**
+  * @brief  Append a field to the template
+  * @param  tpl: Template handle
+  * @param  key: Field name (not escaped)
+  * @param  type: Value slot type
+  * @retval 0 on success, -1 if the template is full
+  */
+int json_template_add(json_template_t *tpl, const char *key, json_slot_type_t type);
+
+/**
+  * @brief  Append a fixed-point decimal field to the template
+  * @param  tpl: Template handle
+  * @param  key: Field name (not escaped)
+  * @param  decimals: Digits after the point, 0..JSON_FIXED_MAX_DECIMALS
+  * @retval 0 on success, -1 if the template is full or the scale is bad
+  */
+int json_template_add_fixed(json_template_t *tpl, const char *key, uint8_t decimals);
+
+/**
+  * @brief  Close the template ("}")
+  * @param  tpl: Template handle
+  * @retval 0 on success, -1 if the template is full
+  */
+int json_template_end(json_template_t *tpl);
+
+/**
+  * @brief  Render one object from a finished template
+  * @note   Values are given in slot order; JSON_SLOT_INT values are cast from
+  *         int32_t (JSON_SLOT_FIXED too, already scaled), JSON_SLOT_BOOL
+  *         values are non-zero for true. Not null-terminated.
+  * @param  tpl: Template handle
+  * @param  values: One value per slot
+  * @param  buf: Output buffer
+  * @param  buf_size: Buffer size
+  * @retval Length written, or -1 if it does not fit
+  */
+int json_template_render(const json_template_t *tpl, const uint32_t *values,
+                         char *buf, uint16_t buf_size);
+
+/**
+  * @brief  Initialize a streaming writer
+  * @param  js: Stream handle
+  * @param  buf: Chunk buffer
+  * @param  buf_size: Chunk buffer size (at least 1)
+  * @param  sink: Destination of each chunk
+  * @param  ctx: Passed to the sink
+  * @retval None
+  */
+void json_stream_init(json_stream_t *js, char *buf, uint16_t buf_size,
+                      json_sink_t sink, void *ctx);
+
+/**
+  * @brief  Open an object
+  * @note   For this and every value writer below: key names the member
+  *         inside an object and must be NULL inside an array or at the top
+  *         level. Errors are sticky; check json_stream_flush() at the end.
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @retval 0 on success, -1 on error
+  */
+int json_stream_begin_object(json_stream_t *js, const char *key);
+
+/**
+  * @brief  Close the innermost object
+  * @param  js: Stream handle
+  * @retval 0 on success, -1 on error (including an array being open)
+  */
+int json_stream_end_object(json_stream_t *js);
+
+/**
+  * @brief  Open an array
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @retval 0 on success, -1 on error
+  */
+int json_stream_begin_array(json_stream_t *js, const char *key);
+
+/**
+  * @brief  Close the innermost array
+  * @param  js: Stream handle
+  * @retval 0 on success, -1 on error (including an object being open)
+  */
+int json_stream_end_array(json_stream_t *js);
+
+/**
+  * @brief  Write an unsigned integer value
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @param  value: Value
+  * @retval 0 on success, -1 on error
+  */
+int json_stream_uint(json_stream_t *js, const char *key, uint32_t value);
+
+/**
+  * @brief  Write a signed integer value
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @param  value: Value
+  * @retval 0 on success, -1 on error
+  */
+int json_stream_int(json_stream_t *js, const char *key, int32_t value);
+
+/**
+  * @brief  Write a fixed-point decimal value (see json_add_fixed)
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @param  value: Scaled value
+  * @param  decimals: Digits after the point, 0..JSON_FIXED_MAX_DECIMALS
+  * @retval 0 on success, -1 on error
+  */
+int json_stream_fixed(json_stream_t *js, const char *key, int32_t value, uint8_t decimals);
+
+/**
+  * @brief  Write a boolean value
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @param  value: Value
+  * @retval 0 on success, -1 on error
+  */
+int json_stream_bool(json_stream_t *js, const char *key, bool value);
+
+/**
+  * @brief  Write one object rendered from a finished template
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @param  tpl: Template handle
+  * @param  values: One value per slot (see json_template_render)
+  * @retval 0 on success, -1 on error
+  */
+int json_stream_template(json_stream_t *js, const char *key,
+                         const json_template_t *tpl, const uint32_t *values);
+
+/**
+  * @brief  Hand the pending bytes to the sink
+  * @param  js: Stream handle
+  * @retval 0 if every write so far succeeded, -1 otherwise
+  */
+int json_stream_flush(json_stream_t *js);
+
+/**
+  * @brief  Total bytes written so far, flushed or pending
+  * @param  js: Stream handle
+  * @retval Length
+  */
+uint32_t json_stream_length(const json_stream_t *js);
+
 #ifdef __cplusplus
 }
 #endif
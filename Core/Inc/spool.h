@@ -0,0 +1,119 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    spool.h
+  * @brief   Store-and-forward telemetry spool in internal flash
+  ******************************************************************************
+  *
+  * Log-structured ring over two 128 KB sectors (6 and 7, reserved in
+  * STM32F446RETX_FLASH.ld). Records are appended sequentially and marked
+  * consumed in place once delivered. A sector is erased once per pass, so
+  * both wear evenly: ahead of the writer by spool_prepare() once its
+  * records are delivered, else when the writer wraps into it.
+  *
+  * Slot layout (16 bytes, programmed as words, erased = 0xFF):
+  *   w0 seq   w1 t   w2 pA | pB << 16
+  *   w3 fan | SPOOL_COMMIT << 8 | consumed << 16 (0xFFFF = pending)
+  * w3 is written last, so a slot torn by a reset is never replayed.
+  * Sequence lease slots (spool_lease_seq) are written already consumed.
+  *
+  * Slot 0 of each sector is a header: magic, generation, erase count.
+  *
+  * Note: the F446 has a single flash bank, so a sector erase (1-2 s)
+  * stalls the CPU wherever it is started from. The caller picks the moment
+  * with spool_prepare(); only a writer that outruns delivery erases inline.
+  */
+
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "telemetry.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define SPOOL_SECTOR_SIZE       0x20000U
+#define SPOOL_SLOT_SIZE         16U
+#define SPOOL_SLOTS_PER_SECTOR  (SPOOL_SECTOR_SIZE / SPOOL_SLOT_SIZE - 1)
+#define SPOOL_SEQ_LEASE         4096U   // Sequence numbers reserved per lease slot
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Scan both sectors and recover read/write positions
+  * @note   Formats the spool on first use.
+  * @retval None
+  */
+void spool_init(void);
+
+/**
+  * @brief  Append one record
+  * @note   When the spool is full the oldest sector is recycled and its
+  *         undelivered records are counted as dropped.
+  * @param  rec: Record to store (rec->seq must be set)
+  * @retval true on success, false on flash error
+  */
+bool spool_append(const telemetry_record_t *rec);
+
+/**
+  * @brief  Copy the oldest undelivered records without consuming them
+  * @param  out: Destination array
+  * @param  max: Maximum records to copy
+  * @retval Number of records copied
+  */
+uint16_t spool_peek(telemetry_record_t *out, uint16_t max);
+
+/**
+  * @brief  Mark the oldest records delivered
+  * @param  n: Number of records (as returned by spool_peek)
+  * @retval None
+  */
+void spool_consume(uint16_t n);
+
+/**
+  * @brief  Number of undelivered records
+  * @retval Record count
+  */
+uint32_t spool_count(void);
+
+/**
+  * @brief  Pre-erase the sector the writer wraps into next
+  * @note   Only once all of its records are delivered, and once per pass.
+  *         Blocks for the erase (1-2 s): call it when a stall is cheapest.
+  * @retval true if a sector was erased
+  */
+bool spool_prepare(void);
+
+/**
+  * @brief  Keep a sequence lease ahead of the live record counter
+  * @note   Writes one consumed marker slot per SPOOL_SEQ_LEASE records, so
+  *         after a reset spool_last_seq() is past every number already sent
+  *         even if none of those records went through the spool.
+  * @param  next_seq: Next sequence number the telemetry queue will assign
+  * @retval None
+  */
+void spool_lease_seq(uint32_t next_seq);
+
+/**
+  * @brief  Highest sequence number found in flash at init or appended since
+  * @note   Lets the record sequence continue across resets.
+  * @retval Sequence number, 0 if the spool has never been written
+  */
+uint32_t spool_last_seq(void);
+
+/**
+  * @brief  Records lost because the spool overflowed
+  * @retval Drop count
+  */
+uint32_t spool_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPOOL_H */
@@ -0,0 +1,163 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    telemetry.h
+  * @brief   Telemetry record queue and batch serialization
+  ******************************************************************************
+  */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "json_builder.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t seq;      // Record sequence number, assigned by telemetry_push
+    uint32_t t;        // Device tick (ms) when recorded
+    uint16_t pA;       // Power A in mW
+    uint16_t pB;       // Power B in mW
+    uint8_t  fan;      // Fan control state
+} telemetry_record_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define TELEMETRY_QUEUE_LEN            128  // Must be a power of two
+#define TELEMETRY_BATCH_MAX            40   // Keeps one batch under a 2 KB CIPSEND
+#define TELEMETRY_BATCH_MAX_LATENCY_MS 500
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Reset the record queue and counters
+  * @retval None
+  */
+void telemetry_init(void);
+
+/**
+  * @brief  Set the sequence number given to the next pushed record
+  * @note   Call after spool_init() so numbering continues across resets.
+  * @param  seq: Next sequence number
+  * @retval None
+  */
+void telemetry_set_next_seq(uint32_t seq);
+
+/**
+  * @brief  Sequence number the next pushed record will get
+  * @retval Sequence number
+  */
+uint32_t telemetry_next_seq(void);
+
+/**
+  * @brief  Append a record to the queue
+  * @note   When the queue is full the new record is dropped and counted,
+  *         so records already handed to the transport stay valid.
+  *         The queued copy gets the next sequence number (rec->seq is ignored).
+  * @param  rec: Record to copy
+  * @retval true if queued, false if dropped
+  */
+bool telemetry_push(const telemetry_record_t *rec);
+
+/**
+  * @brief  Number of queued records
+  * @retval Record count
+  */
+uint16_t telemetry_count(void);
+
+/**
+  * @brief  Copy the oldest records without removing them
+  * @param  out: Destination array
+  * @param  max: Maximum records to copy
+  * @retval Number of records copied
+  */
+uint16_t telemetry_peek(telemetry_record_t *out, uint16_t max);
+
+/**
+  * @brief  Remove the oldest records (after they were delivered)
+  * @param  n: Number of records to remove
+  * @retval None
+  */
+void telemetry_consume(uint16_t n);
+
+/**
+  * @brief  Check whether a batch should be sent now
+  * @param  now_ms: Current tick
+  * @param  batch_max: Send as soon as this many records are queued
+  * @param  max_latency_ms: Send once the oldest record is this old
+  * @retval true if a batch is due
+  */
+bool telemetry_batch_due(uint32_t now_ms, uint16_t batch_max, uint32_t max_latency_ms);
+
+/**
+  * @brief  Number of records dropped because the queue was full
+  * @retval Drop count
+  */
+uint32_t telemetry_dropped(void);
+
+/**
+  * @brief  Serialize records as a JSON array of telemetry objects
+  * @note   "seq" is written on the first record and wherever the sequence
+  *         is not previous + 1; the server infers the rest.
+  * @param  recs: Records to serialize
+  * @param  n: Number of records
+  * @param  buf: Output buffer
+  * @param  buf_size: Buffer size
+  * @retval Length written (excluding null terminator), or -1 on overflow
+  */
+int telemetry_build_json_batch(const telemetry_record_t *recs, uint16_t n,
+                               char *buf, uint16_t buf_size);
+
+/**
+  * @brief  Stream records as a JSON array (same format as the batch above)
+  * @note   Any number of records goes through the stream's fixed chunk
+  *         buffer; the caller flushes afterwards.
+  * @param  recs: Records to serialize
+  * @param  n: Number of records
+  * @param  js: Open stream, at the top level or where an array value fits
+  * @param  key: Member name when inside an object, else NULL
+  * @retval 0 on success, -1 on error
+  */
+int telemetry_write_json_batch(const telemetry_record_t *recs, uint16_t n,
+                               json_stream_t *js, const char *key);
+
+/**
+  * @brief  Stream one element of a telemetry_write_json_batch() array
+  * @note   For callers that write the array piecemeal (json_stream_begin_array,
+  *         recs[0..n-1] in order, json_stream_end_array); the output is the
+  *         same byte for byte.
+  * @param  recs: All records of the batch
+  * @param  i: Index of the record to write; recs[i - 1] decides on "seq"
+  * @param  js: Stream inside the open array
+  * @retval 0 on success, -1 on error
+  */
+int telemetry_write_json_record(const telemetry_record_t *recs, uint16_t i, json_stream_t *js);
+
+/**
+  * @brief  Serialize records as one binary frame (see bin_frame.h)
+  * @note   Channels are pA, pB, fan in that order. Records that do not
+  *         fit are left out; check the returned record count.
+  * @param  recs: Records to serialize
+  * @param  n: Number of records
+  * @param  device_id: Device identifier written to the header
+  * @param  boot_id: Boot identifier written to the header
+  * @param  seq: Frame sequence number
+  * @param  buf: Output buffer
+  * @param  buf_size: Buffer size
+  * @param  frame_len: Receives the frame length in bytes
+  * @retval Number of records encoded, or -1 if not even the header fits
+  */
+int telemetry_build_bin_batch(const telemetry_record_t *recs, uint16_t n,
+                              uint32_t device_id, uint16_t boot_id, uint32_t seq,
+                              uint8_t *buf, uint16_t buf_size, uint16_t *frame_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,88 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    ts_codec.h
+  * @brief   Gorilla-style streaming compressor for multi-channel time series
+  ******************************************************************************
+  *
+  * Bit stream, MSB first. Per sample:
+  *   timestamp: zigzag(delta-of-delta) of t, starting from dt = 0 at base_t
+  *   values:    zigzag(v - prev_v) per channel, prev_v starting at 0
+  *
+  * Every zigzag number uses the same prefix-bucket code:
+  *   0                 -> '0'
+  *   < 2^7             -> '10'   + 7 bits
+  *   < 2^9             -> '110'  + 9 bits
+  *   < 2^12            -> '1110' + 12 bits
+  *   otherwise         -> '1111' + 32 bits
+  *
+  * A steady 10 ms sample period costs 1 bit, an unchanged value 1 bit. The
+  * worst case is TS_CODEC_SAMPLE_MAX_BITS per sample, and ts_encoder_add()
+  * refuses a sample unless that much room is left, so a caller buffer of
+  * TS_CODEC_MAX_BYTES(n, channels) always holds n samples.
+  *
+  * Decoded by server/ts_codec.js.
+  */
+
+#ifndef TS_CODEC_H
+#define TS_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define TS_CODEC_MAX_CHANNELS           16
+#define TS_CODEC_SAMPLE_MAX_BITS(ch)    (36U * (1U + (ch)))
+#define TS_CODEC_MAX_BYTES(n, ch)       (((n) * TS_CODEC_SAMPLE_MAX_BITS(ch) + 7U) / 8U)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint8_t *buffer;                        // Output buffer
+    uint16_t size;                          // Buffer size in bytes
+    uint32_t bitpos;                        // Bits written
+    uint16_t count;                         // Samples written
+    uint8_t  channels;                      // Values per sample
+    uint32_t prev_t;                        // Previous timestamp
+    int32_t  prev_dt;                       // Previous timestamp delta
+    int32_t  prev[TS_CODEC_MAX_CHANNELS];   // Previous value per channel
+} ts_encoder_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Start a stream
+  * @param  enc: Encoder handle
+  * @param  buf: Output buffer
+  * @param  buf_size: Buffer size in bytes
+  * @param  base_t: Reference timestamp (the first sample is coded against it)
+  * @param  channels: Values per sample (1..TS_CODEC_MAX_CHANNELS)
+  * @retval 0 on success, -1 on bad arguments
+  */
+int ts_encoder_init(ts_encoder_t *enc, uint8_t *buf, uint16_t buf_size,
+                    uint32_t base_t, uint8_t channels);
+
+/**
+  * @brief  Append one sample
+  * @param  enc: Encoder handle
+  * @param  t: Sample timestamp (ms)
+  * @param  values: Array of enc->channels values
+  * @retval 0 on success, -1 if a worst-case sample would not fit
+  */
+int ts_encoder_add(ts_encoder_t *enc, uint32_t t, const int32_t *values);
+
+/**
+  * @brief  Bytes used so far (the last byte is zero-padded)
+  * @param  enc: Encoder handle
+  * @retval Length in bytes
+  */
+uint16_t ts_encoder_bytes(const ts_encoder_t *enc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TS_CODEC_H */
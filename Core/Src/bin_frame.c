@@ -0,0 +1,160 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    bin_frame.c
+  * @brief   Compact binary telemetry frame encoder implementation
+  ******************************************************************************
+  */
+
+#include "bin_frame.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define BIN_FRAME_MAGIC0   'E'
+#define BIN_FRAME_MAGIC1   'F'
+#define BIN_FRAME_COUNT_OFFSET 16
+#define BIN_FRAME_BOOT_OFFSET  18
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Store 16/32-bit little-endian values
+  */
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#if BIN_FRAME_VERSION == BIN_FRAME_VERSION_VARINT
+/**
+  * @brief  Append unsigned LEB128 varint
+  * @param  bf: Frame handle
+  * @param  v: Value
+  * @retval 0 on success, -1 on buffer overflow
+  */
+static int bin_frame_put_varint(bin_frame_t *bf, uint32_t v)
+{
+    while (v >= 0x80) {
+        if (bf->pos >= bf->size) return -1;
+        bf->buffer[bf->pos++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    if (bf->pos >= bf->size) return -1;
+    bf->buffer[bf->pos++] = (uint8_t)v;
+    return 0;
+}
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+uint16_t bin_frame_crc16(const uint8_t *data, uint16_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (uint16_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+int bin_frame_begin(bin_frame_t *bf, uint8_t *buf, uint16_t buf_size,
+                    uint32_t device_id, uint16_t boot_id, uint32_t seq, uint32_t base_t,
+                    uint8_t channels)
+{
+    if (channels == 0 || channels > BIN_FRAME_MAX_CHANNELS) {
+        return -1;
+    }
+    if (buf_size < BIN_FRAME_HEADER_SIZE + BIN_FRAME_CRC_SIZE) {
+        return -1;
+    }
+
+    bf->buffer = buf;
+    bf->size = buf_size - BIN_FRAME_CRC_SIZE; // CRC space reserved up front
+    bf->count = 0;
+    bf->channels = channels;
+    bf->prev_t = base_t;
+    for (uint8_t c = 0; c < channels; c++) {
+        bf->prev[c] = 0;
+    }
+
+    buf[0] = BIN_FRAME_MAGIC0;
+    buf[1] = BIN_FRAME_MAGIC1;
+    buf[2] = BIN_FRAME_VERSION;
+    buf[3] = channels;
+    put_le32(&buf[4], device_id);
+    put_le32(&buf[8], seq);
+    put_le32(&buf[12], base_t);
+    put_le16(&buf[BIN_FRAME_COUNT_OFFSET], 0);
+    put_le16(&buf[BIN_FRAME_BOOT_OFFSET], boot_id);
+    bf->pos = BIN_FRAME_HEADER_SIZE;
+
+#if BIN_FRAME_VERSION == BIN_FRAME_VERSION_TS_CODEC
+    return ts_encoder_init(&bf->ts, &buf[BIN_FRAME_HEADER_SIZE],
+                           bf->size - BIN_FRAME_HEADER_SIZE, base_t, channels);
+#else
+    return 0;
+#endif
+}
+
+int bin_frame_add(bin_frame_t *bf, uint32_t t, const int32_t *values)
+{
+#if BIN_FRAME_VERSION == BIN_FRAME_VERSION_TS_CODEC
+    // Bounded worst case: a sample is only started if it is sure to fit
+    if (ts_encoder_add(&bf->ts, t, values) != 0) {
+        return -1;
+    }
+    bf->pos = BIN_FRAME_HEADER_SIZE + ts_encoder_bytes(&bf->ts);
+    bf->count = bf->ts.count;
+    return 0;
+#else
+    uint16_t start = bf->pos;
+
+    if (bf->count == 0xFFFF) {
+        return -1;
+    }
+
+    if (bin_frame_put_varint(bf, t - bf->prev_t) != 0) {
+        bf->pos = start;
+        return -1;
+    }
+    for (uint8_t c = 0; c < bf->channels; c++) {
+        int32_t d = (int32_t)((uint32_t)values[c] - (uint32_t)bf->prev[c]);
+        uint32_t zz = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31); // zig-zag
+        if (bin_frame_put_varint(bf, zz) != 0) {
+            bf->pos = start; // roll back the partial sample
+            return -1;
+        }
+    }
+
+    // Commit only after the whole sample fits
+    bf->prev_t = t;
+    for (uint8_t c = 0; c < bf->channels; c++) {
+        bf->prev[c] = values[c];
+    }
+    bf->count++;
+    return 0;
+#endif
+}
+
+int bin_frame_end(bin_frame_t *bf)
+{
+    put_le16(&bf->buffer[BIN_FRAME_COUNT_OFFSET], bf->count);
+
+    uint16_t crc = bin_frame_crc16(bf->buffer, bf->pos);
+    put_le16(&bf->buffer[bf->pos], crc); // Space reserved in bin_frame_begin()
+    bf->pos += BIN_FRAME_CRC_SIZE;
+    bf->size += BIN_FRAME_CRC_SIZE;
+
+    return bf->pos;
+}
@@ -0,0 +1,119 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    debug_log.c
+  * @brief   Non-blocking debug output: ring buffer drained by UART TX DMA
+  ******************************************************************************
+  */
+
+#include "debug_log.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef *log_huart = NULL;
+static uint8_t log_buf[DEBUG_LOG_BUF_SIZE];
+
+/* Free-running indices: head is written by the producer only, tail and
+ * the DMA state by the TX complete interrupt (or with it masked). */
+static volatile uint32_t log_head = 0;
+static volatile uint32_t log_tail = 0;
+static volatile uint16_t log_tx_len = 0;   // Bytes in the DMA transfer, 0 = idle
+static uint32_t log_dropped = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Start DMA on the contiguous chunk at tail, if idle and pending
+  * @note   Runs in the TX complete interrupt or with interrupts masked.
+  */
+static void debug_log_start_tx(void)
+{
+    uint32_t start = log_tail & (DEBUG_LOG_BUF_SIZE - 1);
+    uint32_t len = log_head - log_tail;
+
+    if (log_huart == NULL || log_tx_len != 0 || len == 0) {
+        return;
+    }
+    if (start + len > DEBUG_LOG_BUF_SIZE) {
+        len = DEBUG_LOG_BUF_SIZE - start; // Wrapped data goes in the next chunk
+    }
+
+    log_tx_len = (uint16_t)len;
+    if (HAL_UART_Transmit_DMA(log_huart, &log_buf[start], (uint16_t)len) != HAL_OK) {
+        log_tx_len = 0; // Retried on the next write
+    }
+}
+
+/**
+  * @brief  debug_log_start_tx() from thread context
+  */
+static void debug_log_kick(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    debug_log_start_tx();
+    if (primask == 0) {
+        __enable_irq();
+    }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void debug_log_init(UART_HandleTypeDef *huart)
+{
+    log_huart = huart;
+    debug_log_kick();
+}
+
+int debug_log_write(const uint8_t *data, uint16_t len)
+{
+    uint32_t head = log_head;
+    uint32_t start = head & (DEBUG_LOG_BUF_SIZE - 1);
+    uint32_t first;
+
+    if (len > DEBUG_LOG_BUF_SIZE - (head - log_tail)) {
+        log_dropped++;
+        return -1;
+    }
+
+    first = DEBUG_LOG_BUF_SIZE - start;
+    if (first >= len) {
+        memcpy(&log_buf[start], data, len);
+    } else {
+        memcpy(&log_buf[start], data, first);
+        memcpy(log_buf, data + first, len - first);
+    }
+    log_head = head + len; // Publish after the copy
+
+    if (log_tx_len == 0) {
+        debug_log_kick();
+    }
+    return 0;
+}
+
+void debug_log_tx_complete(UART_HandleTypeDef *huart)
+{
+    if (huart != log_huart) {
+        return;
+    }
+    log_tail += log_tx_len;
+    log_tx_len = 0;
+    debug_log_start_tx();
+}
+
+void debug_log_error(UART_HandleTypeDef *huart)
+{
+    if (huart != log_huart || log_tx_len == 0) {
+        return;
+    }
+    HAL_UART_AbortTransmit(huart);
+    log_tail += log_tx_len;
+    log_tx_len = 0;
+    debug_log_start_tx();
+}
+
+uint32_t debug_log_dropped(void)
+{
+    return log_dropped;
+}
@@ -0,0 +1,40 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    dlog.c
+  * @brief   Deferred binary logging: format on the host, not on the MCU
+  ******************************************************************************
+  */
+
+#include "dlog.h"
+#include "debug_log.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DLOG_FRAME_MAX  (4 + 4 * DLOG_MAX_ARGS + 1)
+
+/* Exported functions --------------------------------------------------------*/
+
+void dlog_write(uint16_t id, const uint32_t *args, uint8_t nargs)
+{
+    uint8_t frame[DLOG_FRAME_MAX];
+    uint16_t len = 4 + 4 * nargs;
+    uint8_t sum = 0;
+
+    if (nargs > DLOG_MAX_ARGS) {
+        return;
+    }
+
+    frame[0] = DLOG_SYNC;
+    frame[1] = (uint8_t)id;
+    frame[2] = (uint8_t)(id >> 8);
+    frame[3] = nargs;
+    memcpy(&frame[4], args, 4 * nargs); // Cortex-M is little-endian
+
+    for (uint16_t i = 1; i < len; i++) {
+        sum ^= frame[i];
+    }
+    frame[len++] = sum;
+
+    debug_log_write(frame, len);
+}
@@ -15,16 +15,186 @@
 #define RESPONSE_OK       "OK"
 #define RESPONSE_ERROR    "ERROR"
 #define RESPONSE_PROMPT   "> "
+#define RESPONSE_SEND_OK  "SEND OK"
+#define RESPONSE_SEND_FAIL "SEND FAIL"
+#define RESPONSE_PT_PROMPT ">"      // Passthrough prompt, no trailing space
+#define ESCAPE_SEQUENCE    "+++"
+#define URC_READY          "ready"
+#define URC_GOT_IP         "WIFI GOT IP"
+#define URC_DISCONNECT     "WIFI DISCONNECT"
+#define CWSTATE_PREFIX     "+CWSTATE:"
+#define CWSTATE_GOT_IP     2
+#define CWSTATE_CONNECTED  1      // Associated, waiting for DHCP
+#define CWSTATE_CONNECTING 3      // Auto-connect / reconnect in progress
+#define IPD_PREFIX         "+IPD,"
+#define RESPONSE_CLOSED    "CLOSED"
+#define HTTP_STATUS_PREFIX "HTTP/1."
+#define HTTP_RETRY_AFTER   "retry-after:"        // Seconds (the HTTP-date form is ignored)
+#define HTTP_RETRY_AFTER_MS "x-retry-after-ms:"  // Server extension, milliseconds
+
+/* Private types -------------------------------------------------------------*/
+
+/* Phases of the asynchronous engine */
+typedef enum {
+    ESP_ASYNC_IDLE = 0,
+    ESP_ASYNC_TX_CMD,
+    ESP_ASYNC_WAIT_RESPONSE,
+    ESP_ASYNC_TX_PAYLOAD,
+    ESP_ASYNC_WAIT_SEND_OK,
+    ESP_ASYNC_WAIT_HTTP,         // SEND OK seen, waiting for the response headers
+    ESP_ASYNC_ESCAPE_GUARD,      // Line idle before "+++"
+    ESP_ASYNC_ESCAPE_WAIT        // Line idle after "+++"
+} esp_async_phase_t;
+
+/* Link bring-up (esp_at_init_async) and rate changes, one step per queued
+ * command; the step's hook picks the next phase */
+typedef enum {
+    ESP_BOOT_DONE = 0,
+    ESP_BOOT_PROBE,              // "AT" every ESP_AT_READY_PROBE_MS until "ready" or a reply
+    ESP_BOOT_CWSTATE,            // Answered without "ready": still joined?
+    ESP_BOOT_BAUD_SET,           // AT+UART_CUR to the new rate
+    ESP_BOOT_BAUD_SWITCH,        // Module applying it; then follow and verify
+    ESP_BOOT_BAUD_REVERT,        // Verify failed: AT+UART_CUR back, sent at the new rate
+    ESP_BOOT_BAUD_RESTORE,       // Module switching back; then follow and verify
+    ESP_BOOT_WAIT                // Step in flight; its hook moves on
+} esp_boot_phase_t;
+
+/* "+IPD,<len>:<data>" framing in the RX stream */
+typedef enum {
+    IPD_SCAN = 0,
+    IPD_LEN,
+    IPD_DATA
+} esp_ipd_state_t;
+
+/* Internal hook run on completion, before the user callback */
+typedef void (*esp_at_hook_t)(esp_at_status_t status);
+
+/* One queued command */
+typedef struct {
+    char           cmd[ESP_AT_CMD_MAX_LEN]; // Command including "\r\n"
+    uint16_t       cmd_len;
+    const char    *expected;                // Expected response (static string)
+    uint32_t       timeout_ms;
+    const uint8_t *payload;                 // Data sent after the "> " prompt
+    uint16_t       payload_len;
+    uint8_t        linked;                  // Next entry belongs to the same sequence
+    uint16_t       guard_ms;                // Escape sequence: idle time after, no reply
+    uint8_t        http_resp;               // Complete on the HTTP response, not SEND OK
+    esp_at_body_fn_t body_fn;               // Streamed rest of the payload, if any
+    void          *body_ctx;
+    uint16_t       body_left;               // Streamed bytes still to send
+    uint8_t        body_failed;             // body_fn failed: padded, report ESP_AT_ERROR
+    esp_at_hook_t  hook;
+    esp_at_cmd_cb_t cb;
+    void          *ctx;
+} esp_at_cmd_entry_t;
 
 /* Private variables ---------------------------------------------------------*/
 static UART_HandleTypeDef *esp_huart = NULL;
 static char rx_buffer[ESP_AT_RX_BUFFER_SIZE];
+static uint16_t rx_pos = 0;
 static esp_state_t esp_state = ESP_STATE_IDLE;
 
+/* RX ring filled from the UART interrupt */
+static volatile uint8_t  rx_ring[ESP_AT_RX_RING_SIZE];
+static volatile uint16_t rx_head = 0;
+static volatile uint16_t rx_tail = 0;
+static volatile uint32_t rx_overflows = 0;
+static uint8_t rx_it_byte;
+
+/* Command queue */
+static esp_at_cmd_entry_t cmd_queue[ESP_AT_CMD_QUEUE_LEN];
+static uint8_t q_head = 0;
+static uint8_t q_count = 0;
+static esp_async_phase_t async_phase = ESP_ASYNC_IDLE;
+static uint32_t async_start_tick = 0;
+
+/* Request buffer owned by the in-flight asynchronous HTTP POST. Bodies
+ * start after a reserved gap that the headers are framed into. */
+static char http_tx_buffer[ESP_AT_HTTP_BUFFER_SIZE];
+static char *const http_body = &http_tx_buffer[ESP_AT_HTTP_HEADER_RESERVE];
+static uint8_t http_chunk[ESP_AT_HTTP_CHUNK_SIZE]; // Streamed body chunk on the wire
+static uint8_t http_tx_busy = 0;
+static const char *http_device_id = NULL; // X-Device-Id header value, if set
+static const char *http_boot_id = NULL;   // X-Boot-Id header value, if set
+
+/* Transparent transmission (AT+CIPMODE=1) state */
+static uint8_t passthrough = 0;
+static uint32_t last_tx_tick = 0;
+
+/* CubeMX link settings, which the module returns to on every reset */
+static uint32_t base_baud = 0;
+static bool base_flow_ctrl = false;
+
+/* Bring-up and rate change in progress */
+static esp_boot_phase_t boot_phase = ESP_BOOT_DONE;
+static uint32_t boot_tick = 0;            // Start of the probe / rate switch
+static uint32_t baud_new = 0;
+static bool baud_new_flow = false;
+static uint32_t baud_old = 0;
+static bool baud_old_flow = false;
+static bool baud_retry_no_flow = false;   // RTS/CTS failed: try the rate without it
+static esp_at_status_t baud_result = ESP_AT_OK;
+
+/* Unsolicited lines ("ready", "WIFI GOT IP", ...) picked out of the RX stream */
+static char urc_line[24];
+static uint8_t urc_len = 0;
+static uint8_t urc_ready = 0;
+static uint8_t wifi_ip = 0;
+static esp_at_boot_times_t boot_times;
+
+/* esp_at_init_wifi_async() waiting for a stored-AP rejoin */
+static uint8_t join_wait = 0;
+static uint32_t join_deadline = 0;
+static char join_cmd[ESP_AT_CMD_MAX_LEN];
+static esp_at_cmd_cb_t join_cb = NULL;
+static void *join_ctx = NULL;
+
+/* HTTP response parser, fed with "+IPD" payload bytes (raw in passthrough) */
+static esp_ipd_state_t ipd_state = IPD_SCAN;
+static uint8_t ipd_match = 0;
+static uint16_t ipd_left = 0;
+static char http_line[48];
+static uint8_t http_line_len = 0;
+static uint8_t http_in_headers = 0;
+static uint16_t http_status = 0;
+static uint32_t http_retry_ms = 0;
+static uint8_t http_resp_done = 0;        // Headers complete since the request went out
+static uint32_t http_sent_tick = 0;       // 0 = no request awaiting its status line
+static esp_at_http_stats_t http_stats;
+
 /* Private function prototypes -----------------------------------------------*/
 static esp_at_status_t esp_at_wait_response(const char *expected, uint32_t timeout_ms);
 static esp_at_status_t esp_at_send_string(const char *str);
 static void esp_at_clear_rx_buffer(void);
+static bool esp_at_rx_pop(uint8_t *byte);
+static void esp_at_rx_drain(void);
+static esp_at_status_t esp_at_match_response(const char *expected);
+static esp_at_cmd_entry_t *esp_at_queue_alloc(void);
+static esp_at_cmd_entry_t *esp_at_queue_tail(void);
+static esp_at_cmd_entry_t *esp_at_queue_cmd(const char *cmd, const char *expected,
+                                            uint32_t timeout_ms, esp_at_cmd_cb_t cb, void *ctx);
+static int esp_at_build_http_post(const char *endpoint, const char *content_type,
+                                  const uint8_t *body, uint16_t body_len, const char **request);
+static int esp_at_http_prepend(char **p, const char *str);
+static esp_at_status_t esp_at_body_next(esp_at_cmd_entry_t *e);
+static void esp_at_async_complete(esp_at_status_t status);
+static void esp_at_async_start_next(void);
+static esp_at_status_t esp_at_uart_config(uint32_t baud, bool flow_ctrl);
+static void esp_at_urc_feed(uint8_t byte);
+static void esp_at_ipd_feed(uint8_t byte);
+static void esp_at_http_feed(uint8_t byte);
+static const char *esp_at_http_header(const char *line, const char *name);
+static uint32_t esp_at_http_number(const char *p);
+static void esp_at_http_begin(void);
+static esp_at_status_t esp_at_http_result(void);
+static void esp_at_boot_begin(void);
+static esp_at_status_t esp_at_wait_ready(uint32_t timeout_ms);
+static int esp_at_parse_cwstate(void);
+static void esp_at_join_done(esp_at_status_t status);
+static void esp_at_join_full(void);
+static void esp_at_boot_step(void);
+static void esp_at_baud_begin(uint32_t baud, bool flow_ctrl, bool retry_no_flow);
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -34,6 +204,303 @@ static void esp_at_clear_rx_buffer(void);
 static void esp_at_clear_rx_buffer(void)
 {
     memset(rx_buffer, 0, ESP_AT_RX_BUFFER_SIZE);
+    rx_pos = 0;
+}
+
+/**
+  * @brief  Pop one byte from the RX ring
+  * @param  byte: Destination for the received byte
+  * @retval true if a byte was available
+  */
+static bool esp_at_rx_pop(uint8_t *byte)
+{
+    uint16_t tail = rx_tail;
+
+    if (tail == rx_head) {
+        return false;
+    }
+    *byte = rx_ring[tail];
+    rx_tail = (tail + 1) & (ESP_AT_RX_RING_SIZE - 1);
+    return true;
+}
+
+/**
+  * @brief  Move all pending ring bytes into the response buffer
+  */
+static void esp_at_rx_drain(void)
+{
+    uint8_t rx_byte;
+
+    while (esp_at_rx_pop(&rx_byte)) {
+        esp_at_urc_feed(rx_byte);
+        if (passthrough) {
+            esp_at_http_feed(rx_byte);
+        } else {
+            esp_at_ipd_feed(rx_byte);
+        }
+        if (rx_pos < (ESP_AT_RX_BUFFER_SIZE - 1)) {
+            rx_buffer[rx_pos++] = rx_byte;
+            rx_buffer[rx_pos] = '\0';
+        }
+    }
+}
+
+/**
+  * @brief  Line-assemble the RX stream and track unsolicited messages
+  * @param  byte: Next received byte
+  */
+static void esp_at_urc_feed(uint8_t byte)
+{
+    if (byte != '\n') {
+        if (urc_len < sizeof(urc_line)) {
+            urc_line[urc_len] = (char)byte;
+        }
+        if (urc_len < 0xFF) {
+            urc_len++; // Overlong lines are counted, never matched
+        }
+        return;
+    }
+
+    if (urc_len > 0 && urc_len < sizeof(urc_line) && urc_line[urc_len - 1] == '\r') {
+        urc_len--;
+    }
+    if (urc_len < sizeof(urc_line)) {
+        urc_line[urc_len] = '\0';
+        uint32_t now = HAL_GetTick();
+
+        if (strcmp(urc_line, URC_READY) == 0) {
+            urc_ready = 1;
+            wifi_ip = 0; // Fresh boot: any earlier join is gone
+            if (boot_times.ready == 0) {
+                boot_times.ready = now;
+            }
+        } else if (strcmp(urc_line, URC_GOT_IP) == 0) {
+            wifi_ip = 1;
+            if (boot_times.got_ip == 0) {
+                boot_times.got_ip = now;
+            }
+        } else if (strcmp(urc_line, URC_DISCONNECT) == 0) {
+            wifi_ip = 0;
+        }
+    }
+    urc_len = 0;
+}
+
+/**
+  * @brief  Pass the payload of "+IPD,<len>:" frames to the HTTP parser
+  * @param  byte: Next received byte
+  */
+static void esp_at_ipd_feed(uint8_t byte)
+{
+    switch (ipd_state) {
+    case IPD_DATA:
+        esp_at_http_feed(byte);
+        if (--ipd_left == 0) {
+            ipd_state = IPD_SCAN;
+        }
+        break;
+
+    case IPD_LEN:
+        if (byte >= '0' && byte <= '9' && ipd_left < ESP_AT_HTTP_BUFFER_SIZE * 2) {
+            ipd_left = ipd_left * 10 + (byte - '0');
+        } else {
+            ipd_state = (byte == ':' && ipd_left > 0) ? IPD_DATA : IPD_SCAN;
+            http_line_len = 0; // A body rarely ends in "\n": start lines afresh
+        }
+        break;
+
+    default:
+        if (byte == (uint8_t)IPD_PREFIX[ipd_match]) {
+            ipd_match++;
+        } else {
+            ipd_match = (byte == (uint8_t)IPD_PREFIX[0]) ? 1 : 0;
+        }
+        if (ipd_match == sizeof(IPD_PREFIX) - 1) {
+            ipd_match = 0;
+            ipd_left = 0;
+            ipd_state = IPD_LEN;
+        }
+        break;
+    }
+}
+
+/**
+  * @brief  Case-insensitive header name match
+  * @param  line: Header line
+  * @param  name: Lower-case name including the colon
+  * @retval Pointer to the value (leading blanks skipped), NULL if no match
+  */
+static const char *esp_at_http_header(const char *line, const char *name)
+{
+    for (; *name != '\0'; line++, name++) {
+        char c = *line;
+        if (c >= 'A' && c <= 'Z') {
+            c = (char)(c - 'A' + 'a');
+        }
+        if (c != *name) {
+            return NULL;
+        }
+    }
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    return line;
+}
+
+/**
+  * @brief  Decimal header value, saturating
+  * @retval Value, 0 if it does not start with a digit
+  */
+static uint32_t esp_at_http_number(const char *p)
+{
+    uint32_t v = 0;
+
+    for (; *p >= '0' && *p <= '9'; p++) {
+        v = (v < 100000000U) ? v * 10U + (uint32_t)(*p - '0') : v;
+    }
+    return v;
+}
+
+/**
+  * @brief  Line-assemble HTTP response bytes; track the status line and the
+  *         retry delay, and publish once the headers are complete
+  * @param  byte: Next response byte
+  */
+static void esp_at_http_feed(uint8_t byte)
+{
+    if (byte != '\n') {
+        if (http_line_len < sizeof(http_line) - 1) {
+            http_line[http_line_len++] = (char)byte; // Long lines keep their head only
+        }
+        return;
+    }
+
+    uint8_t len = http_line_len;
+    if (len > 0 && http_line[len - 1] == '\r') {
+        len--;
+    }
+    http_line[len] = '\0';
+    http_line_len = 0;
+
+    const char *v;
+    if (strncmp(http_line, HTTP_STATUS_PREFIX, sizeof(HTTP_STATUS_PREFIX) - 1) == 0 &&
+        len >= 12 && http_line[8] == ' ') {
+        // "HTTP/1.1 503 Service Unavailable"
+        http_status = (uint16_t)esp_at_http_number(&http_line[9]);
+        http_retry_ms = 0;
+        http_in_headers = 1;
+        if (http_sent_tick != 0) {
+            http_stats.last_rtt_ms = HAL_GetTick() - http_sent_tick;
+            http_sent_tick = 0;
+        }
+    } else if (!http_in_headers) {
+        return; // Body
+    } else if (len == 0) {
+        http_in_headers = 0;
+        http_stats.last_status = http_status;
+        http_stats.retry_after_ms = http_retry_ms;
+        http_stats.responses++;
+        if (http_status >= 200 && http_status < 300) {
+            http_stats.status_2xx++;
+        } else if (http_status >= 400 && http_status < 500) {
+            http_stats.status_4xx++;
+        } else if (http_status >= 500) {
+            http_stats.status_5xx++;
+        }
+        if (http_status == 429 || http_status == 503 || http_retry_ms > 0) {
+            http_stats.throttled++;
+        }
+        http_resp_done = 1;
+    } else if ((v = esp_at_http_header(http_line, HTTP_RETRY_AFTER_MS)) != NULL) {
+        http_retry_ms = esp_at_http_number(v); // Finer than Retry-After: wins
+    } else if ((v = esp_at_http_header(http_line, HTTP_RETRY_AFTER)) != NULL &&
+               http_retry_ms == 0) {
+        http_retry_ms = esp_at_http_number(v) * 1000U;
+    }
+}
+
+/**
+  * @brief  A request is about to go out: forget the previous response
+  */
+static void esp_at_http_begin(void)
+{
+    http_resp_done = 0;
+    http_line_len = 0;
+    http_sent_tick = HAL_GetTick();
+    if (http_sent_tick == 0) {
+        http_sent_tick = 1; // 0 means "none pending"
+    }
+}
+
+/**
+  * @brief  Map the parsed response to a completion status
+  */
+static esp_at_status_t esp_at_http_result(void)
+{
+    return (http_stats.last_status >= 200 && http_stats.last_status < 300) ?
+           ESP_AT_OK : ESP_AT_HTTP_ERROR;
+}
+
+/**
+  * @brief  Restart boot stage tracking (power-on or AT+RST)
+  */
+static void esp_at_boot_begin(void)
+{
+    memset(&boot_times, 0, sizeof(boot_times));
+    boot_times.start = HAL_GetTick();
+    urc_ready = 0;
+    wifi_ip = 0;
+}
+
+/**
+  * @brief  Wait for "ready" after AT+RST (no probing: the old firmware may
+  *         still reply)
+  * @param  timeout_ms: Longest wait
+  * @retval ESP_AT_OK once up, ESP_AT_TIMEOUT otherwise
+  */
+static esp_at_status_t esp_at_wait_ready(uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while ((HAL_GetTick() - start) < timeout_ms) {
+        esp_at_rx_drain();
+        if (urc_ready) {
+            return ESP_AT_OK;
+        }
+        HAL_Delay(1);
+    }
+    return ESP_AT_TIMEOUT;
+}
+
+/**
+  * @brief  Parse the AT+CWSTATE? reply in the response buffer
+  * @retval Station state (0..4), or -1 if absent (older ESP-AT)
+  */
+static int esp_at_parse_cwstate(void)
+{
+    const char *p = strstr(rx_buffer, CWSTATE_PREFIX);
+
+    if (p == NULL || p[sizeof(CWSTATE_PREFIX) - 1] < '0' || p[sizeof(CWSTATE_PREFIX) - 1] > '9') {
+        return -1;
+    }
+    return p[sizeof(CWSTATE_PREFIX) - 1] - '0';
+}
+
+/**
+  * @brief  Check the response buffer for a terminal reply
+  * @param  expected: Expected response string (NULL to accept "OK")
+  * @retval ESP_AT_OK, ESP_AT_ERROR, or ESP_AT_BUSY if not complete yet
+  */
+static esp_at_status_t esp_at_match_response(const char *expected)
+{
+    if (strstr(rx_buffer, (expected != NULL) ? expected : RESPONSE_OK) != NULL) {
+        return ESP_AT_OK;
+    }
+    if (strstr(rx_buffer, RESPONSE_ERROR) != NULL ||
+        strstr(rx_buffer, RESPONSE_SEND_FAIL) != NULL) {
+        return ESP_AT_ERROR;
+    }
+    return ESP_AT_BUSY;
 }
 
 /**
@@ -65,36 +532,16 @@ static esp_at_status_t esp_at_send_string(const char *str)
 static esp_at_status_t esp_at_wait_response(const char *expected, uint32_t timeout_ms)
 {
     uint32_t start_time = HAL_GetTick();
-    uint16_t rx_pos = 0;
-    uint8_t rx_byte;
     
     esp_at_clear_rx_buffer();
     
     while ((HAL_GetTick() - start_time) < timeout_ms) {
-        // Try to receive a byte (non-blocking)
-        if (HAL_UART_Receive(esp_huart, &rx_byte, 1, 10) == HAL_OK) {
-            if (rx_pos < (ESP_AT_RX_BUFFER_SIZE - 1)) {
-                rx_buffer[rx_pos++] = rx_byte;
-                rx_buffer[rx_pos] = '\0';
-                
-                // Check for expected response
-                if (expected != NULL) {
-                    if (strstr((char*)rx_buffer, expected) != NULL) {
-                        return ESP_AT_OK;
-                    }
-                    if (strstr((char*)rx_buffer, RESPONSE_ERROR) != NULL) {
-                        return ESP_AT_ERROR;
-                    }
-                } else {
-                    // Check for OK or ERROR
-                    if (strstr((char*)rx_buffer, RESPONSE_OK) != NULL) {
-                        return ESP_AT_OK;
-                    }
-                    if (strstr((char*)rx_buffer, RESPONSE_ERROR) != NULL) {
-                        return ESP_AT_ERROR;
-                    }
-                }
-            }
+        // Bytes arrive through the RX interrupt into rx_ring
+        esp_at_rx_drain();
+        
+        esp_at_status_t status = esp_at_match_response(expected);
+        if (status != ESP_AT_BUSY) {
+            return status;
         }
         HAL_Delay(1); // Small delay to prevent CPU spinning
     }
@@ -102,115 +549,554 @@ static esp_at_status_t esp_at_wait_response(const char *expected, uint32_t timeo
     return ESP_AT_TIMEOUT;
 }
 
-/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Reserve the next free slot at the tail of the command queue
+  * @retval Pointer to the zeroed slot, or NULL if the queue is full
+  */
+static esp_at_cmd_entry_t *esp_at_queue_alloc(void)
+{
+    if (q_count >= ESP_AT_CMD_QUEUE_LEN) {
+        return NULL;
+    }
+    esp_at_cmd_entry_t *e = &cmd_queue[(q_head + q_count) % ESP_AT_CMD_QUEUE_LEN];
+    memset(e, 0, sizeof(*e));
+    q_count++;
+    return e;
+}
 
-esp_at_status_t esp_at_init(UART_HandleTypeDef *huart)
+/**
+  * @brief  Most recently queued entry
+  * @retval Pointer to the tail slot (queue must not be empty)
+  */
+static esp_at_cmd_entry_t *esp_at_queue_tail(void)
 {
-    if (huart == NULL) {
-        return ESP_AT_ERROR;
+    return &cmd_queue[(q_head + q_count - 1) % ESP_AT_CMD_QUEUE_LEN];
+}
+
+/**
+  * @brief  Queue a command line, without the passthrough check
+  * @param  cmd: AT command string (without \r\n)
+  * @param  expected: Expected response string (NULL for "OK")
+  * @param  timeout_ms: Timeout in milliseconds
+  * @param  cb: Completion callback (may be NULL)
+  * @param  ctx: User context
+  * @retval Pointer to the queued slot, or NULL if full or too long
+  */
+static esp_at_cmd_entry_t *esp_at_queue_cmd(const char *cmd, const char *expected,
+                                            uint32_t timeout_ms, esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (strlen(cmd) + sizeof(AT_CMD_TERMINATOR) > ESP_AT_CMD_MAX_LEN) {
+        return NULL;
     }
-    
-    esp_huart = huart;
-    esp_state = ESP_STATE_IDLE;
-    esp_at_clear_rx_buffer();
-    
-    return ESP_AT_OK;
+
+    esp_at_cmd_entry_t *e = esp_at_queue_alloc();
+    if (e == NULL) {
+        return NULL;
+    }
+
+    e->cmd_len = snprintf(e->cmd, sizeof(e->cmd), "%s" AT_CMD_TERMINATOR, cmd);
+    e->expected = expected;
+    e->timeout_ms = timeout_ms;
+    e->cb = cb;
+    e->ctx = ctx;
+    return e;
 }
 
-esp_at_status_t esp_at_send_cmd(const char *cmd, uint32_t timeout_ms)
+/**
+  * @brief  Finish the command at the queue head and report it
+  * @note   On failure, the rest of a linked sequence is discarded and its
+  *         final entry reports the error instead.
+  * @param  status: Final status of the head command
+  */
+static void esp_at_async_complete(esp_at_status_t status)
 {
-    if (esp_huart == NULL) {
-        return ESP_AT_ERROR;
+    esp_at_cmd_entry_t *e = &cmd_queue[q_head];
+
+    if (status != ESP_AT_OK) {
+        while (e->linked && q_count > 1) {
+            q_head = (q_head + 1) % ESP_AT_CMD_QUEUE_LEN;
+            q_count--;
+            e = &cmd_queue[q_head];
+        }
     }
-    
-    // Send command
-    if (esp_at_send_string(cmd) != ESP_AT_OK) {
-        return ESP_AT_ERROR;
+
+    // Copy out before releasing the slot: the callback may enqueue again
+    esp_at_hook_t hook = e->hook;
+    esp_at_cmd_cb_t cb = e->cb;
+    void *ctx = e->ctx;
+
+    q_head = (q_head + 1) % ESP_AT_CMD_QUEUE_LEN;
+    q_count--;
+    async_phase = ESP_ASYNC_IDLE;
+
+    if (hook != NULL) {
+        hook(status);
     }
-    if (esp_at_send_string(AT_CMD_TERMINATOR) != ESP_AT_OK) {
-        return ESP_AT_ERROR;
+    if (cb != NULL) {
+        cb(status, rx_buffer, ctx);
     }
-    
-    // Wait for response
-    return esp_at_wait_response(NULL, timeout_ms);
 }
 
-esp_at_status_t esp_at_send_cmd_expect(const char *cmd, const char *expected_response, uint32_t timeout_ms)
+/**
+  * @brief  Start transmitting the command at the queue head
+  */
+static void esp_at_async_start_next(void)
 {
-    if (esp_huart == NULL) {
-        return ESP_AT_ERROR;
+    esp_at_cmd_entry_t *e = &cmd_queue[q_head];
+
+    esp_at_clear_rx_buffer();
+    async_start_tick = HAL_GetTick();
+
+    if (e->guard_ms > 0) {
+        async_phase = ESP_ASYNC_ESCAPE_GUARD; // "+++" goes out once the line is idle
+        return;
     }
-    
-    // Send command
-    if (esp_at_send_string(cmd) != ESP_AT_OK) {
+
+    if (HAL_UART_Transmit_IT(esp_huart, (uint8_t*)e->cmd, e->cmd_len) != HAL_OK) {
+        esp_at_async_complete(ESP_AT_ERROR);
+        return;
+    }
+    async_phase = ESP_ASYNC_TX_CMD;
+}
+
+/**
+  * @brief  Reprogram the ESP UART (blocking TX has already drained)
+  * @param  baud: New rate
+  * @param  flow_ctrl: true for RTS/CTS
+  * @retval esp_at_status_t
+  */
+static esp_at_status_t esp_at_uart_config(uint32_t baud, bool flow_ctrl)
+{
+    HAL_UART_AbortReceive(esp_huart);
+
+    esp_huart->Init.BaudRate = baud;
+    esp_huart->Init.HwFlowCtl = flow_ctrl ? UART_HWCONTROL_RTS_CTS : UART_HWCONTROL_NONE;
+    if (HAL_UART_Init(esp_huart) != HAL_OK) {
         return ESP_AT_ERROR;
     }
-    if (esp_at_send_string(AT_CMD_TERMINATOR) != ESP_AT_OK) {
+
+    // Bytes that straddled the switch are garbage
+    rx_head = 0;
+    rx_tail = 0;
+    if (HAL_UART_Receive_IT(esp_huart, &rx_it_byte, 1) != HAL_OK) {
         return ESP_AT_ERROR;
     }
-    
-    // Wait for specific response
-    return esp_at_wait_response(expected_response, timeout_ms);
+    return ESP_AT_OK;
 }
 
-esp_at_status_t esp_at_test(void)
+/**
+  * @brief  Queue a round-trip test of the current link settings
+  * @note   AT+GMR answers with a few hundred bytes back to back, so RX (and
+  *         RTS) is exercised at full rate, not just a 6-byte "OK". The
+  *         rounds are linked: the first failure reports to hook.
+  * @param  hook: Run with the overall result
+  */
+static void esp_at_queue_verify(esp_at_hook_t hook)
 {
-    esp_at_status_t status = esp_at_send_cmd("AT", ESP_AT_RESPONSE_TIMEOUT_MS);
-    if (status == ESP_AT_OK) {
-        esp_state = ESP_STATE_IDLE;
+    for (int i = 0; i < ESP_AT_BAUD_VERIFY_ROUNDS; i++) {
+        esp_at_queue_cmd("AT", RESPONSE_OK, ESP_AT_BAUD_TIMEOUT_MS, NULL, NULL)->linked = 1;
+        esp_at_queue_cmd("AT+GMR", RESPONSE_OK, ESP_AT_BAUD_TIMEOUT_MS, NULL, NULL)->linked = 1;
     }
-    return status;
+    esp_at_queue_tail()->linked = 0;
+    esp_at_queue_tail()->hook = hook;
 }
 
-esp_at_status_t esp_at_reset(void)
+/**
+  * @brief  Queue AT+UART_CUR for a rate
+  * @param  baud: Rate
+  * @param  flow_ctrl: true for RTS/CTS
+  * @param  hook: Run with the module's answer
+  */
+static void esp_at_queue_uart_cur(uint32_t baud, bool flow_ctrl, esp_at_hook_t hook)
 {
-    esp_state = ESP_STATE_INITIALIZING;
-    esp_at_status_t status = esp_at_send_cmd("AT+RST", 10000); // Reset takes longer
-    HAL_Delay(2000); // Give ESP32 time to boot after reset
-    
-    if (status == ESP_AT_OK || status == ESP_AT_TIMEOUT) {
-        // After reset, ESP32 may not respond immediately, so test again
-        HAL_Delay(1000);
-        status = esp_at_test();
+    char cmd[40];
+
+    snprintf(cmd, sizeof(cmd), "AT+UART_CUR=%lu,8,1,0,%u",
+             (unsigned long)baud, flow_ctrl ? 3U : 0U);
+    esp_at_queue_cmd(cmd, RESPONSE_OK, ESP_AT_BAUD_TIMEOUT_MS, NULL, NULL)->hook = hook;
+}
+
+/**
+  * @brief  Rate change finished (or gave up)
+  * @param  status: ESP_AT_OK if the link runs at the new rate
+  */
+static void esp_at_baud_done(esp_at_status_t status)
+{
+    baud_result = status;
+    if (status != ESP_AT_OK && baud_retry_no_flow && esp_state != ESP_STATE_ERROR) {
+        baud_retry_no_flow = false; // RTS/CTS not wired?
+        baud_new_flow = false;
+        boot_phase = ESP_BOOT_BAUD_SET;
+        return;
     }
-    
-    return status;
+    boot_phase = ESP_BOOT_DONE;
 }
 
-esp_at_status_t esp_at_set_wifi_mode(void)
+/* Hooks advancing the bring-up */
+static void esp_at_hook_boot_probe(esp_at_status_t status)
 {
-    return esp_at_send_cmd_expect("AT+CWMODE=1", RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS);
+    if (status == ESP_AT_OK && !urc_ready) {
+        boot_times.ready = HAL_GetTick();
+        boot_phase = ESP_BOOT_CWSTATE; // Already running (MCU-only reset)
+    } else {
+        boot_phase = ESP_BOOT_PROBE;
+    }
 }
 
-esp_at_status_t esp_at_connect_wifi(const char *ssid, const char *password)
+static void esp_at_hook_boot_cwstate(esp_at_status_t status)
 {
-    if (ssid == NULL || password == NULL) {
-        return ESP_AT_ERROR;
+    if (status == ESP_AT_OK && esp_at_parse_cwstate() == CWSTATE_GOT_IP) {
+        wifi_ip = 1;
+        boot_times.got_ip = HAL_GetTick();
     }
-    
-    esp_state = ESP_STATE_WIFI_CONNECTING;
-    
-    // Build command: AT+CWJAP="SSID","PASSWORD"
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "AT+CWJAP=\"%s\",\"%s\"", ssid, password);
-    
-    esp_at_status_t status = esp_at_send_cmd_expect(cmd, RESPONSE_OK, ESP_AT_WIFI_TIMEOUT_MS);
-    
-    if (status == ESP_AT_OK) {
-        esp_state = ESP_STATE_WIFI_CONNECTED;
-    } else {
-        esp_state = ESP_STATE_ERROR;
+    esp_at_baud_begin(ESP_AT_LINK_BAUD, ESP_AT_LINK_FLOW_CTRL, ESP_AT_LINK_FLOW_CTRL);
+}
+
+static void esp_at_hook_baud_set(esp_at_status_t status)
+{
+    if (status != ESP_AT_OK) {
+        esp_at_baud_done(ESP_AT_ERROR); // Refused: nothing changed
+        return;
     }
-    
-    return status;
+    boot_tick = HAL_GetTick();
+    boot_phase = ESP_BOOT_BAUD_SWITCH; // "OK" came at the old rate
 }
 
-esp_at_status_t esp_at_connect_tcp(const char *server_ip, uint16_t port)
+static void esp_at_hook_baud_verify(esp_at_status_t status)
 {
-    if (server_ip == NULL) {
-        return ESP_AT_ERROR;
+    if (status == ESP_AT_OK) {
+        esp_at_baud_done(ESP_AT_OK);
+        return;
     }
-    
+    // Fall back: the module is on the new rate, so tell it there (without
+    // flow control, in case that was the problem) and follow it back
+    esp_at_uart_config(baud_new, false);
+    boot_phase = ESP_BOOT_BAUD_REVERT;
+}
+
+static void esp_at_hook_baud_revert(esp_at_status_t status)
+{
+    (void)status; // Verified after the switch either way
+    boot_tick = HAL_GetTick();
+    boot_phase = ESP_BOOT_BAUD_RESTORE;
+}
+
+static void esp_at_hook_baud_restore(esp_at_status_t status)
+{
+    if (status != ESP_AT_OK) {
+        esp_state = ESP_STATE_ERROR; // Out of step; only a module reset recovers
+    }
+    esp_at_baud_done(ESP_AT_ERROR);
+}
+
+/**
+  * @brief  Start a rate change as bring-up steps
+  * @param  baud: New rate (0: nothing to do)
+  * @param  flow_ctrl: true for RTS/CTS
+  * @param  retry_no_flow: On failure, try the same rate without RTS/CTS
+  */
+static void esp_at_baud_begin(uint32_t baud, bool flow_ctrl, bool retry_no_flow)
+{
+    baud_result = ESP_AT_OK;
+    if (baud == 0) {
+        boot_phase = ESP_BOOT_DONE;
+        return;
+    }
+    baud_new = baud;
+    baud_new_flow = flow_ctrl;
+    baud_old = esp_huart->Init.BaudRate;
+    baud_old_flow = (esp_huart->Init.HwFlowCtl != UART_HWCONTROL_NONE);
+    baud_retry_no_flow = retry_no_flow && flow_ctrl;
+    boot_phase = ESP_BOOT_BAUD_SET;
+}
+
+/**
+  * @brief  Run the next bring-up step; called by esp_at_poll() while the
+  *         command queue is empty
+  */
+static void esp_at_boot_step(void)
+{
+    uint32_t elapsed = HAL_GetTick() - boot_tick;
+
+    switch (boot_phase) {
+    case ESP_BOOT_PROBE:
+        if (urc_ready) {
+            esp_at_baud_begin(ESP_AT_LINK_BAUD, ESP_AT_LINK_FLOW_CTRL, ESP_AT_LINK_FLOW_CTRL);
+        } else if (elapsed >= ESP_AT_BOOT_TIMEOUT_MS) {
+            boot_phase = ESP_BOOT_DONE; // Module absent: keep the CubeMX rate
+        } else {
+            esp_at_queue_cmd("AT", RESPONSE_OK, ESP_AT_READY_PROBE_MS, NULL, NULL)->hook =
+                esp_at_hook_boot_probe;
+            boot_phase = ESP_BOOT_WAIT;
+        }
+        break;
+
+    case ESP_BOOT_CWSTATE:
+        esp_at_queue_cmd("AT+CWSTATE?", NULL, ESP_AT_RESPONSE_TIMEOUT_MS, NULL, NULL)->hook =
+            esp_at_hook_boot_cwstate;
+        boot_phase = ESP_BOOT_WAIT;
+        break;
+
+    case ESP_BOOT_BAUD_SET:
+        esp_at_queue_uart_cur(baud_new, baud_new_flow, esp_at_hook_baud_set);
+        boot_phase = ESP_BOOT_WAIT;
+        break;
+
+    case ESP_BOOT_BAUD_SWITCH:
+        if (elapsed < ESP_AT_BAUD_SWITCH_MS) {
+            break;
+        }
+        if (esp_at_uart_config(baud_new, baud_new_flow) != ESP_AT_OK) {
+            esp_at_hook_baud_verify(ESP_AT_ERROR);
+            break;
+        }
+        esp_at_queue_verify(esp_at_hook_baud_verify);
+        boot_phase = ESP_BOOT_WAIT;
+        break;
+
+    case ESP_BOOT_BAUD_REVERT:
+        esp_at_queue_uart_cur(baud_old, baud_old_flow, esp_at_hook_baud_revert);
+        boot_phase = ESP_BOOT_WAIT;
+        break;
+
+    case ESP_BOOT_BAUD_RESTORE:
+        if (elapsed < ESP_AT_BAUD_SWITCH_MS) {
+            break;
+        }
+        if (esp_at_uart_config(baud_old, baud_old_flow) != ESP_AT_OK) {
+            esp_at_hook_baud_restore(ESP_AT_ERROR);
+            break;
+        }
+        esp_at_queue_verify(esp_at_hook_baud_restore);
+        boot_phase = ESP_BOOT_WAIT;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+  * @brief  Drive the bring-up to the end (blocking callers)
+  * @retval Result of the last rate change
+  */
+static esp_at_status_t esp_at_boot_run(void)
+{
+    while (boot_phase != ESP_BOOT_DONE) {
+        esp_at_poll();
+        HAL_Delay(1); // Same cadence as TaskNet
+    }
+    return baud_result;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+esp_at_status_t esp_at_init_async(UART_HandleTypeDef *huart)
+{
+    if (huart == NULL) {
+        return ESP_AT_ERROR;
+    }
+    
+    esp_huart = huart;
+    esp_state = ESP_STATE_IDLE;
+    esp_at_clear_rx_buffer();
+    
+    rx_head = 0;
+    rx_tail = 0;
+    q_head = 0;
+    q_count = 0;
+    async_phase = ESP_ASYNC_IDLE;
+    http_tx_busy = 0;
+    passthrough = 0;
+    
+    urc_len = 0;
+    join_wait = 0;
+    ipd_state = IPD_SCAN;
+    ipd_match = 0;
+    http_line_len = 0;
+    http_in_headers = 0;
+    http_sent_tick = 0;
+    
+    base_baud = huart->Init.BaudRate;
+    base_flow_ctrl = (huart->Init.HwFlowCtl != UART_HWCONTROL_NONE);
+    esp_at_boot_begin();
+    
+    // Start interrupt-driven reception into rx_ring
+    if (HAL_UART_Receive_IT(esp_huart, &rx_it_byte, 1) != HAL_OK) {
+        return ESP_AT_ERROR;
+    }
+    
+    // Probe, CWSTATE and rate negotiation follow from esp_at_poll()
+    boot_tick = boot_times.start;
+    boot_phase = ESP_BOOT_PROBE;
+    return ESP_AT_OK;
+}
+
+esp_at_status_t esp_at_init(UART_HandleTypeDef *huart)
+{
+    esp_at_status_t status = esp_at_init_async(huart);
+
+    if (status == ESP_AT_OK) {
+        esp_at_boot_run(); // A failed rate change keeps the CubeMX rate
+    }
+    return status;
+}
+
+esp_at_status_t esp_at_set_baud(uint32_t baud, bool flow_ctrl)
+{
+    if (esp_huart == NULL) {
+        return ESP_AT_ERROR;
+    }
+    if (esp_at_is_busy() || passthrough) {
+        return ESP_AT_BUSY;
+    }
+
+    esp_at_baud_begin(baud, flow_ctrl, false);
+    return esp_at_boot_run();
+}
+
+uint32_t esp_at_get_baud(void)
+{
+    return (esp_huart != NULL) ? esp_huart->Init.BaudRate : 0;
+}
+
+bool esp_at_wifi_has_ip(void)
+{
+    return wifi_ip != 0;
+}
+
+const esp_at_boot_times_t *esp_at_get_boot_times(void)
+{
+    return &boot_times;
+}
+
+const esp_at_http_stats_t *esp_at_get_http_stats(void)
+{
+    return &http_stats;
+}
+
+esp_at_status_t esp_at_send_cmd(const char *cmd, uint32_t timeout_ms)
+{
+    if (esp_huart == NULL) {
+        return ESP_AT_ERROR;
+    }
+    if (esp_at_is_busy() || passthrough) {
+        return ESP_AT_BUSY; // Asynchronous engine owns the link
+    }
+    
+    // Send command
+    if (esp_at_send_string(cmd) != ESP_AT_OK) {
+        return ESP_AT_ERROR;
+    }
+    if (esp_at_send_string(AT_CMD_TERMINATOR) != ESP_AT_OK) {
+        return ESP_AT_ERROR;
+    }
+    
+    // Wait for response
+    return esp_at_wait_response(NULL, timeout_ms);
+}
+
+esp_at_status_t esp_at_send_cmd_expect(const char *cmd, const char *expected_response, uint32_t timeout_ms)
+{
+    if (esp_huart == NULL) {
+        return ESP_AT_ERROR;
+    }
+    if (esp_at_is_busy() || passthrough) {
+        return ESP_AT_BUSY; // Asynchronous engine owns the link
+    }
+    
+    // Send command
+    if (esp_at_send_string(cmd) != ESP_AT_OK) {
+        return ESP_AT_ERROR;
+    }
+    if (esp_at_send_string(AT_CMD_TERMINATOR) != ESP_AT_OK) {
+        return ESP_AT_ERROR;
+    }
+    
+    // Wait for specific response
+    return esp_at_wait_response(expected_response, timeout_ms);
+}
+
+esp_at_status_t esp_at_test(void)
+{
+    esp_at_status_t status = esp_at_send_cmd("AT", ESP_AT_RESPONSE_TIMEOUT_MS);
+    if (status == ESP_AT_OK) {
+        esp_state = ESP_STATE_IDLE;
+    }
+    return status;
+}
+
+esp_at_status_t esp_at_reset(void)
+{
+    esp_state = ESP_STATE_INITIALIZING;
+    esp_at_boot_begin();
+    esp_at_status_t status = esp_at_send_cmd("AT+RST", ESP_AT_RESPONSE_TIMEOUT_MS);
+    
+    // AT+UART_CUR does not survive a reset: follow the module back
+    if (esp_huart != NULL &&
+        (esp_huart->Init.BaudRate != base_baud ||
+         (esp_huart->Init.HwFlowCtl != UART_HWCONTROL_NONE) != base_flow_ctrl)) {
+        esp_at_uart_config(base_baud, base_flow_ctrl);
+    }
+    
+    if (status == ESP_AT_OK || status == ESP_AT_TIMEOUT) {
+        // Continue as soon as the module prints "ready" instead of sleeping
+        // through a worst-case boot; probe once if it was missed
+        if (esp_at_wait_ready(ESP_AT_BOOT_TIMEOUT_MS) == ESP_AT_OK) {
+            esp_state = ESP_STATE_IDLE;
+            status = ESP_AT_OK;
+        } else {
+            status = esp_at_test();
+        }
+    }
+    
+    if (status == ESP_AT_OK) {
+        esp_at_baud_begin(ESP_AT_LINK_BAUD, ESP_AT_LINK_FLOW_CTRL, ESP_AT_LINK_FLOW_CTRL);
+        esp_at_boot_run();
+    }
+    return status;
+}
+
+esp_at_status_t esp_at_set_wifi_mode(void)
+{
+    return esp_at_send_cmd_expect("AT+CWMODE=1", RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS);
+}
+
+esp_at_status_t esp_at_connect_wifi(const char *ssid, const char *password)
+{
+    if (ssid == NULL || password == NULL) {
+        return ESP_AT_ERROR;
+    }
+    
+    // Stored AP already rejoined after boot
+    if (wifi_ip) {
+        esp_state = ESP_STATE_WIFI_CONNECTED;
+        return ESP_AT_OK;
+    }
+    
+    esp_state = ESP_STATE_WIFI_CONNECTING;
+    
+    // Build command: AT+CWJAP="SSID","PASSWORD"
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "AT+CWJAP=\"%s\",\"%s\"", ssid, password);
+    
+    esp_at_status_t status = esp_at_send_cmd_expect(cmd, RESPONSE_OK, ESP_AT_WIFI_TIMEOUT_MS);
+    
+    if (status == ESP_AT_OK) {
+        esp_state = ESP_STATE_WIFI_CONNECTED;
+    } else {
+        esp_state = ESP_STATE_ERROR;
+    }
+    
+    return status;
+}
+
+esp_at_status_t esp_at_connect_tcp(const char *server_ip, uint16_t port)
+{
+    if (server_ip == NULL) {
+        return ESP_AT_ERROR;
+    }
+    
     esp_state = ESP_STATE_TCP_CONNECTING;
     
     // Build command: AT+CIPSTART="TCP","IP",PORT
@@ -233,41 +1119,54 @@ esp_at_status_t esp_at_send_http_post(const char *endpoint, const char *json_dat
     if (endpoint == NULL || json_data == NULL || json_len == 0) {
         return ESP_AT_ERROR;
     }
-    
+    if (http_tx_busy || passthrough) {
+        return ESP_AT_BUSY;
+    }
+
     // Build HTTP POST request
     // Note: Host header should contain server IP or domain
     // For simplicity, we'll use a placeholder that the server can handle
-    char http_request[512];
-    int http_len = snprintf(http_request, sizeof(http_request),
-        "POST %s HTTP/1.1\r\n"
-        "Host: localhost\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %u\r\n"
-        "\r\n"
-        "%s",
-        endpoint, json_len, json_data);
-    
-    if (http_len < 0 || http_len >= (int)sizeof(http_request)) {
+    const char *http_request;
+    int http_len = esp_at_build_http_post(endpoint, "application/json",
+                                          (const uint8_t*)json_data, json_len, &http_request);
+    if (http_len < 0) {
         return ESP_AT_ERROR;
     }
-    
+
     // Send AT+CIPSEND command
     char cipsend_cmd[32];
     snprintf(cipsend_cmd, sizeof(cipsend_cmd), "AT+CIPSEND=%d", http_len);
-    
+
     esp_at_status_t status = esp_at_send_cmd_expect(cipsend_cmd, RESPONSE_PROMPT, ESP_AT_RESPONSE_TIMEOUT_MS);
     if (status != ESP_AT_OK) {
         return status;
     }
-    
+
     // Send HTTP request data
-    status = esp_at_send_string(http_request);
-    if (status != ESP_AT_OK) {
-        return status;
+    esp_at_http_begin();
+    if (HAL_UART_Transmit(esp_huart, (uint8_t*)http_request, (uint16_t)http_len,
+                          HAL_MAX_DELAY) != HAL_OK) {
+        return ESP_AT_ERROR;
     }
-    
+
     // Wait for response (SEND OK)
-    return esp_at_wait_response(RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS);
+    status = esp_at_wait_response(RESPONSE_SEND_OK, ESP_AT_RESPONSE_TIMEOUT_MS);
+#if ESP_AT_HTTP_WAIT_RESPONSE
+    // Then for the server's status line and headers
+    uint32_t start_time = HAL_GetTick();
+    while (status == ESP_AT_OK && !http_resp_done) {
+        if ((HAL_GetTick() - start_time) >= ESP_AT_HTTP_RESPONSE_TIMEOUT_MS) {
+            http_stats.timeouts++;
+            return ESP_AT_TIMEOUT;
+        }
+        esp_at_rx_drain();
+        HAL_Delay(1);
+    }
+    if (status == ESP_AT_OK) {
+        status = esp_at_http_result();
+    }
+#endif
+    return status;
 }
 
 esp_at_status_t esp_at_close_tcp(void)
@@ -310,3 +1209,712 @@ esp_at_status_t esp_at_init_wifi(const char *ssid, const char *password)
     return ESP_AT_OK;
 }
 
+/* Asynchronous command engine ----------------------------------------------*/
+
+/* Completion hooks keeping esp_state in step with the queued sequences */
+static void esp_at_hook_wifi(esp_at_status_t status)
+{
+    esp_state = (status == ESP_AT_OK) ? ESP_STATE_WIFI_CONNECTED : ESP_STATE_ERROR;
+    if (status == ESP_AT_OK) {
+        wifi_ip = 1;
+        if (boot_times.got_ip == 0) {
+            boot_times.got_ip = HAL_GetTick();
+        }
+    }
+}
+
+static void esp_at_hook_tcp(esp_at_status_t status)
+{
+    esp_state = (status == ESP_AT_OK) ? ESP_STATE_TCP_CONNECTED : ESP_STATE_ERROR;
+    if (status == ESP_AT_OK && boot_times.link_up == 0) {
+        boot_times.link_up = HAL_GetTick();
+    }
+}
+
+static void esp_at_hook_http(esp_at_status_t status)
+{
+    http_tx_busy = 0;
+    if ((status == ESP_AT_OK || status == ESP_AT_HTTP_ERROR) && boot_times.first_send == 0) {
+        boot_times.first_send = HAL_GetTick();
+    }
+}
+
+/* Raw send (UDP datagram): no HTTP exchange, only the buffer to release */
+static void esp_at_hook_send(esp_at_status_t status)
+{
+    (void)status;
+    http_tx_busy = 0;
+}
+
+/**
+  * @brief  Finish esp_at_init_wifi_async() without (further) commands
+  */
+static void esp_at_join_done(esp_at_status_t status)
+{
+    esp_at_cmd_cb_t cb = join_cb;
+
+    join_wait = 0;
+    join_cb = NULL;
+    esp_at_hook_wifi(status);
+    if (cb != NULL) {
+        cb(status, rx_buffer, join_ctx);
+    }
+}
+
+/**
+  * @brief  Queue the full join: station mode, auto-connect, AT+CWJAP
+  */
+static void esp_at_join_full(void)
+{
+    join_wait = 0;
+    if (ESP_AT_CMD_QUEUE_LEN - q_count < 3) {
+        esp_at_join_done(ESP_AT_BUSY);
+        return;
+    }
+
+    esp_at_queue_cmd("AT+CWMODE=1", RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS, NULL, NULL)->linked = 1;
+#if ESP_AT_AUTOCONN
+    esp_at_queue_cmd("AT+CWAUTOCONN=1", RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS, NULL, NULL)->linked = 1;
+#endif
+    esp_at_queue_cmd(join_cmd, RESPONSE_OK, ESP_AT_WIFI_TIMEOUT_MS, join_cb, join_ctx)->hook = esp_at_hook_wifi;
+    join_cb = NULL;
+}
+
+/* AT+CWSTATE? decides between nothing to do, waiting, and a full join */
+static void esp_at_hook_cwstate(esp_at_status_t status)
+{
+    int state = (status == ESP_AT_OK) ? esp_at_parse_cwstate() : -1;
+
+    if (status == ESP_AT_TIMEOUT) {
+        esp_at_join_done(status); // Module not answering
+    } else if (state == CWSTATE_GOT_IP) {
+        esp_at_join_done(ESP_AT_OK);
+#if ESP_AT_AUTOCONN
+    } else if (state == CWSTATE_CONNECTED || state == CWSTATE_CONNECTING) {
+        join_wait = 1;
+        join_deadline = HAL_GetTick() + ESP_AT_AUTOCONN_WAIT_MS;
+#endif
+    } else {
+        esp_at_join_full(); // Idle, disconnected, or ESP-AT without CWSTATE
+    }
+}
+
+static void esp_at_hook_passthrough_enter(esp_at_status_t status)
+{
+    passthrough = (status == ESP_AT_OK);
+    last_tx_tick = HAL_GetTick();
+}
+
+static void esp_at_hook_passthrough_exit(esp_at_status_t status)
+{
+    if (status == ESP_AT_OK) {
+        passthrough = 0;
+    }
+}
+
+void esp_at_uart_rx_callback(UART_HandleTypeDef *huart)
+{
+    if (huart != esp_huart) {
+        return;
+    }
+
+    uint16_t next = (rx_head + 1) & (ESP_AT_RX_RING_SIZE - 1);
+    if (next != rx_tail) {
+        rx_ring[rx_head] = rx_it_byte;
+        rx_head = next;
+    } else {
+        rx_overflows++; // Drop byte, poll loop is too slow
+    }
+
+    HAL_UART_Receive_IT(esp_huart, &rx_it_byte, 1);
+}
+
+void esp_at_uart_error_callback(UART_HandleTypeDef *huart)
+{
+    if (huart != esp_huart) {
+        return;
+    }
+
+    // HAL aborts reception on overrun/framing errors, so re-arm it
+    HAL_UART_Receive_IT(esp_huart, &rx_it_byte, 1);
+}
+
+esp_at_status_t esp_at_enqueue_cmd(const char *cmd, const char *expected_response,
+                                   uint32_t timeout_ms, esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (esp_huart == NULL || cmd == NULL) {
+        return ESP_AT_ERROR;
+    }
+    if (strlen(cmd) + sizeof(AT_CMD_TERMINATOR) > ESP_AT_CMD_MAX_LEN) {
+        return ESP_AT_ERROR;
+    }
+    if (passthrough) {
+        return ESP_AT_BUSY; // Would be sent as data; exit passthrough first
+    }
+    if (boot_phase != ESP_BOOT_DONE) {
+        return ESP_AT_BUSY; // Bring-up still probing or switching the rate
+    }
+
+    if (esp_at_queue_cmd(cmd, expected_response, timeout_ms, cb, ctx) == NULL) {
+        return ESP_AT_BUSY;
+    }
+    return ESP_AT_OK;
+}
+
+esp_at_status_t esp_at_init_wifi_async(const char *ssid, const char *password,
+                                       esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (ssid == NULL || password == NULL) {
+        return ESP_AT_ERROR;
+    }
+    // Room for the full join queued from the CWSTATE hook
+    if (ESP_AT_CMD_QUEUE_LEN - q_count < 4 || join_wait || join_cb != NULL ||
+        boot_phase != ESP_BOOT_DONE) {
+        return ESP_AT_BUSY;
+    }
+
+    // Build command: AT+CWJAP="SSID","PASSWORD"
+    int len = snprintf(join_cmd, sizeof(join_cmd), "AT+CWJAP=\"%s\",\"%s\"", ssid, password);
+    if (len < 0 || len + sizeof(AT_CMD_TERMINATOR) > ESP_AT_CMD_MAX_LEN) {
+        return ESP_AT_ERROR;
+    }
+
+    if (passthrough) {
+        return ESP_AT_BUSY;
+    }
+
+    join_cb = cb;
+    join_ctx = ctx;
+    esp_at_queue_cmd("AT+CWSTATE?", NULL, ESP_AT_RESPONSE_TIMEOUT_MS, NULL, NULL)->hook = esp_at_hook_cwstate;
+
+    esp_state = ESP_STATE_WIFI_CONNECTING;
+    return ESP_AT_OK;
+}
+
+esp_at_status_t esp_at_connect_tcp_async(const char *server_ip, uint16_t port,
+                                         esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (server_ip == NULL) {
+        return ESP_AT_ERROR;
+    }
+
+    // Build command: AT+CIPSTART="TCP","IP",PORT
+    char cmd[ESP_AT_CMD_MAX_LEN];
+    snprintf(cmd, sizeof(cmd), "AT+CIPSTART=\"TCP\",\"%s\",%u", server_ip, port);
+
+    esp_at_status_t status = esp_at_enqueue_cmd(cmd, RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS, cb, ctx);
+    if (status != ESP_AT_OK) {
+        return status;
+    }
+    esp_at_queue_tail()->hook = esp_at_hook_tcp;
+
+    esp_state = ESP_STATE_TCP_CONNECTING;
+    return ESP_AT_OK;
+}
+
+/**
+  * @brief  Frame an HTTP POST in http_tx_buffer and queue its CIPSEND
+  * @param  endpoint: HTTP endpoint
+  * @param  content_type: Content-Type header value
+  * @param  body: Request body (may be binary), copied unless already in place
+  * @param  body_len: Body length
+  * @param  cb: Completion callback
+  * @param  ctx: User context
+  * @retval esp_at_status_t
+  */
+static esp_at_status_t esp_at_queue_http_post(const char *endpoint, const char *content_type,
+                                              const uint8_t *body, uint16_t body_len,
+                                              esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (endpoint == NULL || body == NULL || body_len == 0) {
+        return ESP_AT_ERROR;
+    }
+    if (http_tx_busy || passthrough || q_count >= ESP_AT_CMD_QUEUE_LEN ||
+        boot_phase != ESP_BOOT_DONE) {
+        return ESP_AT_BUSY;
+    }
+
+    const char *request;
+    int http_len = esp_at_build_http_post(endpoint, content_type, body, body_len, &request);
+    if (http_len < 0) {
+        return ESP_AT_ERROR;
+    }
+
+    char cipsend_cmd[32];
+    snprintf(cipsend_cmd, sizeof(cipsend_cmd), "AT+CIPSEND=%d", http_len);
+
+    esp_at_cmd_entry_t *e = esp_at_queue_cmd(cipsend_cmd, RESPONSE_PROMPT,
+                                             ESP_AT_RESPONSE_TIMEOUT_MS, cb, ctx);
+    e->payload = (const uint8_t*)request;
+    e->payload_len = (uint16_t)http_len;
+    e->hook = esp_at_hook_http;
+    e->http_resp = ESP_AT_HTTP_WAIT_RESPONSE;
+
+    http_tx_busy = 1;
+    return ESP_AT_OK;
+}
+
+/**
+  * @brief  Frame an HTTP POST (headers + body) in http_tx_buffer
+  * @note   The body sits at http_body (moved there unless the caller
+  *         serialized it in place); the request line and headers are written
+  *         backwards into the reserved gap in front of it, so the body is
+  *         never copied behind a formatted header.
+  * @param  endpoint: HTTP endpoint
+  * @param  content_type: Content-Type header value
+  * @param  body: Request body (may be binary), NULL to frame the headers only
+  * @param  body_len: Body length
+  * @param  request: Receives the start of the request
+  * @retval Request length, or -1 if it does not fit
+  */
+static int esp_at_build_http_post(const char *endpoint, const char *content_type,
+                                  const uint8_t *body, uint16_t body_len, const char **request)
+{
+    char *p = http_body;
+    char digits[6];
+    uint8_t n = sizeof(digits) - 1;
+    uint16_t v = body_len;
+
+    if (body_len > sizeof(http_tx_buffer) - ESP_AT_HTTP_HEADER_RESERVE) {
+        return -1;
+    }
+    if (body != NULL && body != (const uint8_t*)http_body) {
+        memmove(http_body, body, body_len);
+    }
+
+    digits[n] = '\0';
+    do {
+        digits[--n] = (char)('0' + v % 10U);
+        v /= 10U;
+    } while (v > 0);
+
+    if (esp_at_http_prepend(&p, "\r\n\r\n") != 0 ||
+        esp_at_http_prepend(&p, &digits[n]) != 0 ||
+        esp_at_http_prepend(&p, "\r\nContent-Length: ") != 0 ||
+        (http_boot_id != NULL &&
+         (esp_at_http_prepend(&p, http_boot_id) != 0 ||
+          esp_at_http_prepend(&p, "\r\nX-Boot-Id: ") != 0)) ||
+        (http_device_id != NULL &&
+         (esp_at_http_prepend(&p, http_device_id) != 0 ||
+          esp_at_http_prepend(&p, "\r\nX-Device-Id: ") != 0)) ||
+        esp_at_http_prepend(&p, content_type) != 0 ||
+        esp_at_http_prepend(&p, " HTTP/1.1\r\nHost: localhost\r\nContent-Type: ") != 0 ||
+        esp_at_http_prepend(&p, endpoint) != 0 ||
+        esp_at_http_prepend(&p, "POST ") != 0) {
+        return -1;
+    }
+
+    *request = p;
+    return (int)(http_body - p) + body_len;
+}
+
+/**
+  * @brief  Write a string immediately in front of *p, moving *p back
+  * @param  p: Current start of the framed request
+  * @param  str: Text to prepend
+  * @retval 0 on success, -1 if the header reserve is exhausted
+  */
+static int esp_at_http_prepend(char **p, const char *str)
+{
+    size_t len = strlen(str);
+
+    if ((size_t)(*p - http_tx_buffer) < len) {
+        return -1;
+    }
+    *p -= len;
+    memcpy(*p, str, len);
+    return 0;
+}
+
+void esp_at_set_http_device_id(const char *id)
+{
+    http_device_id = id;
+}
+
+void esp_at_set_http_boot_id(const char *id)
+{
+    http_boot_id = id;
+}
+
+uint8_t *esp_at_http_body_buffer(uint16_t *capacity)
+{
+    if (http_tx_busy || (esp_huart != NULL && esp_huart->gState != HAL_UART_STATE_READY)) {
+        return NULL; // Queued or still shifting out
+    }
+    *capacity = sizeof(http_tx_buffer) - ESP_AT_HTTP_HEADER_RESERVE;
+    return (uint8_t*)http_body;
+}
+
+esp_at_status_t esp_at_connect_udp_async(const char *server_ip, uint16_t port, uint16_t local_port,
+                                         esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (server_ip == NULL) {
+        return ESP_AT_ERROR;
+    }
+
+    // Build command: AT+CIPSTART="UDP","IP",PORT,LOCAL_PORT,0 (fixed peer)
+    char cmd[ESP_AT_CMD_MAX_LEN];
+    snprintf(cmd, sizeof(cmd), "AT+CIPSTART=\"UDP\",\"%s\",%u,%u,0", server_ip, port, local_port);
+
+    esp_at_status_t status = esp_at_enqueue_cmd(cmd, RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS, cb, ctx);
+    if (status != ESP_AT_OK) {
+        return status;
+    }
+    esp_at_queue_tail()->hook = esp_at_hook_tcp; // Same connection states as TCP
+
+    esp_state = ESP_STATE_TCP_CONNECTING;
+    return ESP_AT_OK;
+}
+
+esp_at_status_t esp_at_send_data_async(const uint8_t *data, uint16_t len,
+                                       esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (data == NULL || len == 0 || len > sizeof(http_tx_buffer) ||
+        (data == (const uint8_t*)http_body && len > sizeof(http_tx_buffer) - ESP_AT_HTTP_HEADER_RESERVE)) {
+        return ESP_AT_ERROR;
+    }
+    if (http_tx_busy || passthrough || q_count >= ESP_AT_CMD_QUEUE_LEN ||
+        boot_phase != ESP_BOOT_DONE) {
+        return ESP_AT_BUSY;
+    }
+
+    if (data != (const uint8_t*)http_body) {
+        memcpy(http_tx_buffer, data, len);
+        data = (const uint8_t*)http_tx_buffer;
+    }
+
+    char cipsend_cmd[32];
+    snprintf(cipsend_cmd, sizeof(cipsend_cmd), "AT+CIPSEND=%u", len);
+
+    esp_at_cmd_entry_t *e = esp_at_queue_cmd(cipsend_cmd, RESPONSE_PROMPT,
+                                             ESP_AT_RESPONSE_TIMEOUT_MS, cb, ctx);
+    e->payload = data;
+    e->payload_len = len;
+    e->hook = esp_at_hook_send;
+
+    http_tx_busy = 1;
+    return ESP_AT_OK;
+}
+
+esp_at_status_t esp_at_send_http_post_async(const char *endpoint, const char *json_data,
+                                            uint16_t json_len, esp_at_cmd_cb_t cb, void *ctx)
+{
+    return esp_at_queue_http_post(endpoint, "application/json",
+                                  (const uint8_t*)json_data, json_len, cb, ctx);
+}
+
+esp_at_status_t esp_at_send_http_post_bin_async(const char *endpoint, const uint8_t *data,
+                                                uint16_t len, esp_at_cmd_cb_t cb, void *ctx)
+{
+    return esp_at_queue_http_post(endpoint, "application/octet-stream", data, len, cb, ctx);
+}
+
+esp_at_status_t esp_at_send_http_post_stream_async(const char *endpoint, const char *content_type,
+                                                   uint16_t body_len, esp_at_body_fn_t body_fn,
+                                                   void *body_ctx, esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (endpoint == NULL || body_fn == NULL || body_len == 0) {
+        return ESP_AT_ERROR;
+    }
+    if (http_tx_busy || passthrough || q_count >= ESP_AT_CMD_QUEUE_LEN ||
+        boot_phase != ESP_BOOT_DONE) {
+        return ESP_AT_BUSY;
+    }
+
+    const char *request;
+    int http_len = esp_at_build_http_post(endpoint, content_type, NULL, body_len, &request);
+    if (http_len < 0) {
+        return ESP_AT_ERROR;
+    }
+
+    char cipsend_cmd[32];
+    snprintf(cipsend_cmd, sizeof(cipsend_cmd), "AT+CIPSEND=%d", http_len);
+
+    esp_at_cmd_entry_t *e = esp_at_queue_cmd(cipsend_cmd, RESPONSE_PROMPT,
+                                             ESP_AT_RESPONSE_TIMEOUT_MS, cb, ctx);
+    e->payload = (const uint8_t*)request;
+    e->payload_len = (uint16_t)(http_len - body_len); // Headers; the body follows
+    e->body_fn = body_fn;
+    e->body_ctx = body_ctx;
+    e->body_left = body_len;
+    e->hook = esp_at_hook_http;
+    e->http_resp = ESP_AT_HTTP_WAIT_RESPONSE;
+
+    http_tx_busy = 1;
+    return ESP_AT_OK;
+}
+
+/**
+  * @brief  Pull the next chunk of a streamed body and start sending it
+  * @note   A failed producer is not asked again: the rest goes out as spaces
+  *         so the module sees the length it was promised.
+  * @param  e: Queue head in ESP_ASYNC_TX_PAYLOAD, body_left > 0
+  * @retval ESP_AT_OK if the chunk is on its way
+  */
+static esp_at_status_t esp_at_body_next(esp_at_cmd_entry_t *e)
+{
+    uint16_t size = (e->body_left < sizeof(http_chunk)) ? e->body_left : sizeof(http_chunk);
+    int n = e->body_failed ? -1 : e->body_fn(http_chunk, size, e->body_ctx);
+
+    if (n <= 0 || n > size) {
+        e->body_failed = 1;
+        memset(http_chunk, ' ', size);
+        n = size;
+    }
+    if (HAL_UART_Transmit_IT(esp_huart, http_chunk, (uint16_t)n) != HAL_OK) {
+        return ESP_AT_ERROR;
+    }
+    e->body_left -= (uint16_t)n;
+    async_start_tick = HAL_GetTick(); // The timeout covers one chunk, not the body
+    return ESP_AT_OK;
+}
+
+void esp_at_poll(void)
+{
+    if (esp_huart == NULL) {
+        return;
+    }
+
+    esp_at_rx_drain();
+
+    // Stored-AP rejoin: "WIFI GOT IP", or give up and join explicitly
+    if (join_wait) {
+        if (wifi_ip) {
+            esp_at_join_done(ESP_AT_OK);
+        } else if ((int32_t)(HAL_GetTick() - join_deadline) >= 0) {
+            esp_at_join_full();
+        }
+    }
+
+    if (async_phase == ESP_ASYNC_IDLE) {
+        if (q_count == 0 && boot_phase != ESP_BOOT_DONE) {
+            esp_at_boot_step(); // Bring-up owns the link until it is done
+        }
+        if (q_count > 0) {
+            esp_at_async_start_next();
+        }
+        return;
+    }
+
+    esp_at_cmd_entry_t *e = &cmd_queue[q_head];
+    esp_at_status_t status;
+
+    switch (async_phase) {
+    case ESP_ASYNC_TX_CMD:
+        if (esp_huart->gState == HAL_UART_STATE_READY) {
+            if (e->guard_ms > 0) {
+                async_start_tick = HAL_GetTick();
+                async_phase = ESP_ASYNC_ESCAPE_WAIT;
+            } else {
+                async_phase = ESP_ASYNC_WAIT_RESPONSE;
+            }
+        }
+        break;
+
+    case ESP_ASYNC_ESCAPE_GUARD:
+        // "+++" is only recognized when surrounded by idle time
+        if (esp_huart->gState == HAL_UART_STATE_READY &&
+            (HAL_GetTick() - last_tx_tick) >= ESP_AT_ESCAPE_GUARD_MS) {
+            if (HAL_UART_Transmit_IT(esp_huart, (uint8_t*)e->cmd, e->cmd_len) != HAL_OK) {
+                esp_at_async_complete(ESP_AT_ERROR);
+                return;
+            }
+            async_phase = ESP_ASYNC_TX_CMD;
+        }
+        break;
+
+    case ESP_ASYNC_ESCAPE_WAIT:
+        if ((HAL_GetTick() - async_start_tick) >= e->guard_ms) {
+            esp_at_async_complete(ESP_AT_OK);
+            return;
+        }
+        break;
+
+    case ESP_ASYNC_WAIT_RESPONSE:
+        status = esp_at_match_response(e->expected);
+        if (status == ESP_AT_OK && e->payload != NULL) {
+            // Prompt received: stream the payload, then wait for SEND OK
+            esp_at_clear_rx_buffer();
+            if (e->hook == esp_at_hook_http) {
+                esp_at_http_begin(); // RTT runs from here to the status line
+            }
+            if (HAL_UART_Transmit_IT(esp_huart, (uint8_t*)e->payload, e->payload_len) != HAL_OK) {
+                esp_at_async_complete(ESP_AT_ERROR);
+                return;
+            }
+            async_start_tick = HAL_GetTick();
+            async_phase = ESP_ASYNC_TX_PAYLOAD;
+            return;
+        }
+        if (status != ESP_AT_BUSY) {
+            esp_at_async_complete(status);
+            return;
+        }
+        break;
+
+    case ESP_ASYNC_TX_PAYLOAD:
+        if (esp_huart->gState == HAL_UART_STATE_READY) {
+            if (e->body_left > 0) {
+                if (esp_at_body_next(e) != ESP_AT_OK) {
+                    esp_at_async_complete(ESP_AT_ERROR);
+                    return;
+                }
+                break;
+            }
+            async_phase = ESP_ASYNC_WAIT_SEND_OK;
+        }
+        break;
+
+    case ESP_ASYNC_WAIT_SEND_OK:
+        status = esp_at_match_response(RESPONSE_SEND_OK);
+        if (status == ESP_AT_OK && e->body_failed) {
+            esp_at_async_complete(ESP_AT_ERROR); // Padded body: not the request meant
+            return;
+        }
+        if (status == ESP_AT_OK && e->http_resp) {
+            // The response may already be in (it can overtake SEND OK)
+            async_start_tick = HAL_GetTick();
+            e->timeout_ms = ESP_AT_HTTP_RESPONSE_TIMEOUT_MS;
+            async_phase = ESP_ASYNC_WAIT_HTTP;
+            break;
+        }
+        if (status != ESP_AT_BUSY) {
+            esp_at_async_complete(status);
+            return;
+        }
+        break;
+
+    case ESP_ASYNC_WAIT_HTTP:
+        if (http_resp_done) {
+            esp_at_async_complete(esp_at_http_result());
+            return;
+        }
+        if (strstr(rx_buffer, RESPONSE_CLOSED) != NULL) {
+            esp_at_async_complete(ESP_AT_ERROR); // Server hung up without answering
+            return;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if ((HAL_GetTick() - async_start_tick) >= e->timeout_ms) {
+        if (async_phase == ESP_ASYNC_WAIT_HTTP) {
+            http_stats.timeouts++;
+        }
+        HAL_UART_AbortTransmit(esp_huart);
+        esp_at_async_complete(ESP_AT_TIMEOUT);
+    }
+}
+
+bool esp_at_is_busy(void)
+{
+    return (q_count > 0) || (async_phase != ESP_ASYNC_IDLE) || join_wait ||
+           (boot_phase != ESP_BOOT_DONE);
+}
+
+/* Transparent transmission (passthrough) ------------------------------------*/
+
+esp_at_status_t esp_at_enter_passthrough_async(esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (esp_huart == NULL || esp_state != ESP_STATE_TCP_CONNECTED) {
+        return ESP_AT_ERROR;
+    }
+    if (passthrough || http_tx_busy || ESP_AT_CMD_QUEUE_LEN - q_count < 2) {
+        return ESP_AT_BUSY;
+    }
+
+    // CIPMODE=1, then a length-less CIPSEND opens the byte pipe
+    esp_at_queue_cmd("AT+CIPMODE=1", RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS, NULL, NULL)->linked = 1;
+    esp_at_queue_cmd("AT+CIPSEND", RESPONSE_PT_PROMPT, ESP_AT_RESPONSE_TIMEOUT_MS, cb, ctx)->hook =
+        esp_at_hook_passthrough_enter;
+
+    return ESP_AT_OK;
+}
+
+esp_at_status_t esp_at_exit_passthrough_async(esp_at_cmd_cb_t cb, void *ctx)
+{
+    if (!passthrough) {
+        return ESP_AT_ERROR;
+    }
+    if (ESP_AT_CMD_QUEUE_LEN - q_count < 2) {
+        return ESP_AT_BUSY;
+    }
+
+    // "+++" without terminator, wrapped in guard time, answered by nothing
+    esp_at_cmd_entry_t *e = esp_at_queue_alloc();
+    memcpy(e->cmd, ESCAPE_SEQUENCE, sizeof(ESCAPE_SEQUENCE) - 1);
+    e->cmd_len = sizeof(ESCAPE_SEQUENCE) - 1;
+    e->guard_ms = ESP_AT_ESCAPE_EXIT_MS;
+    e->timeout_ms = ESP_AT_ESCAPE_EXIT_MS + ESP_AT_RESPONSE_TIMEOUT_MS;
+    e->hook = esp_at_hook_passthrough_exit;
+    e->linked = 1;
+
+    esp_at_queue_cmd("AT+CIPMODE=0", RESPONSE_OK, ESP_AT_RESPONSE_TIMEOUT_MS, cb, ctx);
+
+    return ESP_AT_OK;
+}
+
+/**
+  * @brief  Hand bytes to the UART in passthrough mode
+  * @note   Same response and boot-time bookkeeping as a CIPSEND post, so RTT
+  *         and first-send stats hold whichever path is in use.
+  * @param  data: Bytes to send (must stay valid until the transfer ends)
+  * @param  len: Number of bytes
+  * @retval ESP_AT_OK or ESP_AT_ERROR
+  */
+static esp_at_status_t esp_at_passthrough_tx(const uint8_t *data, uint16_t len)
+{
+    esp_at_clear_rx_buffer(); // Server replies stream back raw; keep the latest
+    esp_at_http_begin();
+    if (HAL_UART_Transmit_IT(esp_huart, (uint8_t*)data, len) != HAL_OK) {
+        return ESP_AT_ERROR;
+    }
+    last_tx_tick = HAL_GetTick();
+    if (boot_times.first_send == 0) {
+        boot_times.first_send = last_tx_tick; // No SEND OK here: handed to the UART
+    }
+    return ESP_AT_OK;
+}
+
+esp_at_status_t esp_at_passthrough_send(const uint8_t *data, uint16_t len)
+{
+    if (data == NULL || len == 0 || len > sizeof(http_tx_buffer) ||
+        (data == (const uint8_t*)http_body && len > sizeof(http_tx_buffer) - ESP_AT_HTTP_HEADER_RESERVE)) {
+        return ESP_AT_ERROR;
+    }
+    if (!passthrough || esp_at_is_busy() || esp_huart->gState != HAL_UART_STATE_READY) {
+        return ESP_AT_BUSY;
+    }
+
+    if (data != (const uint8_t*)http_body) {
+        memcpy(http_tx_buffer, data, len);
+        data = (const uint8_t*)http_tx_buffer;
+    }
+    return esp_at_passthrough_tx(data, len);
+}
+
+esp_at_status_t esp_at_passthrough_send_http_post(const char *endpoint, const char *content_type,
+                                                  const uint8_t *body, uint16_t body_len)
+{
+    if (endpoint == NULL || content_type == NULL || body == NULL || body_len == 0) {
+        return ESP_AT_ERROR;
+    }
+    if (!passthrough || esp_at_is_busy() || esp_huart->gState != HAL_UART_STATE_READY) {
+        return ESP_AT_BUSY;
+    }
+
+    const char *request;
+    int http_len = esp_at_build_http_post(endpoint, content_type, body, body_len, &request);
+    if (http_len < 0) {
+        return ESP_AT_ERROR;
+    }
+
+    return esp_at_passthrough_tx((const uint8_t*)request, (uint16_t)http_len);
+}
+
+bool esp_at_in_passthrough(void)
+{
+    return passthrough;
+}
@@ -12,6 +12,22 @@
 /* Private defines -----------------------------------------------------------*/
 #define JSON_BUILDER_MIN_SIZE 32
 
+/* Private variables ---------------------------------------------------------*/
+
+/* "00".."99": two output digits per table lookup */
+static const char json_digits_lut[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
 /* Private functions ---------------------------------------------------------*/
 
 /**
@@ -54,76 +70,192 @@ static int json_append_char(json_builder_t *jb, char c)
   */
 static int json_append_int(json_builder_t *jb, int32_t value)
 {
-    char num_buf[12]; // Enough for -2147483648
-    int len = 0;
-    int32_t temp = value;
-    int negative = 0;
+    char num_buf[JSON_INT_MAX_LEN];
+    uint8_t len = json_format_int(num_buf, value);
 
-    // Handle negative numbers
-    if (temp < 0) {
-        negative = 1;
-        temp = -temp;
+    if (jb->pos + len >= jb->size) {
+        return -1;
     }
+    memcpy(&jb->buffer[jb->pos], num_buf, len);
+    jb->pos += len;
+    return 0;
+}
 
-    // Convert to string (reverse order)
-    if (temp == 0) {
-        num_buf[len++] = '0';
-    } else {
-        while (temp > 0) {
-            num_buf[len++] = '0' + (temp % 10);
-            temp /= 10;
+/**
+  * @brief  Convert unsigned integer to string and append
+  * @param  jb: JSON builder handle
+  * @param  value: Unsigned integer value
+  * @retval 0 on success, -1 on buffer overflow
+  */
+static int json_append_uint(json_builder_t *jb, uint32_t value)
+{
+    char num_buf[JSON_UINT_MAX_LEN];
+    uint8_t len = json_format_uint(num_buf, value);
+
+    if (jb->pos + len >= jb->size) {
+        return -1;
+    }
+    memcpy(&jb->buffer[jb->pos], num_buf, len);
+    jb->pos += len;
+    return 0;
+}
+
+/**
+  * @brief  Number of decimal digits
+  * @param  v: Value
+  * @retval 1..10
+  */
+static uint8_t json_digit_count(uint32_t v)
+{
+    if (v < 10U) return 1;
+    if (v < 100U) return 2;
+    if (v < 1000U) return 3;
+    if (v < 10000U) return 4;
+    if (v < 100000U) return 5;
+    if (v < 1000000U) return 6;
+    if (v < 10000000U) return 7;
+    if (v < 100000000U) return 8;
+    if (v < 1000000000U) return 9;
+    return 10;
+}
+
+/**
+  * @brief  Append literal text to a template
+  * @param  tpl: Template handle
+  * @param  str: Text
+  * @retval 0 on success, -1 if the template is full
+  */
+static int json_template_text(json_template_t *tpl, const char *str)
+{
+    size_t len = strlen(str);
+
+    if (tpl->len + len > sizeof(tpl->text)) {
+        return -1;
+    }
+    memcpy(&tpl->text[tpl->len], str, len);
+    tpl->len += (uint8_t)len;
+    return 0;
+}
+
+/**
+  * @brief  Copy bytes into a stream, passing each full chunk to the sink
+  * @param  js: Stream handle
+  * @param  data: Bytes
+  * @param  len: Number of bytes
+  * @retval 0 on success, -1 on error
+  */
+static int json_stream_write(json_stream_t *js, const char *data, uint16_t len)
+{
+    while (len > 0) {
+        uint16_t n = js->size - js->pos;
+
+        if (n == 0) {
+            if (json_stream_flush(js) != 0) {
+                return -1;
+            }
+            n = js->size;
+        }
+        if (n > len) {
+            n = len;
         }
+        memcpy(&js->buffer[js->pos], data, n);
+        js->pos += n;
+        data += n;
+        len -= n;
     }
+    return 0;
+}
 
-    // Check buffer space
-    if (jb->pos + len + negative >= jb->size) {
+/**
+  * @brief  Emit the separator and key that precede a value
+  * @param  js: Stream handle
+  * @param  key: Member name, NULL outside objects
+  * @retval 0 on success, -1 on error
+  */
+static int json_stream_member(json_stream_t *js, const char *key)
+{
+    uint16_t bit;
+
+    if (js->error) {
         return -1;
     }
+    if (js->depth == 0) {
+        // A single top-level value, no key
+        if (key != NULL || json_stream_length(js) > 0) {
+            js->error = 1;
+            return -1;
+        }
+        return 0;
+    }
 
-    // Write to buffer (correct order)
-    if (negative) {
-        jb->buffer[jb->pos++] = '-';
+    bit = (uint16_t)(1U << (js->depth - 1));
+    if ((key != NULL) != ((js->is_object & bit) != 0)) {
+        js->error = 1;
+        return -1;
     }
-    for (int i = len - 1; i >= 0; i--) {
-        jb->buffer[jb->pos++] = num_buf[i];
+    if ((js->has_items & bit) && json_stream_write(js, ",", 1) != 0) {
+        return -1;
     }
+    js->has_items |= bit;
 
+    if (key != NULL) {
+        if (json_stream_write(js, "\"", 1) != 0 ||
+            json_stream_write(js, key, (uint16_t)strlen(key)) != 0 ||
+            json_stream_write(js, "\":", 2) != 0) {
+            return -1;
+        }
+    }
     return 0;
 }
 
 /**
-  * @brief  Convert unsigned integer to string and append
-  * @param  jb: JSON builder handle
-  * @param  value: Unsigned integer value
-  * @retval 0 on success, -1 on buffer overflow
+  * @brief  Open an object or array
+  * @param  js: Stream handle
+  * @param  key: Member name or NULL
+  * @param  object: true for '{', false for '['
+  * @retval 0 on success, -1 on error
   */
-static int json_append_uint(json_builder_t *jb, uint32_t value)
+static int json_stream_open(json_stream_t *js, const char *key, bool object)
 {
-    char num_buf[11]; // Enough for 4294967295
-    int len = 0;
-    uint32_t temp = value;
+    uint16_t bit;
 
-    // Convert to string (reverse order)
-    if (temp == 0) {
-        num_buf[len++] = '0';
-    } else {
-        while (temp > 0) {
-            num_buf[len++] = '0' + (temp % 10);
-            temp /= 10;
-        }
+    if (json_stream_member(js, key) != 0) {
+        return -1;
     }
-
-    // Check buffer space
-    if (jb->pos + len >= jb->size) {
+    if (js->depth >= JSON_STREAM_MAX_DEPTH) {
+        js->error = 1;
         return -1;
     }
 
-    // Write to buffer (correct order)
-    for (int i = len - 1; i >= 0; i--) {
-        jb->buffer[jb->pos++] = num_buf[i];
+    bit = (uint16_t)(1U << js->depth);
+    js->depth++;
+    js->has_items &= (uint16_t)~bit;
+    if (object) {
+        js->is_object |= bit;
+    } else {
+        js->is_object &= (uint16_t)~bit;
     }
+    return json_stream_write(js, object ? "{" : "[", 1);
+}
 
-    return 0;
+/**
+  * @brief  Close the innermost object or array
+  * @param  js: Stream handle
+  * @param  object: true for '}', false for ']'
+  * @retval 0 on success, -1 on error
+  */
+static int json_stream_close(json_stream_t *js, bool object)
+{
+    if (js->error) {
+        return -1;
+    }
+    if (js->depth == 0 ||
+        ((js->is_object & (1U << (js->depth - 1))) != 0) != object) {
+        js->error = 1;
+        return -1;
+    }
+    js->depth--;
+    return json_stream_write(js, object ? "}" : "]", 1);
 }
 
 /* Exported functions --------------------------------------------------------*/
@@ -166,6 +298,38 @@ int json_add_int(json_builder_t *jb, const char *key, int32_t value)
     return 0;
 }
 
+int json_add_fixed(json_builder_t *jb, const char *key, int32_t value, uint8_t decimals)
+{
+    char num_buf[JSON_FIXED_MAX_LEN];
+    uint8_t len;
+
+    if (decimals > JSON_FIXED_MAX_DECIMALS) {
+        return -1;
+    }
+
+    // Add comma if not first field
+    if (!jb->first) {
+        if (json_append_char(jb, ',') != 0) return -1;
+    }
+    jb->first = 0;
+
+    // Add key
+    if (json_append_char(jb, '"') != 0) return -1;
+    if (json_append_string(jb, key) != 0) return -1;
+    if (json_append_char(jb, '"') != 0) return -1;
+    if (json_append_char(jb, ':') != 0) return -1;
+
+    // Add value
+    len = json_format_fixed(num_buf, value, decimals);
+    if (jb->pos + len >= jb->size) {
+        return -1;
+    }
+    memcpy(&jb->buffer[jb->pos], num_buf, len);
+    jb->pos += len;
+
+    return 0;
+}
+
 int json_add_uint(json_builder_t *jb, const char *key, uint32_t value)
 {
     // Add comma if not first field
@@ -210,12 +374,15 @@ int json_add_bool(json_builder_t *jb, const char *key, bool value)
     return 0;
 }
 
-void json_end(json_builder_t *jb)
+int json_end(json_builder_t *jb)
 {
-    if (jb->pos < jb->size) {
-        jb->buffer[jb->pos++] = '}';
-        jb->buffer[jb->pos] = '\0'; // Null terminator
+    // Need room for '}' plus the null terminator
+    if (jb->pos + 1 >= jb->size) {
+        return -1;
     }
+    jb->buffer[jb->pos++] = '}';
+    jb->buffer[jb->pos] = '\0'; // Null terminator
+    return 0;
 }
 
 uint16_t json_get_length(json_builder_t *jb)
@@ -223,3 +390,297 @@ uint16_t json_get_length(json_builder_t *jb)
     return jb->pos;
 }
 
+uint8_t json_format_uint(char *out, uint32_t value)
+{
+    uint8_t len = json_digit_count(value);
+    char *p = out + len;
+
+    // Two digits per step from the right
+    while (value >= 100U) {
+        const char *d = &json_digits_lut[(value % 100U) * 2U];
+        value /= 100U;
+        *--p = d[1];
+        *--p = d[0];
+    }
+    if (value >= 10U) {
+        const char *d = &json_digits_lut[value * 2U];
+        *--p = d[1];
+        *--p = d[0];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    return len;
+}
+
+uint8_t json_format_int(char *out, int32_t value)
+{
+    if (value < 0) {
+        *out = '-';
+        return 1 + json_format_uint(out + 1, 0U - (uint32_t)value); // Also right for INT32_MIN
+    }
+    return json_format_uint(out, (uint32_t)value);
+}
+
+uint8_t json_format_fixed(char *out, int32_t value, uint8_t decimals)
+{
+    char digits[JSON_UINT_MAX_LEN];
+    uint8_t len;
+    uint8_t pos = 0;
+
+    if (decimals > JSON_FIXED_MAX_DECIMALS) {
+        return 0;
+    }
+    if (decimals == 0) {
+        return json_format_int(out, value);
+    }
+    if (value < 0) {
+        out[pos++] = '-';
+    }
+    len = json_format_uint(digits, value < 0 ? 0U - (uint32_t)value : (uint32_t)value);
+
+    if (len > decimals) {
+        // Integer part, point, fraction
+        memcpy(&out[pos], digits, len - decimals);
+        pos += len - decimals;
+        out[pos++] = '.';
+        memcpy(&out[pos], &digits[len - decimals], decimals);
+        pos += decimals;
+    } else {
+        // "0." and zero padding up to the scale
+        out[pos++] = '0';
+        out[pos++] = '.';
+        memset(&out[pos], '0', decimals - len);
+        pos += decimals - len;
+        memcpy(&out[pos], digits, len);
+        pos += len;
+    }
+    return pos;
+}
+
+void json_template_init(json_template_t *tpl)
+{
+    tpl->slots = 0;
+    tpl->len = 0;
+    tpl->max_len = 0;
+    json_template_text(tpl, "{");
+}
+
+int json_template_add(json_template_t *tpl, const char *key, json_slot_type_t type)
+{
+    if (tpl->slots >= JSON_TEMPLATE_MAX_SLOTS) {
+        return -1;
+    }
+    if ((tpl->slots > 0 && json_template_text(tpl, ",") != 0) ||
+        json_template_text(tpl, "\"") != 0 ||
+        json_template_text(tpl, key) != 0 ||
+        json_template_text(tpl, "\":") != 0) {
+        return -1;
+    }
+
+    tpl->run_end[tpl->slots] = tpl->len;
+    tpl->type[tpl->slots] = (uint8_t)type;
+    tpl->decimals[tpl->slots] = 0;
+    tpl->slots++;
+    return 0;
+}
+
+int json_template_add_fixed(json_template_t *tpl, const char *key, uint8_t decimals)
+{
+    if (decimals > JSON_FIXED_MAX_DECIMALS ||
+        json_template_add(tpl, key, JSON_SLOT_FIXED) != 0) {
+        return -1;
+    }
+    tpl->decimals[tpl->slots - 1] = decimals;
+    return 0;
+}
+
+int json_template_end(json_template_t *tpl)
+{
+    if (json_template_text(tpl, "}") != 0) {
+        return -1;
+    }
+    tpl->run_end[tpl->slots] = tpl->len;
+
+    tpl->max_len = tpl->len;
+    for (uint8_t i = 0; i < tpl->slots; i++) {
+        tpl->max_len += (tpl->type[i] == JSON_SLOT_BOOL) ? 5U :
+                        (tpl->type[i] == JSON_SLOT_FIXED) ? JSON_FIXED_MAX_LEN :
+                        (tpl->type[i] == JSON_SLOT_INT) ? JSON_INT_MAX_LEN : JSON_UINT_MAX_LEN;
+    }
+    return 0;
+}
+
+int json_template_render(const json_template_t *tpl, const uint32_t *values,
+                         char *buf, uint16_t buf_size)
+{
+    char tmp[JSON_TEMPLATE_RENDER_MAX];
+    char *out = buf;
+    uint16_t pos = 0;
+    uint8_t run = 0;
+
+    // Unchecked writes below: short of worst-case room, render aside first
+    if (buf_size < tpl->max_len) {
+        out = tmp;
+    }
+
+    for (uint8_t i = 0; i < tpl->slots; i++) {
+        uint8_t end = tpl->run_end[i];
+        memcpy(&out[pos], &tpl->text[run], end - run);
+        pos += end - run;
+        run = end;
+
+        switch (tpl->type[i]) {
+        case JSON_SLOT_INT:
+            pos += json_format_int(&out[pos], (int32_t)values[i]);
+            break;
+        case JSON_SLOT_FIXED:
+            pos += json_format_fixed(&out[pos], (int32_t)values[i], tpl->decimals[i]);
+            break;
+        case JSON_SLOT_BOOL:
+            memcpy(&out[pos], values[i] ? "true" : "false", values[i] ? 4 : 5);
+            pos += values[i] ? 4 : 5;
+            break;
+        default:
+            pos += json_format_uint(&out[pos], values[i]);
+            break;
+        }
+    }
+    memcpy(&out[pos], &tpl->text[run], tpl->run_end[tpl->slots] - run);
+    pos += tpl->run_end[tpl->slots] - run;
+
+    if (out == tmp) {
+        if (pos > buf_size) {
+            return -1;
+        }
+        memcpy(buf, tmp, pos);
+    }
+    return pos;
+}
+
+void json_stream_init(json_stream_t *js, char *buf, uint16_t buf_size,
+                      json_sink_t sink, void *ctx)
+{
+    js->buffer = buf;
+    js->size = buf_size;
+    js->pos = 0;
+    js->sink = sink;
+    js->ctx = ctx;
+    js->flushed = 0;
+    js->has_items = 0;
+    js->is_object = 0;
+    js->depth = 0;
+    js->error = (buf == NULL || buf_size == 0 || sink == NULL) ? 1 : 0;
+}
+
+int json_stream_begin_object(json_stream_t *js, const char *key)
+{
+    return json_stream_open(js, key, true);
+}
+
+int json_stream_end_object(json_stream_t *js)
+{
+    return json_stream_close(js, true);
+}
+
+int json_stream_begin_array(json_stream_t *js, const char *key)
+{
+    return json_stream_open(js, key, false);
+}
+
+int json_stream_end_array(json_stream_t *js)
+{
+    return json_stream_close(js, false);
+}
+
+int json_stream_uint(json_stream_t *js, const char *key, uint32_t value)
+{
+    char num_buf[JSON_UINT_MAX_LEN];
+
+    if (json_stream_member(js, key) != 0) {
+        return -1;
+    }
+    return json_stream_write(js, num_buf, json_format_uint(num_buf, value));
+}
+
+int json_stream_int(json_stream_t *js, const char *key, int32_t value)
+{
+    char num_buf[JSON_INT_MAX_LEN];
+
+    if (json_stream_member(js, key) != 0) {
+        return -1;
+    }
+    return json_stream_write(js, num_buf, json_format_int(num_buf, value));
+}
+
+int json_stream_fixed(json_stream_t *js, const char *key, int32_t value, uint8_t decimals)
+{
+    char num_buf[JSON_FIXED_MAX_LEN];
+
+    if (decimals > JSON_FIXED_MAX_DECIMALS) {
+        js->error = 1;
+        return -1;
+    }
+    if (json_stream_member(js, key) != 0) {
+        return -1;
+    }
+    return json_stream_write(js, num_buf, json_format_fixed(num_buf, value, decimals));
+}
+
+int json_stream_bool(json_stream_t *js, const char *key, bool value)
+{
+    if (json_stream_member(js, key) != 0) {
+        return -1;
+    }
+    return value ? json_stream_write(js, "true", 4) : json_stream_write(js, "false", 5);
+}
+
+int json_stream_template(json_stream_t *js, const char *key,
+                         const json_template_t *tpl, const uint32_t *values)
+{
+    char tmp[JSON_TEMPLATE_RENDER_MAX];
+    int len;
+
+    if (json_stream_member(js, key) != 0) {
+        return -1;
+    }
+
+    // Render straight into the chunk when it can hold the worst case
+    if (js->size - js->pos < tpl->max_len && js->size >= tpl->max_len) {
+        if (json_stream_flush(js) != 0) {
+            return -1;
+        }
+    }
+    if (js->size - js->pos >= tpl->max_len) {
+        len = json_template_render(tpl, values, &js->buffer[js->pos], js->size - js->pos);
+        js->pos += (uint16_t)len;
+        return 0;
+    }
+
+    len = json_template_render(tpl, values, tmp, sizeof(tmp));
+    if (len < 0) {
+        js->error = 1;
+        return -1;
+    }
+    return json_stream_write(js, tmp, (uint16_t)len);
+}
+
+int json_stream_flush(json_stream_t *js)
+{
+    if (js->error) {
+        return -1;
+    }
+    if (js->pos > 0) {
+        if (js->sink(js->ctx, js->buffer, js->pos) != 0) {
+            js->error = 1;
+            return -1;
+        }
+        js->flushed += js->pos;
+        js->pos = 0;
+    }
+    return 0;
+}
+
+uint32_t json_stream_length(const json_stream_t *js)
+{
+    return js->flushed + js->pos;
+}
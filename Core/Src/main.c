@@ -1,6 +1,12 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "usb_device.h"   // if you don't need USB, you can remove this
+#include "esp_at.h"
+#include "json_builder.h"
+#include "telemetry.h"
+#include "spool.h"
+#include "debug_log.h"
+#include "dlog.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -8,6 +14,87 @@
 
 I2C_HandleTypeDef hi2c1;
 UART_HandleTypeDef huart2;
+UART_HandleTypeDef huart3;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+/* ===================== Wi‑Fi / Server config ===================== */
+
+#define WIFI_SSID        "YourWiFiSSID"
+#define WIFI_PASSWORD    "YourWiFiPassword"
+#define SERVER_IP        "192.168.1.100"
+#define SERVER_PORT      3000
+#define HTTP_ENDPOINT    "/api/energy"
+
+/* ===================== Telemetry batching ===================== */
+
+/* 1 = TaskControl records into the telemetry queue and TaskComms posts
+ * JSON arrays of up to TELEMETRY_BATCH_MAX records; 0 = one record per post */
+#define COMMS_BATCH_ENABLE          1
+#define TELEMETRY_RECORD_PERIOD_MS  10     // 100 Hz recorded rate
+
+/* 1 = batches go out as compact binary frames (bin_frame.h) to
+ * HTTP_BIN_ENDPOINT instead of JSON arrays */
+#define COMMS_FORMAT_BINARY         0
+#define HTTP_BIN_ENDPOINT           "/api/energy/bin"
+
+#if COMMS_FORMAT_BINARY
+#define COMMS_BATCH_ENDPOINT        HTTP_BIN_ENDPOINT
+#define COMMS_BATCH_CONTENT_TYPE    "application/octet-stream"
+#else
+#define COMMS_BATCH_ENDPOINT        HTTP_ENDPOINT
+#define COMMS_BATCH_CONTENT_TYPE    "application/json"
+#endif
+
+/* 1 = after the TCP connect, switch the ESP to transparent transmission
+ * (AT+CIPMODE=1) and stream batches without a CIPSEND handshake each */
+#define COMMS_PASSTHROUGH           0
+
+/* 1 = stream batches as binary frames in sequence-numbered UDP datagrams
+ * to SERVER_UDP_PORT: no HTTP, no retransmission, loss is counted by the
+ * server (server/udp_ingest.js). Implies the binary frame format. */
+#define COMMS_UDP                   0
+#define SERVER_UDP_PORT             3001
+#define LOCAL_UDP_PORT              3001
+#define COMMS_UDP_MAX_DATAGRAM      1400   // stay below one Wi‑Fi MTU
+
+#if COMMS_UDP && COMMS_PASSTHROUGH
+#error "COMMS_PASSTHROUGH streams HTTP over TCP; disable it for COMMS_UDP"
+#endif
+
+/* JSON batches over CIPSEND are serialized while they go out, a chunk per
+ * UART transfer (esp_at_send_http_post_stream_async), instead of into the
+ * request buffer. So are spool replays, which are always JSON. */
+#define COMMS_STREAM_JSON  (!COMMS_FORMAT_BINARY && !COMMS_PASSTHROUGH && !COMMS_UDP)
+
+/* 1 = while the link is down, park records in internal flash (spool.h)
+ * and replay them oldest first, as JSON batches to HTTP_ENDPOINT, once it
+ * is back. Records carry sequence numbers so the server drops duplicates. */
+#define COMMS_SPOOL_ENABLE          1
+#define SPOOL_RECORD_PERIOD_MS      100    // 10 Hz offline: ~27 min in 256 KB
+
+#if COMMS_SPOOL_ENABLE && (COMMS_UDP || COMMS_PASSTHROUGH || !COMMS_BATCH_ENABLE)
+#error "COMMS_SPOOL_ENABLE replays through CIPSEND HTTP batch posts"
+#endif
+
+/* Server-driven pacing: after 429 / 5xx (or any response carrying
+ * Retry-After / X-Retry-After-Ms) posting pauses for the server's delay,
+ * else for a backoff doubling from COMMS_BACKOFF_MIN_MS; records keep
+ * queuing meanwhile and go out in fuller batches. A 2xx resets it.
+ * The queue only holds TELEMETRY_QUEUE_LEN records: with the spool, a
+ * longer pause parks the overflow in flash; without it the pause (jitter
+ * included) is capped at what the queue can hold. */
+#define COMMS_BACKOFF_MIN_MS        500
+#if COMMS_SPOOL_ENABLE
+#define COMMS_BACKOFF_MAX_MS        60000
+#else
+#define COMMS_BACKOFF_MAX_MS        (TELEMETRY_QUEUE_LEN * TELEMETRY_RECORD_PERIOD_MS * 4 / 5)
+#endif
+
+#if COMMS_BATCH_ENABLE
+#define COMMS_PERIOD_MS  50    // polls the queue; latency is TELEMETRY_BATCH_MAX_LATENCY_MS
+#else
+#define COMMS_PERIOD_MS  500
+#endif
 
 /* ===================== INA219 Driver ===================== */
 
@@ -41,13 +128,14 @@ typedef struct {
     uint32_t   next_release; // next release time in ms
 } task_t;
 
-#define NUM_TASKS 3
+#define NUM_TASKS 4
 static task_t tasks[NUM_TASKS];
 
 /* Forward declarations of tasks */
 void TaskSense(void);
 void TaskControl(void);
 void TaskComms(void);
+void TaskNet(void);
 
 /* Sensor abstraction */
 typedef void (*sensor_read_fn_t)(uint16_t *powerA, uint16_t *powerB);
@@ -60,6 +148,10 @@ static sensor_read_fn_t  sensor_read;
 typedef void (*comms_send_fn_t)(uint32_t ticks, uint16_t pA, uint16_t pB, uint8_t fan);
 static comms_send_fn_t  comms_send;
 
+/* Batch comms: drains the telemetry queue (COMMS_BATCH_ENABLE) */
+typedef void (*comms_batch_fn_t)(void);
+static comms_batch_fn_t comms_send_batch;
+
 /* Mailbox between Control and Comms */
 typedef struct {
     uint8_t  full;   // 1 = new data available
@@ -71,6 +163,27 @@ typedef struct {
 
 static volatile comms_mailbox_t comms_mailbox = {0};
 
+/* Wi‑Fi link state, advanced by ESP-AT completion callbacks */
+typedef enum {
+    LINK_DOWN = 0,   // nothing queued, (re)join on next send
+    LINK_JOINING,    // AT / CWMODE / CWJAP in flight
+    LINK_CONNECTING, // CIPSTART in flight
+    LINK_UP          // TCP connected, posts allowed
+} link_state_t;
+
+static volatile link_state_t link_state = LINK_DOWN;
+
+/* Records handed to the in-flight batch post, consumed on a 2xx response.
+ * Their encoding goes straight into the ESP-AT request buffer. */
+static telemetry_record_t batch_recs[TELEMETRY_BATCH_MAX];
+static uint16_t           batch_inflight = 0;
+static bool               batch_from_spool = false;
+static uint32_t           frame_seq = 0;   // advances once a frame is delivered
+
+/* No posts before this tick (server asked to back off) */
+static uint32_t comms_hold_until = 0;
+static uint32_t comms_backoff_ms = 0;
+
 static volatile uint8_t fan_on = 0;
 static volatile uint8_t fan1_sw_on = 0;
 
@@ -78,20 +191,25 @@ static volatile uint8_t fan1_sw_on = 0;
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_USART2_UART_Init(void);
+static void MX_USART3_UART_Init(void);
 static void MX_I2C1_Init(void);
 
 void scheduler(void);
 static void init_tasks(void);
 static void sensor_ina219(uint16_t *pA, uint16_t *pB);
 static void comms_uart(uint32_t ticks, uint16_t pA, uint16_t pB, uint8_t fan);
+static void comms_esp_at(uint32_t ticks, uint16_t pA, uint16_t pB, uint8_t fan);
+static void comms_uart_batch(void);
+static void comms_esp_at_batch(void);
 static void I2C_Scan(void);
 
-/* printf -> UART2 */
+/* printf -> debug log ring -> UART2 TX DMA (never blocks; drops when full) */
 int _write(int file, char *ptr, int len)
 {
     (void)file;
-    HAL_UART_Transmit(&huart2, (uint8_t*)ptr, len, HAL_MAX_DELAY);
+    debug_log_write((const uint8_t*)ptr, (uint16_t)len);
     return len;
 }
 
@@ -222,8 +340,503 @@ static void sensor_ina219(uint16_t *pA, uint16_t *pB)
 
 static void comms_uart(uint32_t ticks, uint16_t pA, uint16_t pB, uint8_t fan)
 {
-    printf("t=%lums pA=%u pB=%u fan=%u\r\n",
-           (unsigned long)ticks, pA, pB, fan);
+    // Per-record line: deferred so formatting happens on the host
+    DLOG("t=%lums pA=%u pB=%u fan=%u\r\n", ticks, pA, pB, fan);
+}
+
+/* Wi‑Fi callbacks: run from esp_at_poll() in TaskNet, never from an ISR */
+static void comms_tcp_done(esp_at_status_t status, const char *response, void *ctx)
+{
+    (void)response;
+    (void)ctx;
+    link_state = (status == ESP_AT_OK) ? LINK_UP : LINK_DOWN;
+}
+
+static void comms_wifi_done(esp_at_status_t status, const char *response, void *ctx)
+{
+    (void)response;
+    (void)ctx;
+#if COMMS_UDP
+    if (status == ESP_AT_OK &&
+        esp_at_connect_udp_async(SERVER_IP, SERVER_UDP_PORT, LOCAL_UDP_PORT,
+                                 comms_tcp_done, NULL) == ESP_AT_OK) {
+#else
+    if (status == ESP_AT_OK &&
+        esp_at_connect_tcp_async(SERVER_IP, SERVER_PORT, comms_tcp_done, NULL) == ESP_AT_OK) {
+#endif
+        link_state = LINK_CONNECTING;
+    } else {
+        link_state = LINK_DOWN;
+    }
+}
+
+/* Device id carried in binary frames: folded 96-bit STM32 unique id */
+static uint32_t device_id(void)
+{
+    return HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2();
+}
+
+/* Boot id carried in binary frames and the X-Boot-Id header. Kept in
+ * .noinit RAM: a reset leaves it intact and main() increments it, a
+ * power-up starts it from whatever the SRAM holds. Either way it differs
+ * from the previous boot's, which is how the server tells a restarted
+ * frame_seq or record seq from duplicates. */
+static uint32_t boot_count __attribute__((section(".noinit")));
+
+/* The same id as 8 hex digits for the X-Device-Id header, so the server
+ * files JSON posts and binary frames from this board together */
+static char device_id_hex[9];
+
+/* The low 16 bits of boot_count in decimal, as binary frames carry it */
+static char boot_id_dec[6];
+
+/* True when TaskComms sends through the ESP (comms_esp_at*), the only
+ * case in which the module is brought up and the spool is used */
+static bool comms_uses_wifi(void)
+{
+#if COMMS_BATCH_ENABLE
+    return comms_send_batch == comms_esp_at_batch;
+#else
+    return comms_send == comms_esp_at;
+#endif
+}
+
+/* Set the next post time from the server's answer (ESP_AT_OK for 2xx,
+ * ESP_AT_HTTP_ERROR otherwise). Returns true if the server is shedding
+ * load, i.e. the records should be offered again later. */
+static bool comms_pace(esp_at_status_t status)
+{
+    const esp_at_http_stats_t *hs = esp_at_get_http_stats();
+    bool throttled = (status == ESP_AT_HTTP_ERROR) &&
+                     (hs->last_status == 429 || hs->last_status >= 500);
+    uint32_t delay = hs->retry_after_ms; // a 2xx may still ask to slow down
+
+    if (throttled) {
+        comms_backoff_ms = comms_backoff_ms ? comms_backoff_ms * 2 : COMMS_BACKOFF_MIN_MS;
+        if (comms_backoff_ms > COMMS_BACKOFF_MAX_MS) comms_backoff_ms = COMMS_BACKOFF_MAX_MS;
+        if (delay == 0) delay = comms_backoff_ms;
+    } else if (status == ESP_AT_OK) {
+        comms_backoff_ms = 0;
+    }
+    if (delay > COMMS_BACKOFF_MAX_MS) delay = COMMS_BACKOFF_MAX_MS;
+
+    // Up to +25% per device so a fleet does not come back in lockstep
+    if (delay > 0) delay += device_id() % (delay / 4 + 1);
+    comms_hold_until = HAL_GetTick() + delay;
+    return throttled;
+}
+
+/* Once per boot: how long each stage up to the first delivered post took */
+static void comms_report_boot(void)
+{
+    static uint8_t reported = 0;
+    const esp_at_boot_times_t *bt = esp_at_get_boot_times();
+
+    if (reported || bt->first_send == 0) return;
+    reported = 1;
+
+    printf("ESP boot: ready +%lu ms, ip +%lu ms, link +%lu ms, first post +%lu ms\r\n",
+           bt->ready ? (unsigned long)(bt->ready - bt->start) : 0UL,
+           bt->got_ip ? (unsigned long)(bt->got_ip - bt->start) : 0UL,
+           bt->link_up ? (unsigned long)(bt->link_up - bt->start) : 0UL,
+           (unsigned long)(bt->first_send - bt->start));
+}
+
+static void comms_post_done(esp_at_status_t status, const char *response, void *ctx)
+{
+    (void)response;
+    (void)ctx;
+    if (status == ESP_AT_OK || status == ESP_AT_HTTP_ERROR) {
+        comms_pace(status); // single records are not retried
+        comms_report_boot();
+    } else {
+        link_state = LINK_DOWN; // rejoin + reconnect on the next send
+    }
+}
+
+/* Non-blocking: only queues work for the ESP-AT engine, falls back to UART2 */
+static void comms_esp_at(uint32_t ticks, uint16_t pA, uint16_t pB, uint8_t fan)
+{
+    if (link_state == LINK_UP && (int32_t)(HAL_GetTick() - comms_hold_until) >= 0) {
+        char json[64];
+        json_builder_t jb;
+
+        json_init(&jb, json, sizeof(json));
+        json_start(&jb);
+        json_add_uint(&jb, "t", ticks);
+        json_add_uint(&jb, "pA", pA);
+        json_add_uint(&jb, "pB", pB);
+        json_add_bool(&jb, "fan", fan);
+        json_end(&jb);
+
+        if (esp_at_send_http_post_async(HTTP_ENDPOINT, json, json_get_length(&jb),
+                                        comms_post_done, NULL) == ESP_AT_OK) {
+            return;
+        }
+    } else if (link_state == LINK_DOWN) {
+        if (esp_at_init_wifi_async(WIFI_SSID, WIFI_PASSWORD, comms_wifi_done, NULL) == ESP_AT_OK) {
+            link_state = LINK_JOINING;
+        }
+    }
+
+    comms_uart(ticks, pA, pB, fan);
+}
+
+/* ========== Batch comms ========== */
+
+/* UART2 has no room for every record: print the newest, drop the batch */
+static void comms_uart_batch(void)
+{
+    uint16_t n = telemetry_peek(batch_recs, TELEMETRY_BATCH_MAX);
+    if (n == 0) return;
+
+    const telemetry_record_t *r = &batch_recs[n - 1];
+    comms_uart(r->t, r->pA, r->pB, r->fan);
+    telemetry_consume(n);
+}
+
+static void comms_batch_done(esp_at_status_t status, const char *response, void *ctx)
+{
+    (void)response;
+    (void)ctx;
+    if (status == ESP_AT_OK || status == ESP_AT_HTTP_ERROR) {
+        comms_report_boot();
+        // Shed: records stay queued for a later, fuller post (the server
+        // drops duplicates). Any other non-2xx would only be rejected
+        // again, so the batch is dropped.
+        if (comms_pace(status)) {
+            batch_inflight = 0;
+            return;
+        }
+    }
+    if (status != ESP_AT_OK && status != ESP_AT_HTTP_ERROR) {
+        link_state = LINK_DOWN; // records stay queued; UART fallback drains them
+    } else if (batch_from_spool) {
+        spool_consume(batch_inflight);
+    } else {
+        telemetry_consume(batch_inflight);
+        frame_seq++;
+    }
+    batch_inflight = 0;
+}
+
+#if !COMMS_STREAM_JSON
+/* JSON-encode up to n records (already in batch_recs) into out.
+ * Returns the number of records encoded, 0 on failure. */
+static uint16_t comms_build_json(uint16_t n, char *out, uint16_t size, uint16_t *len)
+{
+    int json_len = telemetry_build_json_batch(batch_recs, n, out, size);
+    while (json_len < 0 && n > 1) {
+        n /= 2; // unusually long numbers: send a smaller batch
+        json_len = telemetry_build_json_batch(batch_recs, n, out, size);
+    }
+    if (json_len < 0) return 0;
+
+    *len = (uint16_t)json_len;
+    return n;
+}
+
+/* Encode up to n queued records (already in batch_recs) into out.
+ * Returns the number of records encoded, 0 on failure. */
+static uint16_t comms_build_batch(uint16_t n, char *out, uint16_t size, uint16_t *len)
+{
+#if COMMS_FORMAT_BINARY
+    int sent = telemetry_build_bin_batch(batch_recs, n, device_id(), (uint16_t)boot_count,
+                                         frame_seq, (uint8_t*)out, size, len);
+    return (sent > 0) ? (uint16_t)sent : 0;
+#else
+    return comms_build_json(n, out, size, len);
+#endif
+}
+#endif /* !COMMS_STREAM_JSON */
+
+#if COMMS_STREAM_JSON || COMMS_SPOOL_ENABLE
+/* Streamed JSON post of batch_recs: esp_at pulls the body as the UART
+ * drains, and each pull writes records into the stream until its chunk
+ * buffer fills and the sink hands that chunk over */
+static struct {
+    json_stream_t js;
+    char     chunk[ESP_AT_HTTP_CHUNK_SIZE];
+    uint16_t n;          // records in the batch
+    uint16_t next;       // next record to write
+    bool     closed;     // "]" written
+    uint8_t *out;        // where the current pull wants its bytes
+    uint16_t out_size;
+    uint16_t out_len;
+} comms_json;
+
+static int comms_json_sink(void *ctx, const char *data, uint16_t len)
+{
+    (void)ctx;
+    if (comms_json.out_len > 0 || len > comms_json.out_size) {
+        return -1; // one chunk per pull, and never past the announced length
+    }
+    memcpy(comms_json.out, data, len);
+    comms_json.out_len = len;
+    return 0;
+}
+
+static int comms_json_discard(void *ctx, const char *data, uint16_t len)
+{
+    (void)ctx;
+    (void)data;
+    (void)len;
+    return 0;
+}
+
+/* esp_at_body_fn_t: the next chunk of the batch */
+static int comms_json_pull(uint8_t *buf, uint16_t size, void *ctx)
+{
+    (void)ctx;
+    comms_json.out = buf;
+    comms_json.out_size = size;
+    comms_json.out_len = 0;
+
+    while (comms_json.out_len == 0) {
+        int rc;
+        if (comms_json.next < comms_json.n) {
+            rc = telemetry_write_json_record(batch_recs, comms_json.next++, &comms_json.js);
+        } else if (!comms_json.closed) {
+            comms_json.closed = true;
+            rc = json_stream_end_array(&comms_json.js);
+        } else {
+            rc = json_stream_flush(&comms_json.js);
+            if (comms_json.out_len == 0) rc = -1; // asked past the end
+        }
+        if (rc != 0) return -1;
+    }
+    return comms_json.out_len;
+}
+
+/* Post up to n records (already in batch_recs) as a streamed JSON array.
+ * A dry run through a discarding sink gives the Content-Length.
+ * Returns the number of records posted, 0 if nothing was queued. */
+static uint16_t comms_post_json(uint16_t n, const char *endpoint)
+{
+    uint32_t len = 0;
+
+    for (; n > 0; n /= 2) { // unusually long numbers: send a smaller batch
+        json_stream_init(&comms_json.js, comms_json.chunk, sizeof(comms_json.chunk),
+                         comms_json_discard, NULL);
+        if (telemetry_write_json_batch(batch_recs, n, &comms_json.js, NULL) != 0 ||
+            json_stream_flush(&comms_json.js) != 0) {
+            return 0;
+        }
+        len = json_stream_length(&comms_json.js);
+        if (len <= ESP_AT_HTTP_BODY_MAX) break;
+    }
+    if (n == 0) return 0;
+
+    json_stream_init(&comms_json.js, comms_json.chunk, sizeof(comms_json.chunk),
+                     comms_json_sink, NULL);
+    comms_json.n = n;
+    comms_json.next = 0;
+    comms_json.closed = false;
+    if (json_stream_begin_array(&comms_json.js, NULL) != 0 ||
+        esp_at_send_http_post_stream_async(endpoint, "application/json", (uint16_t)len,
+                                           comms_json_pull, NULL,
+                                           comms_batch_done, NULL) != ESP_AT_OK) {
+        return 0;
+    }
+    return n;
+}
+#endif /* COMMS_STREAM_JSON || COMMS_SPOOL_ENABLE */
+
+#if COMMS_SPOOL_ENABLE
+/* Move queued records into flash. Offline (thin = true) only one record per
+ * SPOOL_RECORD_PERIOD_MS is kept; while the backlog drains every record
+ * goes behind it so delivery stays in order. The newest is still printed. */
+static void comms_spool_queue(bool thin)
+{
+    static uint32_t last_spooled = 0;
+    uint16_t n, last = 0;
+
+    while ((n = telemetry_peek(batch_recs, TELEMETRY_BATCH_MAX)) > 0) {
+        for (uint16_t i = 0; i < n; i++) {
+            if (thin && (batch_recs[i].t - last_spooled) < SPOOL_RECORD_PERIOD_MS) {
+                continue;
+            }
+            spool_append(&batch_recs[i]);
+            last_spooled = batch_recs[i].t;
+        }
+        telemetry_consume(n);
+        last = n;
+    }
+
+    if (thin && last > 0) {
+        const telemetry_record_t *r = &batch_recs[last - 1];
+        comms_uart(r->t, r->pA, r->pB, r->fan);
+    }
+}
+
+/* Post the oldest spooled records; they are consumed on SEND OK */
+static void comms_spool_replay(void)
+{
+    // Always JSON: binary frames carry no per-record sequence numbers
+    uint16_t n = comms_post_json(spool_peek(batch_recs, TELEMETRY_BATCH_MAX), HTTP_ENDPOINT);
+    if (n > 0) {
+        batch_inflight = n;
+        batch_from_spool = true;
+    }
+}
+#endif /* COMMS_SPOOL_ENABLE */
+
+#if COMMS_UDP
+/* Datagrams are fire-and-forget: a failed send only matters if the link died */
+static void comms_udp_done(esp_at_status_t status, const char *response, void *ctx)
+{
+    (void)response;
+    (void)ctx;
+    if (status == ESP_AT_TIMEOUT) {
+        link_state = LINK_DOWN;
+    }
+}
+#endif
+
+#if COMMS_PASSTHROUGH
+static void comms_passthrough_done(esp_at_status_t status, const char *response, void *ctx)
+{
+    (void)response;
+    (void)ctx;
+    if (status != ESP_AT_OK) {
+        link_state = LINK_DOWN;
+    }
+}
+#endif
+
+static void comms_esp_at_batch(void)
+{
+#if COMMS_SPOOL_ENABLE
+    // Before anything queued can go out: numbers past the lease must not
+    // repeat after a reset
+    spool_lease_seq(telemetry_next_seq());
+#endif
+
+    if (batch_inflight > 0) {
+        return; // previous batch still in flight
+    }
+
+    if (link_state != LINK_UP) {
+        if (link_state == LINK_DOWN &&
+            esp_at_init_wifi_async(WIFI_SSID, WIFI_PASSWORD, comms_wifi_done, NULL) == ESP_AT_OK) {
+            link_state = LINK_JOINING;
+        }
+#if COMMS_SPOOL_ENABLE
+        comms_spool_queue(true);
+#else
+        comms_uart_batch();
+#endif
+        return;
+    }
+
+#if COMMS_PASSTHROUGH
+    // Passthrough posts complete on hand-off; pace by responses as they come
+    static uint32_t responses_seen = 0;
+    const esp_at_http_stats_t *hs = esp_at_get_http_stats();
+    if (hs->responses != responses_seen) {
+        responses_seen = hs->responses;
+        comms_pace((hs->last_status >= 200 && hs->last_status < 300) ? ESP_AT_OK : ESP_AT_HTTP_ERROR);
+    }
+#endif
+
+    if ((int32_t)(HAL_GetTick() - comms_hold_until) < 0) {
+        // Server asked for a pause; the queue keeps filling
+#if COMMS_SPOOL_ENABLE
+        if (telemetry_count() > TELEMETRY_QUEUE_LEN - TELEMETRY_BATCH_MAX) {
+            comms_spool_queue(true); // about to overflow: to flash, as offline
+        }
+#endif
+        return;
+    }
+
+#if COMMS_SPOOL_ENABLE
+    if (spool_count() > 0) {
+        comms_spool_queue(false); // live records queue up behind the backlog
+        comms_spool_replay();
+        return;
+    }
+    batch_from_spool = false;
+
+    // Backlog delivered and the ESP idle: the one moment a sector erase
+    // (a 1-2 s CPU stall) costs nothing but a late post, and no reply is
+    // lost to a UART overrun meanwhile
+    if (!esp_at_is_busy() && spool_prepare()) {
+        return;
+    }
+#endif
+
+#if COMMS_PASSTHROUGH
+    if (!esp_at_in_passthrough()) {
+        // Records stay queued while the pipe opens (one CIPMODE + CIPSEND)
+        if (!esp_at_is_busy() &&
+            esp_at_enter_passthrough_async(comms_passthrough_done, NULL) != ESP_AT_OK) {
+            link_state = LINK_DOWN;
+        }
+        return;
+    }
+#endif
+
+#if COMMS_STREAM_JSON
+    uint16_t n = comms_post_json(telemetry_peek(batch_recs, TELEMETRY_BATCH_MAX),
+                                 COMMS_BATCH_ENDPOINT);
+    if (n > 0) {
+        batch_inflight = n;
+    }
+#else
+    // Encode in place behind the reserved header gap: no body copy on send
+    uint16_t len = 0, size;
+    char *body = (char*)esp_at_http_body_buffer(&size);
+    if (body == NULL) return; // previous request still owns the buffer
+
+#if COMMS_UDP
+    // Freshness over reliability: records leave the queue once handed to the
+    // ESP, and every datagram gets a new sequence number for loss accounting
+    int sent = telemetry_build_bin_batch(batch_recs, telemetry_peek(batch_recs, TELEMETRY_BATCH_MAX),
+                                         device_id(), (uint16_t)boot_count, frame_seq,
+                                         (uint8_t*)body, COMMS_UDP_MAX_DATAGRAM, &len);
+    if (sent <= 0) return;
+
+    if (esp_at_send_data_async((uint8_t*)body, len, comms_udp_done, NULL) == ESP_AT_OK) {
+        telemetry_consume((uint16_t)sent);
+        frame_seq++;
+    }
+#else
+    uint16_t n = comms_build_batch(telemetry_peek(batch_recs, TELEMETRY_BATCH_MAX), body, size, &len);
+    if (n == 0) return;
+
+#if COMMS_PASSTHROUGH
+    // No SEND OK in passthrough: records are consumed once handed to the UART
+    if (esp_at_passthrough_send_http_post(COMMS_BATCH_ENDPOINT, COMMS_BATCH_CONTENT_TYPE,
+                                          (uint8_t*)body, len) == ESP_AT_OK) {
+        telemetry_consume(n);
+        frame_seq++;
+        comms_report_boot();
+    }
+#else
+    if (esp_at_send_http_post_bin_async(COMMS_BATCH_ENDPOINT, (uint8_t*)body, len,
+                                        comms_batch_done, NULL) == ESP_AT_OK) {
+        batch_inflight = n;
+    }
+#endif
+#endif /* COMMS_UDP */
+#endif /* COMMS_STREAM_JSON */
+}
+
+/* HAL UART callbacks -> ESP-AT RX ring / debug log DMA */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    esp_at_uart_rx_callback(huart);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    debug_log_tx_complete(huart);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    esp_at_uart_error_callback(huart);
+    debug_log_error(huart);
 }
 
 /* ========== Tasks ========== */
@@ -259,10 +872,31 @@ void TaskControl(void)
     comms_mailbox.pB    = powerB;
     comms_mailbox.fan   = fan_on;
     comms_mailbox.full  = 1;
+
+#if COMMS_BATCH_ENABLE
+    static uint32_t last_record = 0;
+    if ((comms_mailbox.ticks - last_record) >= TELEMETRY_RECORD_PERIOD_MS) {
+        telemetry_record_t rec = {
+            .t = comms_mailbox.ticks, .pA = comms_mailbox.pA,
+            .pB = comms_mailbox.pB,   .fan = comms_mailbox.fan
+        };
+        telemetry_push(&rec);
+        last_record = comms_mailbox.ticks;
+    }
+#endif
 }
 
 void TaskComms(void)
 {
+#if COMMS_BATCH_ENABLE
+    bool due = telemetry_batch_due(HAL_GetTick(), TELEMETRY_BATCH_MAX, TELEMETRY_BATCH_MAX_LATENCY_MS);
+#if COMMS_SPOOL_ENABLE
+    due = due || (spool_count() > 0); // replay the backlog back to back
+#endif
+    if (due) {
+        comms_send_batch();
+    }
+#else
     if (comms_mailbox.full) {
         uint32_t ticks = comms_mailbox.ticks;
         uint16_t pA    = comms_mailbox.pA;
@@ -272,6 +906,12 @@ void TaskComms(void)
         comms_mailbox.full = 0;
         comms_send(ticks, pA, pB, fan);
     }
+#endif
+}
+
+void TaskNet(void)
+{
+    esp_at_poll();
 }
 
 /* ========== Scheduler ========== */
@@ -292,7 +932,8 @@ static void init_tasks(void)
 {
     tasks[0] = (task_t){ TaskSense,   1,   1   };
     tasks[1] = (task_t){ TaskControl, 10,  10  };
-    tasks[2] = (task_t){ TaskComms,   500, 500 };
+    tasks[2] = (task_t){ TaskComms,   COMMS_PERIOD_MS, COMMS_PERIOD_MS };
+    tasks[3] = (task_t){ TaskNet,     1,   1   };
 }
 
 int main(void)
@@ -306,16 +947,40 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_USART2_UART_Init();
+  MX_USART3_UART_Init();
   MX_I2C1_Init();
   MX_USB_DEVICE_Init();
 
+  debug_log_init(&huart2);
+
   Fan1_SetSwitch(1);   // allow fan initially
 
   printf("INA219 + RTOS demo starting...\r\n");
 
   sensor_read = sensor_ina219;
-  comms_send  = comms_uart;
+  comms_send  = comms_uart;   // comms_esp_at for Wi‑Fi
+  comms_send_batch = comms_uart_batch;   // comms_esp_at_batch for Wi‑Fi
+
+  boot_count++;
+  telemetry_init();
+#if COMMS_SPOOL_ENABLE
+  if (comms_uses_wifi()) {
+    spool_init();
+    telemetry_set_next_seq(spool_last_seq() + 1);
+  }
+#endif
+
+  // Probe and rate negotiation run from TaskNet: no boot delay, and none
+  // at all on the UART path or without a module
+  if (comms_uses_wifi()) {
+    esp_at_init_async(&huart3);
+    snprintf(device_id_hex, sizeof(device_id_hex), "%08lx", (unsigned long)device_id());
+    esp_at_set_http_device_id(device_id_hex);
+    snprintf(boot_id_dec, sizeof(boot_id_dec), "%u", (unsigned)(uint16_t)boot_count);
+    esp_at_set_http_boot_id(boot_id_dec);
+  }
 
   HAL_Delay(10);
   I2C_Scan();                 // Find devices on the bus
@@ -462,6 +1127,20 @@ static void MX_GPIO_Init(void)
   HAL_GPIO_Init(FAN1_SW_GPIO_Port, &GPIO_InitStruct);
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Stream6_IRQn interrupt configuration (USART2 TX, debug log) */
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
 /**
   * USART2 Initialization Function
   */
@@ -483,6 +1162,25 @@ static void MX_USART2_UART_Init(void)
   }
 }
 
+/**
+  * USART3 Initialization Function (ESP32 ESP-AT link)
+  */
+static void MX_USART3_UART_Init(void)
+{
+  huart3.Instance          = USART3;
+  huart3.Init.BaudRate     = 115200;
+  huart3.Init.WordLength   = UART_WORDLENGTH_8B;
+  huart3.Init.StopBits     = UART_STOPBITS_1;
+  huart3.Init.Parity       = UART_PARITY_NONE;
+  huart3.Init.Mode         = UART_MODE_TX_RX;
+  huart3.Init.HwFlowCtl    = UART_HWCONTROL_NONE;
+  huart3.Init.OverSampling = UART_OVERSAMPLING_16;
+  if (HAL_UART_Init(&huart3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
 /**
   * This function is executed in case of error occurrence.
   */
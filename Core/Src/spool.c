@@ -0,0 +1,355 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    spool.c
+  * @brief   Store-and-forward telemetry spool in internal flash
+  ******************************************************************************
+  */
+
+#include "spool.h"
+#include "main.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define SPOOL_MAGIC         0x53504C31U   // "SPL1"
+#define SPOOL_COMMIT        0x5AU
+#define SPOOL_ERASED        0xFFFFFFFFU
+
+#define SPOOL_SECTOR_0      FLASH_SECTOR_6
+#define SPOOL_SECTOR_0_ADDR 0x08040000U
+#define SPOOL_SECTOR_1      FLASH_SECTOR_7
+#define SPOOL_SECTOR_1_ADDR 0x08060000U
+
+/* Private macros ------------------------------------------------------------*/
+#define SPOOL_WORD(addr, i)     (*(volatile const uint32_t *)((addr) + 4U * (i)))
+#define SPOOL_AT_END(addr)      (((addr) & (SPOOL_SECTOR_SIZE - 1U)) == 0U)
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t sector_addr[2] = { SPOOL_SECTOR_0_ADDR, SPOOL_SECTOR_1_ADDR };
+static const uint32_t sector_num[2]  = { SPOOL_SECTOR_0, SPOOL_SECTOR_1 };
+
+static uint8_t  cur;              // Sector being written
+static uint32_t cur_gen;          // Its generation
+static uint32_t write_addr;       // Next free slot
+static uint32_t read_addr;        // Oldest slot not yet delivered
+static uint32_t pending;          // Undelivered records
+static uint32_t last_seq;
+static uint32_t lease_end;        // Highest sequence number reserved in flash
+static uint32_t dropped;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Slot state helpers
+  */
+static bool spool_slot_committed(uint32_t addr)
+{
+    return ((SPOOL_WORD(addr, 3) >> 8) & 0xFFU) == SPOOL_COMMIT;
+}
+
+static bool spool_slot_pending(uint32_t addr)
+{
+    return spool_slot_committed(addr) && (SPOOL_WORD(addr, 3) >> 16) == 0xFFFFU;
+}
+
+static bool spool_header_valid(uint8_t s)
+{
+    return SPOOL_WORD(sector_addr[s], 0) == SPOOL_MAGIC;
+}
+
+/* Erased by spool_prepare() and still empty: the writer can move in as is */
+static bool spool_sector_prepared(uint8_t s)
+{
+    return spool_header_valid(s) && SPOOL_WORD(sector_addr[s], 1) == cur_gen + 1U &&
+           SPOOL_WORD(sector_addr[s] + SPOOL_SLOT_SIZE, 0) == SPOOL_ERASED;
+}
+
+/**
+  * @brief  Slot after addr, wrapping from the older sector into the current one
+  * @param  addr: Slot address
+  * @retval Next slot address (write_addr once the log is exhausted)
+  */
+static uint32_t spool_next(uint32_t addr)
+{
+    uint32_t next = addr + SPOOL_SLOT_SIZE;
+
+    if (next == write_addr || !SPOOL_AT_END(next)) {
+        return next;
+    }
+    return sector_addr[cur] + SPOOL_SLOT_SIZE; // Skip the header slot
+}
+
+/**
+  * @brief  Erase a sector and write its header
+  * @param  s: Sector index (0/1)
+  * @param  gen: Generation to record
+  * @retval true on success
+  */
+static bool spool_format_sector(uint8_t s, uint32_t gen)
+{
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t sector_error = 0;
+    uint32_t erase_count = 0;
+    bool ok;
+
+    if (spool_header_valid(s) && SPOOL_WORD(sector_addr[s], 2) != SPOOL_ERASED) {
+        erase_count = SPOOL_WORD(sector_addr[s], 2);
+    }
+
+    erase.TypeErase    = FLASH_TYPEERASE_SECTORS;
+    erase.Sector       = sector_num[s];
+    erase.NbSectors    = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+    HAL_FLASH_Unlock();
+    ok = (HAL_FLASHEx_Erase(&erase, &sector_error) == HAL_OK) &&
+         (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, sector_addr[s] + 4U, gen) == HAL_OK) &&
+         (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, sector_addr[s] + 8U, erase_count + 1U) == HAL_OK) &&
+         (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, sector_addr[s], SPOOL_MAGIC) == HAL_OK);
+    HAL_FLASH_Lock();
+
+    return ok;
+}
+
+/**
+  * @brief  Scan one sector: update last_seq, count pending slots
+  * @param  s: Sector index
+  * @param  first_pending: Receives the first pending slot (0 if none)
+  * @retval Address of the first erased slot (sector end if full)
+  */
+static uint32_t spool_scan_sector(uint8_t s, uint32_t *first_pending)
+{
+    uint32_t addr = sector_addr[s] + SPOOL_SLOT_SIZE;
+    uint32_t end = sector_addr[s] + SPOOL_SECTOR_SIZE;
+
+    *first_pending = 0;
+    for (; addr < end; addr += SPOOL_SLOT_SIZE) {
+        if (SPOOL_WORD(addr, 0) == SPOOL_ERASED) {
+            break;
+        }
+        if (!spool_slot_committed(addr)) {
+            continue; // Torn write
+        }
+        if (SPOOL_WORD(addr, 0) > last_seq) {
+            last_seq = SPOOL_WORD(addr, 0);
+        }
+        if (spool_slot_pending(addr)) {
+            if (*first_pending == 0) {
+                *first_pending = addr;
+            }
+            pending++;
+        }
+    }
+    return addr;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void spool_init(void)
+{
+    bool valid0 = spool_header_valid(0);
+    bool valid1 = spool_header_valid(1);
+    uint32_t first0 = 0, first1 = 0;
+
+    pending = 0;
+    last_seq = 0;
+    lease_end = 0;
+    dropped = 0;
+
+    if (!valid0 && !valid1) {
+        cur = 0;
+        cur_gen = 1;
+        spool_format_sector(0, cur_gen);
+        write_addr = sector_addr[0] + SPOOL_SLOT_SIZE;
+        read_addr = write_addr;
+        return;
+    }
+
+    // The newer generation is the one being written
+    if (valid0 && valid1) {
+        cur = (SPOOL_WORD(sector_addr[1], 1) > SPOOL_WORD(sector_addr[0], 1)) ? 1 : 0;
+    } else {
+        cur = valid1 ? 1 : 0;
+    }
+    cur_gen = SPOOL_WORD(sector_addr[cur], 1);
+
+    uint8_t old = cur ^ 1;
+    bool old_in_log = spool_header_valid(old) && SPOOL_WORD(sector_addr[old], 1) + 1U == cur_gen;
+
+    if (old_in_log) {
+        spool_scan_sector(old, &first0);
+    }
+    write_addr = spool_scan_sector(cur, &first1);
+
+    if (first0 != 0) {
+        read_addr = first0;
+    } else if (first1 != 0) {
+        read_addr = first1;
+    } else {
+        read_addr = write_addr;
+    }
+    lease_end = last_seq;
+}
+
+/**
+  * @brief  Program one slot at write_addr, recycling the other sector if full
+  * @param  w: Slot words; w[3] is written last as the commit
+  * @retval true on success
+  */
+static bool spool_write_slot(const uint32_t w[4])
+{
+    bool ok = true;
+
+    if (SPOOL_AT_END(write_addr)) {
+        // Current sector full: move into the other one, recycling it unless
+        // spool_prepare() already did
+        uint8_t next = cur ^ 1;
+        bool read_in_next = (read_addr & ~(SPOOL_SECTOR_SIZE - 1U)) == sector_addr[next];
+        bool prepared = spool_sector_prepared(next);
+
+        if (!prepared && !spool_format_sector(next, cur_gen + 1U)) {
+            return false;
+        }
+        cur = next;
+        cur_gen++;
+        write_addr = sector_addr[cur] + SPOOL_SLOT_SIZE;
+
+        if (!prepared && (read_in_next || pending == 0)) {
+            // Undelivered records in the recycled sector are gone: recount
+            uint32_t before = pending;
+            uint32_t first = 0;
+
+            pending = 0;
+            spool_scan_sector(cur ^ 1, &first);
+            dropped += before - pending;
+            read_addr = (first != 0) ? first : write_addr;
+        }
+    }
+
+    HAL_FLASH_Unlock();
+    for (uint8_t i = 0; i < 4 && ok; i++) {
+        ok = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, write_addr + 4U * i, w[i]) == HAL_OK);
+    }
+    HAL_FLASH_Lock();
+
+    // A failed slot is skipped, never reused
+    if (read_addr == write_addr) {
+        read_addr += SPOOL_SLOT_SIZE;
+    }
+    write_addr += SPOOL_SLOT_SIZE;
+    if (ok && w[0] > last_seq) {
+        last_seq = w[0];
+    }
+    return ok;
+}
+
+bool spool_append(const telemetry_record_t *rec)
+{
+    const uint32_t w[4] = {
+        rec->seq,
+        rec->t,
+        (uint32_t)rec->pA | ((uint32_t)rec->pB << 16),
+        0xFFFF0000U | ((uint32_t)SPOOL_COMMIT << 8) | rec->fan
+    };
+    bool was_empty = (pending == 0);
+
+    if (!spool_write_slot(w)) {
+        return false;
+    }
+    if (was_empty) {
+        read_addr = write_addr - SPOOL_SLOT_SIZE;
+    }
+    pending++;
+    return true;
+}
+
+bool spool_prepare(void)
+{
+    uint8_t next = cur ^ 1;
+    bool read_in_next = (pending > 0) &&
+                        (read_addr & ~(SPOOL_SECTOR_SIZE - 1U)) == sector_addr[next];
+
+    if (read_in_next || spool_sector_prepared(next)) {
+        return false;
+    }
+
+    // The erase takes that sector's lease slots with it: restate the
+    // highest number in the current sector first, so spool_init() still
+    // finds it after a reset
+    if (last_seq > 0 || lease_end > 0) {
+        const uint32_t w[4] = { (lease_end > last_seq) ? lease_end : last_seq, 0, 0,
+                                (uint32_t)SPOOL_COMMIT << 8 };
+        if (!spool_write_slot(w)) {
+            return false;
+        }
+        if (cur == next) {
+            return true; // that write wrapped and recycled the sector itself
+        }
+    }
+    return spool_format_sector(next, cur_gen + 1U);
+}
+
+void spool_lease_seq(uint32_t next_seq)
+{
+    if (next_seq < lease_end) {
+        return;
+    }
+    lease_end = next_seq + SPOOL_SEQ_LEASE;
+
+    // Committed but already consumed: only spool_init's max-seq scan sees it
+    const uint32_t w[4] = { lease_end, 0, 0, (uint32_t)SPOOL_COMMIT << 8 };
+    spool_write_slot(w);
+}
+
+uint16_t spool_peek(telemetry_record_t *out, uint16_t max)
+{
+    uint16_t n = 0;
+
+    for (uint32_t addr = read_addr; addr != write_addr && n < max; addr = spool_next(addr)) {
+        if (!spool_slot_pending(addr)) {
+            continue;
+        }
+        out[n].seq = SPOOL_WORD(addr, 0);
+        out[n].t   = SPOOL_WORD(addr, 1);
+        out[n].pA  = (uint16_t)SPOOL_WORD(addr, 2);
+        out[n].pB  = (uint16_t)(SPOOL_WORD(addr, 2) >> 16);
+        out[n].fan = (uint8_t)SPOOL_WORD(addr, 3);
+        n++;
+    }
+    return n;
+}
+
+void spool_consume(uint16_t n)
+{
+    HAL_FLASH_Unlock();
+    while (n > 0 && read_addr != write_addr) {
+        if (spool_slot_pending(read_addr)) {
+            // Clearing the consumed half-word only turns 1s into 0s
+            HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, read_addr + 12U,
+                              SPOOL_WORD(read_addr, 3) & 0x0000FFFFU);
+            pending--;
+            n--;
+        }
+        read_addr = spool_next(read_addr);
+    }
+    HAL_FLASH_Lock();
+
+    // Skip consumed/torn slots so spool_count() and peek start at real data
+    while (read_addr != write_addr && !spool_slot_pending(read_addr)) {
+        read_addr = spool_next(read_addr);
+    }
+}
+
+uint32_t spool_count(void)
+{
+    return pending;
+}
+
+uint32_t spool_last_seq(void)
+{
+    return last_seq;
+}
+
+uint32_t spool_dropped(void)
+{
+    return dropped;
+}
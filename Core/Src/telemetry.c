@@ -0,0 +1,220 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    telemetry.c
+  * @brief   Telemetry record queue and batch serialization
+  ******************************************************************************
+  */
+
+#include "telemetry.h"
+#include "json_builder.h"
+#include "bin_frame.h"
+#include <stddef.h>
+
+/* Private variables ---------------------------------------------------------*/
+/* Producer (TaskControl) and consumer (TaskComms) both run from the
+ * cooperative scheduler, so the queue needs no locking. */
+static telemetry_record_t queue[TELEMETRY_QUEUE_LEN];
+static uint16_t q_head = 0;   // Oldest record
+static uint16_t q_count = 0;
+static uint32_t q_dropped = 0;
+static uint32_t next_seq = 0;
+
+/* Batch element layouts, with and without the explicit "seq" */
+static json_template_t tpl_record;
+static json_template_t tpl_record_seq;
+static bool tpl_ready = false;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Prepare the batch element templates (once)
+  * @retval None
+  */
+static void telemetry_build_templates(void)
+{
+    json_template_t *tpls[2] = { &tpl_record, &tpl_record_seq };
+
+    for (uint8_t i = 0; i < 2; i++) {
+        json_template_init(tpls[i]);
+        json_template_add(tpls[i], "t", JSON_SLOT_UINT);
+        json_template_add(tpls[i], "pA", JSON_SLOT_UINT);
+        json_template_add(tpls[i], "pB", JSON_SLOT_UINT);
+        json_template_add(tpls[i], "fan", JSON_SLOT_BOOL);
+    }
+    json_template_add(&tpl_record_seq, "seq", JSON_SLOT_UINT);
+    json_template_end(&tpl_record);
+    json_template_end(&tpl_record_seq);
+    tpl_ready = true;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void telemetry_init(void)
+{
+    q_head = 0;
+    q_count = 0;
+    q_dropped = 0;
+}
+
+void telemetry_set_next_seq(uint32_t seq)
+{
+    next_seq = seq;
+}
+
+uint32_t telemetry_next_seq(void)
+{
+    return next_seq;
+}
+
+bool telemetry_push(const telemetry_record_t *rec)
+{
+    telemetry_record_t *slot;
+
+    if (q_count >= TELEMETRY_QUEUE_LEN) {
+        q_dropped++;
+        return false;
+    }
+    slot = &queue[(q_head + q_count) & (TELEMETRY_QUEUE_LEN - 1)];
+    *slot = *rec;
+    slot->seq = next_seq++;
+    q_count++;
+    return true;
+}
+
+uint16_t telemetry_count(void)
+{
+    return q_count;
+}
+
+uint16_t telemetry_peek(telemetry_record_t *out, uint16_t max)
+{
+    uint16_t n = (max < q_count) ? max : q_count;
+
+    for (uint16_t i = 0; i < n; i++) {
+        out[i] = queue[(q_head + i) & (TELEMETRY_QUEUE_LEN - 1)];
+    }
+    return n;
+}
+
+void telemetry_consume(uint16_t n)
+{
+    if (n > q_count) {
+        n = q_count;
+    }
+    q_head = (q_head + n) & (TELEMETRY_QUEUE_LEN - 1);
+    q_count -= n;
+}
+
+bool telemetry_batch_due(uint32_t now_ms, uint16_t batch_max, uint32_t max_latency_ms)
+{
+    if (q_count == 0) {
+        return false;
+    }
+    if (q_count >= batch_max) {
+        return true;
+    }
+    return (now_ms - queue[q_head].t) >= max_latency_ms;
+}
+
+uint32_t telemetry_dropped(void)
+{
+    return q_dropped;
+}
+
+int telemetry_build_json_batch(const telemetry_record_t *recs, uint16_t n,
+                               char *buf, uint16_t buf_size)
+{
+    uint16_t pos = 0;
+
+    if (buf_size < 3) {
+        return -1;
+    }
+    if (!tpl_ready) {
+        telemetry_build_templates();
+    }
+    buf[pos++] = '[';
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t values[5] = { recs[i].t, recs[i].pA, recs[i].pB, recs[i].fan, recs[i].seq };
+        const json_template_t *tpl = &tpl_record;
+        int len;
+
+        if (i > 0) {
+            buf[pos++] = ',';
+        }
+        if (i == 0 || recs[i].seq != recs[i - 1].seq + 1) {
+            tpl = &tpl_record_seq;
+        }
+
+        // Each element is rendered in place after the previous one, keeping
+        // room for ',' or ']' plus the terminator
+        if (pos + 2 > buf_size) {
+            return -1;
+        }
+        len = json_template_render(tpl, values, &buf[pos], buf_size - pos - 2);
+        if (len < 0) {
+            return -1;
+        }
+        pos += len;
+    }
+
+    buf[pos++] = ']';
+    buf[pos] = '\0';
+    return pos;
+}
+
+int telemetry_write_json_batch(const telemetry_record_t *recs, uint16_t n,
+                               json_stream_t *js, const char *key)
+{
+    if (!tpl_ready) {
+        telemetry_build_templates();
+    }
+    if (json_stream_begin_array(js, key) != 0) {
+        return -1;
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+        if (telemetry_write_json_record(recs, i, js) != 0) {
+            return -1;
+        }
+    }
+
+    return json_stream_end_array(js);
+}
+
+int telemetry_write_json_record(const telemetry_record_t *recs, uint16_t i, json_stream_t *js)
+{
+    uint32_t values[5] = { recs[i].t, recs[i].pA, recs[i].pB, recs[i].fan, recs[i].seq };
+    bool explicit_seq = (i == 0 || recs[i].seq != recs[i - 1].seq + 1);
+
+    if (!tpl_ready) {
+        telemetry_build_templates();
+    }
+    return json_stream_template(js, NULL, explicit_seq ? &tpl_record_seq : &tpl_record, values);
+}
+
+int telemetry_build_bin_batch(const telemetry_record_t *recs, uint16_t n,
+                              uint32_t device_id, uint16_t boot_id, uint32_t seq,
+                              uint8_t *buf, uint16_t buf_size, uint16_t *frame_len)
+{
+    bin_frame_t bf;
+    uint16_t i;
+
+    if (n == 0) {
+        return -1;
+    }
+    if (bin_frame_begin(&bf, buf, buf_size, device_id, boot_id, seq, recs[0].t, 3) != 0) {
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        const int32_t values[3] = { recs[i].pA, recs[i].pB, recs[i].fan };
+        if (bin_frame_add(&bf, recs[i].t, values) != 0) {
+            break; // Frame full: the rest goes in the next frame
+        }
+    }
+
+    *frame_len = (uint16_t)bin_frame_end(&bf);
+    return i;
+}
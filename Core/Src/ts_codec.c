@@ -0,0 +1,109 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    ts_codec.c
+  * @brief   Gorilla-style streaming compressor for multi-channel time series
+  ******************************************************************************
+  */
+
+#include "ts_codec.h"
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Append the low nbits of value, MSB first
+  * @param  enc: Encoder handle (room already checked)
+  * @param  value: Bits to write
+  * @param  nbits: Number of bits (1..32)
+  */
+static void ts_put_bits(ts_encoder_t *enc, uint32_t value, uint8_t nbits)
+{
+    while (nbits > 0) {
+        uint32_t byte = enc->bitpos >> 3;
+        uint8_t used = enc->bitpos & 7U;
+        uint8_t room = 8 - used;
+        uint8_t take = (nbits < room) ? nbits : room;
+        uint8_t chunk = (uint8_t)((value >> (nbits - take)) & ((1U << take) - 1U));
+
+        if (used == 0) {
+            enc->buffer[byte] = 0;
+        }
+        enc->buffer[byte] |= (uint8_t)(chunk << (room - take));
+        enc->bitpos += take;
+        nbits -= take;
+    }
+}
+
+/**
+  * @brief  Append a signed number with the prefix-bucket code
+  * @param  enc: Encoder handle
+  * @param  d: Value to encode
+  */
+static void ts_put_signed(ts_encoder_t *enc, int32_t d)
+{
+    uint32_t zz = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31); // zig-zag
+
+    if (zz == 0) {
+        ts_put_bits(enc, 0x0, 1);
+    } else if (zz < (1U << 7)) {
+        ts_put_bits(enc, 0x2, 2);
+        ts_put_bits(enc, zz, 7);
+    } else if (zz < (1U << 9)) {
+        ts_put_bits(enc, 0x6, 3);
+        ts_put_bits(enc, zz, 9);
+    } else if (zz < (1U << 12)) {
+        ts_put_bits(enc, 0xE, 4);
+        ts_put_bits(enc, zz, 12);
+    } else {
+        ts_put_bits(enc, 0xF, 4);
+        ts_put_bits(enc, zz, 32);
+    }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int ts_encoder_init(ts_encoder_t *enc, uint8_t *buf, uint16_t buf_size,
+                    uint32_t base_t, uint8_t channels)
+{
+    if (channels == 0 || channels > TS_CODEC_MAX_CHANNELS) {
+        return -1;
+    }
+
+    enc->buffer = buf;
+    enc->size = buf_size;
+    enc->bitpos = 0;
+    enc->count = 0;
+    enc->channels = channels;
+    enc->prev_t = base_t;
+    enc->prev_dt = 0;
+    for (uint8_t c = 0; c < channels; c++) {
+        enc->prev[c] = 0;
+    }
+    return 0;
+}
+
+int ts_encoder_add(ts_encoder_t *enc, uint32_t t, const int32_t *values)
+{
+    if (enc->count == 0xFFFF ||
+        enc->bitpos + TS_CODEC_SAMPLE_MAX_BITS(enc->channels) > (uint32_t)enc->size * 8U) {
+        return -1;
+    }
+
+    int32_t dt = (int32_t)(t - enc->prev_t);
+    ts_put_signed(enc, (int32_t)((uint32_t)dt - (uint32_t)enc->prev_dt));
+    enc->prev_t = t;
+    enc->prev_dt = dt;
+
+    for (uint8_t c = 0; c < enc->channels; c++) {
+        ts_put_signed(enc, (int32_t)((uint32_t)values[c] - (uint32_t)enc->prev[c]));
+        enc->prev[c] = values[c];
+    }
+
+    enc->count++;
+    return 0;
+}
+
+uint16_t ts_encoder_bytes(const ts_encoder_t *enc)
+{
+    return (uint16_t)((enc->bitpos + 7U) >> 3);
+}
@@ -0,0 +1,110 @@
+// bin_frame.js
+// Decoder for the compact binary telemetry frame (Core/Inc/bin_frame.h)
+//
+// Header (little-endian): magic "EF", version, channel count, device id,
+// sequence, base timestamp, sample count, boot id. Samples are, by version:
+//   1: varint time deltas followed by zig-zag varint value deltas per channel
+//   2: Gorilla-style bit stream, see ts_codec.js
+// CRC-16/CCITT-FALSE trailer over everything before it.
+
+const tsCodec = require('./ts_codec');
+
+const VERSION_VARINT = 1;
+const VERSION_TS_CODEC = 2;
+const HEADER_SIZE = 20;
+const CRC_SIZE = 2;
+
+// Channel order used by the firmware (telemetry_build_bin_batch)
+const CHANNELS = ['pA', 'pB', 'fan'];
+
+function crc16(buf, len) {
+  let crc = 0xffff;
+  for (let i = 0; i < len; i++) {
+    crc ^= buf[i] << 8;
+    for (let b = 0; b < 8; b++) {
+      crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+    }
+  }
+  return crc;
+}
+
+// Reads an unsigned LEB128 varint; returns [value, nextOffset]
+function readVarint(buf, off, end) {
+  let value = 0;
+  let shift = 0;
+  while (off < end) {
+    const byte = buf[off++];
+    value += (byte & 0x7f) * 2 ** shift;
+    if ((byte & 0x80) === 0) return [value, off];
+    shift += 7;
+    if (shift > 28) break;
+  }
+  throw new Error('Truncated or oversized varint');
+}
+
+function unzigzag(v) {
+  return v % 2 === 0 ? v / 2 : -(v + 1) / 2;
+}
+
+// Decodes a frame buffer into { deviceId, bootId, seq, baseT, channels, samples }
+// where samples is [{ t, values: [..] }]. Throws on malformed frames.
+function decodeFrame(buf) {
+  if (!Buffer.isBuffer(buf) || buf.length < HEADER_SIZE + CRC_SIZE) {
+    throw new Error('Frame too short');
+  }
+  if (buf[0] !== 0x45 || buf[1] !== 0x46) throw new Error('Bad magic');
+  const version = buf[2];
+  if (version !== VERSION_VARINT && version !== VERSION_TS_CODEC) {
+    throw new Error(`Unsupported version ${version}`);
+  }
+
+  const end = buf.length - CRC_SIZE;
+  if (crc16(buf, end) !== buf.readUInt16LE(end)) throw new Error('CRC mismatch');
+
+  const channels = buf[3];
+  const deviceId = buf.readUInt32LE(4);
+  const seq = buf.readUInt32LE(8);
+  const baseT = buf.readUInt32LE(12);
+  const count = buf.readUInt16LE(16);
+  const bootId = buf.readUInt16LE(18);
+
+  if (version === VERSION_TS_CODEC) {
+    const samples = tsCodec.decodeSamples(buf, HEADER_SIZE, end, baseT, channels, count);
+    return { deviceId, bootId, seq, baseT, channels, samples };
+  }
+
+  const samples = new Array(count);
+  const prev = new Array(channels).fill(0);
+  let t = baseT;
+  let off = HEADER_SIZE;
+  let dt;
+  let zz;
+
+  for (let i = 0; i < count; i++) {
+    [dt, off] = readVarint(buf, off, end);
+    t = (t + dt) >>> 0; // device tick wraps at 2^32
+    const values = new Array(channels);
+    for (let c = 0; c < channels; c++) {
+      [zz, off] = readVarint(buf, off, end);
+      prev[c] = (prev[c] + unzigzag(zz)) | 0;
+      values[c] = prev[c];
+    }
+    samples[i] = { t, values };
+  }
+  if (off !== end) throw new Error('Trailing bytes in frame');
+
+  return { deviceId, bootId, seq, baseT, channels, samples };
+}
+
+// Maps decoded samples onto the JSON record shape used by /api/energy
+function toRecords(frame) {
+  return frame.samples.map(({ t, values }) => {
+    const rec = { t };
+    CHANNELS.forEach((name, c) => {
+      if (c < values.length) rec[name] = values[c];
+    });
+    return rec;
+  });
+}
+
+module.exports = { decodeFrame, toRecords, crc16 };
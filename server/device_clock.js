@@ -0,0 +1,64 @@
+// device_clock.js
+// Maps device ticks (ms since boot, uint32, wraps after ~49.7 days) onto
+// server wall-clock time.
+//
+// Arrival time is an upper bound on when a record was taken, so the best
+// offset (wall - tick) is the smallest one seen. Batches and flash-spool
+// replays only arrive late, which makes them yield larger offsets that are
+// ignored. The offset may creep up by CLOCK_DRIFT per elapsed ms to follow
+// crystal drift. A new boot id means the device rebooted, and the offset is
+// taken afresh. Senders without a boot id fall back to the tick: one that
+// steps back more than RESET_SLACK_MS is taken as a reboot, which misses
+// reboots within the first RESET_SLACK_MS of uptime.
+
+const CLOCK_DRIFT = 1e-4;        // 100 ppm; STM32 HSI/HSE plus scheduling
+const RESET_SLACK_MS = 60 * 1000;
+
+class DeviceClock {
+  constructor() {
+    this.lastTick = null;   // raw uint32 tick of the newest record
+    this.unwrapped = 0;     // lastTick plus 2^32 per wrap
+    this.offset = 0;        // wall ms - unwrapped tick
+    this.lastArrival = 0;
+    this.bootId = undefined; // boot id of the newest record, if the sender has one
+    this.resets = 0;
+  }
+
+  // Returns { wall, tick, dt, reset } for a record with device tick t
+  // arriving at arrivalMs, from boot bootId (undefined if not known). tick
+  // is t unwrapped past 2^32; dt is the tick delta from the previous record
+  // (0 after a reset or for the first one).
+  map(t, arrivalMs, bootId = undefined) {
+    t >>>= 0;
+    let reset = false;
+    let dt = 0;
+
+    if (this.lastTick === null) {
+      reset = true;
+    } else {
+      dt = (t - this.lastTick) | 0; // signed 32-bit: handles the wrap
+      const known = bootId !== undefined && this.bootId !== undefined;
+      if (known ? bootId !== this.bootId : dt < -RESET_SLACK_MS) {
+        reset = true;
+        dt = 0;
+        this.resets++;
+      }
+    }
+    if (bootId !== undefined) this.bootId = bootId;
+
+    if (reset) {
+      this.unwrapped = t;
+      this.offset = arrivalMs - t;
+    } else {
+      this.unwrapped += dt;
+      const creep = Math.max(0, arrivalMs - this.lastArrival) * CLOCK_DRIFT;
+      this.offset = Math.min(this.offset + creep, arrivalMs - this.unwrapped);
+    }
+    this.lastTick = t;
+    this.lastArrival = arrivalMs;
+
+    return { wall: this.unwrapped + this.offset, tick: this.unwrapped, dt, reset };
+  }
+}
+
+module.exports = { DeviceClock };
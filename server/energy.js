@@ -0,0 +1,143 @@
+// energy.js
+// Per-load energy accumulation from telemetry, integrated on ingest.
+//
+// Power (mW) is integrated with the trapezoidal rule over device tick deltas
+// (DeviceClock's unwrapped tick, so the uint32 wrap is already handled).
+// After a device reset, a record that is not newer than the last one, or a
+// gap longer than ENERGY_MAX_GAP_MS, integration restarts from that record
+// instead of bridging an interval nobody measured.
+//
+// Totals are kept per local calendar day (server time zone) of the record's
+// wall time and persisted to a JSON file: { device: { "YYYY-MM-DD": [A, B] } }
+// with A and B in kWh.
+
+const fs = require('fs');
+const path = require('path');
+
+const ENERGY_MAX_GAP_MS = Number(process.env.ENERGY_MAX_GAP_MS) || 10000;
+const ENERGY_KEEP_DAYS = Number(process.env.ENERGY_KEEP_DAYS) || 90;
+const ENERGY_SAVE_MS = 10000;
+const MW_MS_PER_KWH = 3.6e12; // 1 kWh = 1e6 mW * 3.6e6 ms
+
+// Local calendar day of a wall time
+function dayKey(wall) {
+  const d = new Date(wall);
+  const mm = String(d.getMonth() + 1).padStart(2, '0');
+  const dd = String(d.getDate()).padStart(2, '0');
+  return `${d.getFullYear()}-${mm}-${dd}`;
+}
+
+class EnergyStore {
+  // file: JSON file for daily totals, or null for memory only
+  constructor({ file = null } = {}) {
+    this.file = file;
+    this.devices = new Map(); // id -> { day, today: [mW*ms A, B], prev, days }
+    this.dirty = false;
+    this.saving = false;
+
+    if (file) {
+      this.load();
+      this.timer = setInterval(() => this.save(), ENERGY_SAVE_MS);
+      this.timer.unref();
+    }
+  }
+
+  device(id) {
+    let m = this.devices.get(id);
+    if (!m) {
+      m = { day: null, today: [0, 0], prev: null, days: {} };
+      this.devices.set(id, m);
+    }
+    return m;
+  }
+
+  // Adds one record ({ pA, pB }) mapped by DeviceClock: tick is the
+  // unwrapped device tick, reset set on the first record after a reboot
+  add(id, { tick, wall, reset }, rec) {
+    const m = this.device(id);
+    const day = dayKey(wall);
+    if (day !== m.day) this.rollover(m, day);
+
+    const prev = m.prev;
+    if (prev && !reset && tick <= prev.tick) return; // late or duplicate
+    if (prev && !reset && tick - prev.tick <= ENERGY_MAX_GAP_MS) {
+      const dt = tick - prev.tick;
+      m.today[0] += (prev.pA + rec.pA) / 2 * dt;
+      m.today[1] += (prev.pB + rec.pB) / 2 * dt;
+      this.dirty = true;
+    }
+    m.prev = { tick, pA: rec.pA, pB: rec.pB };
+  }
+
+  // Closes the running day into the daily totals and opens `day`
+  rollover(m, day) {
+    if (m.day !== null) {
+      m.days[m.day] = m.today.map((e) => e / MW_MS_PER_KWH);
+      const keys = Object.keys(m.days).sort();
+      for (const k of keys.slice(0, Math.max(0, keys.length - ENERGY_KEEP_DAYS))) delete m.days[k];
+      this.dirty = true;
+    }
+    // Reopening a day that was already saved continues its total
+    const saved = m.days[day];
+    m.today = saved ? saved.map((e) => e * MW_MS_PER_KWH) : [0, 0];
+    m.day = day;
+  }
+
+  // Today's energy in kWh per load; zero when nothing has come in today
+  today(id, now = Date.now()) {
+    const m = this.devices.get(id);
+    if (!m || m.day !== dayKey(now)) return { A: 0, B: 0, total: 0 };
+    const A = m.today[0] / MW_MS_PER_KWH;
+    const B = m.today[1] / MW_MS_PER_KWH;
+    return { A, B, total: A + B };
+  }
+
+  // Daily totals in kWh, oldest first, including the running day
+  daily(id) {
+    const m = this.devices.get(id);
+    if (!m) return [];
+    const days = { ...m.days };
+    if (m.day !== null) days[m.day] = m.today.map((e) => e / MW_MS_PER_KWH);
+    return Object.keys(days).sort().map((day) => {
+      const [A, B] = days[day];
+      return { day, A, B, total: A + B };
+    });
+  }
+
+  load() {
+    let saved;
+    try {
+      saved = JSON.parse(fs.readFileSync(this.file, 'utf8'));
+    } catch (err) {
+      if (err.code !== 'ENOENT') console.error(`[energy] ${this.file}: ${err.message}`);
+      return;
+    }
+    for (const [id, days] of Object.entries(saved)) this.device(id).days = days;
+  }
+
+  // Writes all daily totals (running days included) via a temp file
+  save() {
+    if (!this.file || !this.dirty || this.saving) return;
+    const out = {};
+    for (const id of this.devices.keys()) {
+      out[id] = Object.fromEntries(this.daily(id).map((d) => [d.day, [d.A, d.B]]));
+    }
+    this.dirty = false;
+    this.saving = true;
+    const tmp = `${this.file}.tmp`;
+    fs.mkdirSync(path.dirname(this.file), { recursive: true });
+    fs.writeFile(tmp, JSON.stringify(out), (err) => {
+      if (err) {
+        this.saving = false;
+        this.dirty = true;
+        return console.error(`[energy] ${err.message}`);
+      }
+      fs.rename(tmp, this.file, (err2) => {
+        this.saving = false;
+        if (err2) console.error(`[energy] ${err2.message}`);
+      });
+    });
+  }
+}
+
+module.exports = { EnergyStore, dayKey };
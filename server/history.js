@@ -0,0 +1,317 @@
+// history.js
+// Telemetry history per device: an in-memory ring of fixed-width time slots
+// (HISTORY_SLOT_MS, mean of the records inside) backed by append-only
+// segment files, so a restart picks up where it left off. Range queries
+// downsample the ring into at most HISTORY_MAX_POINTS buckets.
+//
+// Segment files live in <dir>/<device>/<first slot ms>.seg. Each slot is one
+// little-endian record of SLOT_BYTES: float64 slot start (wall ms), then a
+// float32 mean per channel (pA, pB in mW, fan as the fraction of time on).
+
+const fs = require('fs');
+const path = require('path');
+
+const CHANNELS = ['pA', 'pB', 'fan'];
+const SLOT_BYTES = 8 + 4 * CHANNELS.length;
+
+const HISTORY_SLOT_MS = Number(process.env.HISTORY_SLOT_MS) || 500;                 // 2 Hz
+const HISTORY_RING_SLOTS = Number(process.env.HISTORY_RING_SLOTS) || 24 * 3600 * 2; // one day
+const HISTORY_SEGMENT_BYTES = 4 * 1024 * 1024;
+const HISTORY_RETENTION_MS = (Number(process.env.HISTORY_RETENTION_DAYS) || 7) * 86400000;
+const HISTORY_FLUSH_MS = 1000;
+const HISTORY_MAX_POINTS = 2000;
+const RING_INITIAL_SLOTS = 1024;
+
+// Fixed-capacity ring of slots, oldest first; grows by doubling up to its
+// capacity so idle devices stay small
+class SlotRing {
+  constructor(capacity) {
+    this.capacity = capacity;
+    this.size = 0;
+    this.head = 0; // index of the oldest slot
+    this.alloc(Math.min(RING_INITIAL_SLOTS, capacity));
+  }
+
+  alloc(n) {
+    const ts = new Float64Array(n);
+    const values = new Float32Array(n * CHANNELS.length);
+    for (let i = 0; i < this.size; i++) {
+      const j = (this.head + i) % this.ts.length;
+      ts[i] = this.ts[j];
+      values.set(this.values.subarray(j * CHANNELS.length, (j + 1) * CHANNELS.length),
+        i * CHANNELS.length);
+    }
+    this.ts = ts;
+    this.values = values;
+    this.head = 0;
+  }
+
+  push(t, means) {
+    if (this.size === this.ts.length && this.size < this.capacity) {
+      this.alloc(Math.min(this.ts.length * 2, this.capacity));
+    }
+    let j;
+    if (this.size < this.ts.length) {
+      j = (this.head + this.size) % this.ts.length;
+      this.size++;
+    } else {
+      j = this.head; // full: overwrite the oldest
+      this.head = (this.head + 1) % this.ts.length;
+    }
+    this.ts[j] = t;
+    for (let c = 0; c < CHANNELS.length; c++) this.values[j * CHANNELS.length + c] = means[c];
+  }
+
+  at(i) {
+    return (this.head + i) % this.ts.length;
+  }
+
+  lastTs() {
+    return this.size ? this.ts[this.at(this.size - 1)] : -Infinity;
+  }
+
+  // First logical index with ts >= t
+  lowerBound(t) {
+    let lo = 0;
+    let hi = this.size;
+    while (lo < hi) {
+      const mid = (lo + hi) >> 1;
+      if (this.ts[this.at(mid)] < t) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+}
+
+class DeviceHistory {
+  constructor(store, device) {
+    this.store = store;
+    this.device = device;
+    this.ring = new SlotRing(store.ringSlots);
+    this.slot = null;                       // slot start of the open slot
+    this.sums = new Float64Array(CHANNELS.length);
+    this.count = 0;
+    this.late = 0;                          // records for an already-closed slot
+    this.pending = [];                      // encoded slots not yet on disk
+    this.writing = false;
+    this.segment = null;                    // { file, bytes }
+  }
+
+  // Adds one record; values in CHANNELS order. A record for a slot that
+  // is already closed is counted and dropped: the ring is append-only.
+  add(wall, values) {
+    const slot = Math.floor(wall / this.store.slotMs) * this.store.slotMs;
+    if (this.slot !== null && slot > this.slot) this.close();
+    if (this.slot === null) {
+      if (slot <= this.ring.lastTs()) {
+        this.late++;
+        return;
+      }
+      this.slot = slot;
+    } else if (slot < this.slot) {
+      this.late++;
+      return;
+    }
+    for (let c = 0; c < CHANNELS.length; c++) this.sums[c] += values[c];
+    this.count++;
+  }
+
+  close() {
+    const means = Array.from(this.sums, (s) => s / this.count);
+    this.ring.push(this.slot, means);
+    if (this.store.dir) this.pending.push(encodeSlot(this.slot, means));
+    this.slot = null;
+    this.sums.fill(0);
+    this.count = 0;
+  }
+
+  dir() {
+    return path.join(this.store.dir, this.device);
+  }
+
+  // Appends pending slots to the current segment, rotating by size
+  flush() {
+    if (this.writing || this.pending.length === 0) return;
+    const buf = Buffer.concat(this.pending);
+    const firstSlot = buf.readDoubleLE(0);
+    this.pending = [];
+
+    if (!this.segment || this.segment.bytes + buf.length > HISTORY_SEGMENT_BYTES) {
+      fs.mkdirSync(this.dir(), { recursive: true });
+      this.segment = { file: path.join(this.dir(), `${firstSlot}.seg`), bytes: 0 };
+      this.prune(firstSlot);
+    }
+    this.writing = true;
+    this.segment.bytes += buf.length;
+    fs.appendFile(this.segment.file, buf, (err) => {
+      this.writing = false;
+      if (err) console.error(`[history] ${this.device}: ${err.message}`);
+    });
+  }
+
+  // Deletes segments whose successor starts before the retention horizon
+  prune(now) {
+    const files = listSegments(this.dir());
+    for (let i = 0; i + 1 < files.length; i++) {
+      if (files[i + 1].start < now - this.store.retentionMs) {
+        fs.unlink(path.join(this.dir(), files[i].name), () => {});
+      }
+    }
+  }
+
+  // Refills the ring from the newest segments on startup
+  load() {
+    const files = listSegments(this.dir());
+    const chunks = [];
+    let slots = 0;
+    for (let i = files.length - 1; i >= 0 && slots < this.ring.capacity; i--) {
+      const buf = fs.readFileSync(path.join(this.dir(), files[i].name));
+      const whole = buf.length - (buf.length % SLOT_BYTES); // drop a torn tail
+      chunks.unshift(buf.subarray(0, whole));
+      slots += whole / SLOT_BYTES;
+    }
+
+    const means = new Array(CHANNELS.length);
+    for (const buf of chunks) {
+      for (let off = 0; off < buf.length; off += SLOT_BYTES) {
+        const t = buf.readDoubleLE(off);
+        if (t <= this.ring.lastTs()) continue;
+        for (let c = 0; c < CHANNELS.length; c++) means[c] = buf.readFloatLE(off + 8 + 4 * c);
+        this.ring.push(t, means);
+      }
+    }
+    return this.ring.size;
+  }
+
+  // Buckets of `step` ms over [from, to): bucket start and channel means
+  query(from, to, step) {
+    const out = { t: [] };
+    for (const ch of CHANNELS) out[ch] = [];
+    const ring = this.ring;
+    const sums = new Float64Array(CHANNELS.length);
+    let bucket = null;
+    let n = 0;
+
+    const emit = () => {
+      out.t.push(bucket);
+      for (let c = 0; c < CHANNELS.length; c++) {
+        out[CHANNELS[c]].push(Math.round(sums[c] / n * 1000) / 1000);
+      }
+      sums.fill(0);
+      n = 0;
+    };
+    const take = (t, get) => {
+      const b = from + Math.floor((t - from) / step) * step;
+      if (bucket !== null && b !== bucket) emit();
+      bucket = b;
+      for (let c = 0; c < CHANNELS.length; c++) sums[c] += get(c);
+      n++;
+    };
+
+    for (let i = ring.lowerBound(from); i < ring.size; i++) {
+      const j = ring.at(i);
+      const t = ring.ts[j];
+      if (t >= to) break;
+      take(t, (c) => ring.values[j * CHANNELS.length + c]);
+    }
+    // The open slot, so the newest data shows up before its slot closes
+    if (this.slot !== null && this.slot >= from && this.slot < to) {
+      take(this.slot, (c) => this.sums[c] / this.count);
+    }
+    if (n > 0) emit();
+    return out;
+  }
+}
+
+function encodeSlot(t, means) {
+  const buf = Buffer.allocUnsafe(SLOT_BYTES);
+  buf.writeDoubleLE(t, 0);
+  for (let c = 0; c < CHANNELS.length; c++) buf.writeFloatLE(means[c], 8 + 4 * c);
+  return buf;
+}
+
+function listSegments(dir) {
+  let names;
+  try {
+    names = fs.readdirSync(dir);
+  } catch {
+    return [];
+  }
+  return names
+    .filter((name) => name.endsWith('.seg'))
+    .map((name) => ({ name, start: Number(name.slice(0, -4)) }))
+    .filter((f) => Number.isFinite(f.start))
+    .sort((a, b) => a.start - b.start);
+}
+
+// Device ids become directory names
+function safeDevice(device) {
+  return String(device).replace(/[^A-Za-z0-9_-]/g, '_') || 'default';
+}
+
+class HistoryStore {
+  // dir: segment directory, or null for memory only
+  constructor({ dir = null, slotMs = HISTORY_SLOT_MS, ringSlots = HISTORY_RING_SLOTS,
+    retentionMs = HISTORY_RETENTION_MS } = {}) {
+    this.dir = dir;
+    this.slotMs = slotMs;
+    this.ringSlots = ringSlots;
+    this.retentionMs = retentionMs;
+    this.devices = new Map();
+    this.timer = null;
+
+    if (dir) {
+      fs.mkdirSync(dir, { recursive: true });
+      for (const name of fs.readdirSync(dir)) {
+        if (fs.statSync(path.join(dir, name)).isDirectory()) this.device(name).load();
+      }
+      this.timer = setInterval(() => this.flush(), HISTORY_FLUSH_MS);
+      this.timer.unref();
+    }
+  }
+
+  device(id) {
+    let h = this.devices.get(id); // ids from server.js are already safe
+    if (h) return h;
+    const key = safeDevice(id);
+    h = this.devices.get(key);
+    if (!h) {
+      h = new DeviceHistory(this, key);
+      this.devices.set(key, h);
+    }
+    return h;
+  }
+
+  // Records one parsed telemetry record ({ pA, pB, fan }) at wall time
+  append(device, wall, rec) {
+    this.device(device).add(wall, [rec.pA, rec.pB, rec.fan ? 1 : 0]);
+  }
+
+  flush() {
+    for (const h of this.devices.values()) h.flush();
+  }
+
+  // Downsampled series for [from, to); step is raised so that at most
+  // HISTORY_MAX_POINTS buckets come back, and is never below one slot
+  query(device, from, to, step) {
+    const minStep = Math.max(this.slotMs, Math.ceil((to - from) / HISTORY_MAX_POINTS));
+    step = Math.max(Number.isFinite(step) ? step : 0, minStep);
+    const h = this.devices.get(safeDevice(device));
+    const series = h ? h.query(from, to, step) : { t: [], pA: [], pB: [], fan: [] };
+    return { device: safeDevice(device), from, to, step, ...series };
+  }
+
+  stats() {
+    const devices = {};
+    for (const [id, h] of this.devices) {
+      devices[id] = {
+        slots: h.ring.size,
+        oldest: h.ring.size ? h.ring.ts[h.ring.head] : null,
+        late: h.late
+      };
+    }
+    return { slotMs: this.slotMs, ringSlots: this.ringSlots, devices };
+  }
+}
+
+module.exports = { HistoryStore, CHANNELS };
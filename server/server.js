@@ -5,46 +5,242 @@
 const express = require('express');
 const cors = require('cors');
 const path = require('path');
+const crypto = require('crypto');
+const binFrame = require('./bin_frame');
+const { startUdpIngest } = require('./udp_ingest');
+const { startTcpIngest } = require('./tcp_ingest');
+const { DeviceClock } = require('./device_clock');
+const { HistoryStore } = require('./history');
+const { EnergyStore } = require('./energy');
+const { StatusStream } = require('./status_stream');
 
 const app = express();
-const PORT = 3000;
+const PORT = Number(process.env.PORT) || 3000;
+const UDP_PORT = Number(process.env.UDP_PORT) || 3001;
+const TCP_PORT = Number(process.env.TCP_PORT) || 3002;
 
 // Middleware
 app.use(cors());
 app.use(express.json());
 
-// Store latest sensor data
-let latestData = {
-  t: 0,        // timestamp
-  pA: 0,       // power A in mW
-  pB: 0,       // power B in mW
-  fan: false   // fan state (true = ON, false = OFF)
-};
+// Per-device state, keyed by device id. Boards name themselves with an
+// X-Device-Id header or a "dev" field; binary frames carry their id, which
+// JSON posts from the same firmware send as the same 8 hex digits.
+const devices = new Map();
+const DEVICE_ID_RE = /^[A-Za-z0-9_-]{1,64}$/;
+
+// Device that /status, /stream and /history show without ?device=:
+// DEFAULT_DEVICE, otherwise the first one to report
+let primaryDevice = process.env.DEFAULT_DEVICE || null;
+
+function deviceState(id) {
+  let dev = devices.get(id);
+  if (!dev) {
+    dev = {
+      id,
+      latest: { t: 0, pA: 0, pB: 0, fan: false }, // newest record (mW)
+      lastSeq: -1,        // see ingestRecords()
+      bootId: undefined,  // boot the lastSeq window belongs to
+      restarts: 0,        // boot id changes seen
+      clock: new DeviceClock(),
+      records: 0,
+      lastSeenAt: 0,      // server ms
+      status: null        // cached /status body, see statusBody()
+    };
+    devices.set(id, dev);
+    if (primaryDevice === null) primaryDevice = id;
+  }
+  return dev;
+}
+
+// Device id of a request: ?device=, X-Device-Id or the "dev" field of the
+// (first) record, in that order; `fallback` when none is given.
+// Returns null for an id that is not [A-Za-z0-9_-]{1,64}.
+function requestDevice(req, fallback) {
+  const first = Array.isArray(req.body) ? req.body[0] : req.body;
+  const id = req.query.device || req.get('X-Device-Id') ||
+    (first && typeof first === 'object' && first.dev) || fallback;
+  return DEVICE_ID_RE.test(String(id)) ? String(id) : null;
+}
+
+// Boot id of a JSON post (X-Boot-Id, decimal 0..65535, the same value binary
+// frames carry), or undefined when absent or malformed
+function requestBootId(req) {
+  const h = req.get('X-Boot-Id');
+  if (h === undefined || !/^\d{1,5}$/.test(h)) return undefined;
+  const id = Number(h);
+  return id <= 0xFFFF ? id : undefined;
+}
+
+// Time-series history (ring per device + segment files, see history.js).
+// HISTORY_DIR="" keeps it in memory only.
+const HISTORY_DIR = process.env.HISTORY_DIR ?? path.join(__dirname, 'data', 'history');
+const history = new HistoryStore({ dir: HISTORY_DIR || null });
+
+// Daily energy per load, integrated on ingest (see energy.js).
+// ENERGY_FILE="" keeps it in memory only.
+const ENERGY_FILE = process.env.ENERGY_FILE ?? path.join(__dirname, 'data', 'energy.json');
+const energy = new EnergyStore({ file: ENERGY_FILE || null });
 
 // Serve static files from web folder
 app.use(express.static(path.join(__dirname, '../web')));
 
 // ===== API Endpoints =====
 
-// Receive data from STM32
-app.post('/api/energy', (req, res) => {
-  const { t, pA, pB, fan } = req.body;
-  
-  // Update latest data
-  latestData = {
+// Normalize one telemetry record from the STM32
+function parseRecord(body) {
+  const { t, pA, pB, fan } = body || {};
+  return {
     t: t || 0,
     pA: pA || 0,
     pB: pB || 0,
     fan: fan === true || fan === 1 || fan === 'true' || fan === '1'
   };
+}
+
+// Each device keeps the highest record sequence number ingested. The STM32
+// replays records spooled in flash after an outage, and a batch whose
+// SEND OK got lost is sent again, so anything at or below it is a duplicate.
+// The window belongs to one boot: numbering restarts at 0 after a reboot
+// without the spool, so a new boot id starts a new window.
+
+// Larger backward jumps mean the device lost its spool; start over
+const SEQ_RESET_GAP = 1 << 20;
+
+// Fills in record sequence numbers: the firmware writes "seq" on the first
+// record of a batch and wherever the numbering is not previous + 1.
+// Records without any seq (binary frames, older firmware) stay undefined.
+function assignSeq(records) {
+  let prev;
+  return records.map((rec) => {
+    let seq;
+    if (rec && Number.isInteger(rec.seq)) seq = rec.seq;
+    else if (prev !== undefined) seq = prev + 1;
+    prev = seq;
+    return seq;
+  });
+}
+
+// Ingest records (oldest first) of one device from any transport.
+// bootId: the sender's boot id, undefined if it did not send one.
+// Work is per record plus one map lookup, whatever the fleet size.
+// Returns the number of records dropped as duplicates.
+function ingestRecords(records, source, deviceId = 'default', bootId = undefined) {
+  const dev = deviceState(deviceId);
+  if (bootId !== undefined && bootId !== dev.bootId) {
+    if (dev.bootId !== undefined) {
+      dev.restarts++;
+      dev.lastSeq = -1;
+    }
+    dev.bootId = bootId;
+  }
+  const seqs = assignSeq(records);
+  const fresh = records.filter((rec, i) => {
+    const seq = seqs[i];
+    if (seq === undefined) return true;
+    if (seq <= dev.lastSeq && dev.lastSeq - seq < SEQ_RESET_GAP) return false;
+    dev.lastSeq = seq;
+    return true;
+  });
+  const duplicates = records.length - fresh.length;
+  const who = deviceId === 'default' ? '' : `${deviceId}: `;
+
+  if (fresh.length === 0) {
+    console.log(`[${new Date().toISOString()}] ${who}Dropped ${source} batch of ${records.length} (already received)`);
+    return duplicates;
+  }
+
+  // Place each record on the wall clock from its device tick, then record
+  // it and integrate its energy
+  const now = Date.now();
+  for (const rec of fresh) {
+    const parsed = parseRecord(rec);
+    const clock = dev.clock.map(parsed.t, now, dev.bootId);
+    history.append(deviceId, clock.wall, parsed);
+    energy.add(deviceId, clock, parsed);
+  }
+
+  // Update latest data (newest record of the batch)
+  const latestData = parseRecord(fresh[fresh.length - 1]);
+  dev.latest = latestData;
+  dev.status = null;
+  dev.records += fresh.length;
+  dev.lastSeenAt = now;
   
-  console.log(`[${new Date().toISOString()}] Received: pA=${latestData.pA} mW, pB=${latestData.pB} mW, fan=${latestData.fan ? 'ON' : 'OFF'}`);
-  
-  res.json({ status: 'OK', message: 'Data received' });
+  const dupInfo = duplicates > 0 ? `, ${duplicates} duplicates` : '';
+  const batchInfo = fresh.length > 1 || duplicates > 0 ? ` (${source} batch of ${fresh.length}${dupInfo})` : '';
+  console.log(`[${new Date().toISOString()}] ${who}Received: pA=${latestData.pA} mW, pB=${latestData.pB} mW, fan=${latestData.fan ? 'ON' : 'OFF'}${batchInfo}`);
+  notifyStreams(deviceId);
+  return duplicates;
+}
+
+// With INGEST_MAX_POSTS_PER_S set, posts beyond that rate (all devices
+// together) are shed with 503 and a retry delay. The firmware keeps the
+// records and comes back later with a fuller batch (comms_pace() in main.c).
+const INGEST_MAX_POSTS_PER_S = Number(process.env.INGEST_MAX_POSTS_PER_S) || 0;
+let ingestTokens = INGEST_MAX_POSTS_PER_S;
+let ingestRefilled = Date.now();
+
+function shedIngest(req, res, next) {
+  if (INGEST_MAX_POSTS_PER_S <= 0) return next();
+
+  const now = Date.now();
+  ingestTokens = Math.min(INGEST_MAX_POSTS_PER_S,
+    ingestTokens + (now - ingestRefilled) * INGEST_MAX_POSTS_PER_S / 1000);
+  ingestRefilled = now;
+  if (ingestTokens >= 1) {
+    ingestTokens -= 1;
+    return next();
+  }
+
+  // Time until the next post would be admitted
+  const waitMs = Math.ceil((1 - ingestTokens) * 1000 / INGEST_MAX_POSTS_PER_S);
+  res.set('Retry-After', String(Math.ceil(waitMs / 1000)));
+  res.set('X-Retry-After-Ms', String(waitMs));
+  res.status(503).json({ status: 'BUSY', message: 'Ingest rate limit', retry_after_ms: waitMs });
+}
+
+// Receive data from STM32
+// Accepts a single object or a batch: an array of objects, oldest first
+app.post('/api/energy', shedIngest, (req, res) => {
+  const records = Array.isArray(req.body) ? req.body : [req.body];
+  if (records.length === 0) {
+    return res.status(400).json({ status: 'ERROR', message: 'Empty batch' });
+  }
+  const deviceId = requestDevice(req, 'default');
+  if (deviceId === null) {
+    return res.status(400).json({ status: 'ERROR', message: 'Bad device id' });
+  }
+
+  const duplicates = ingestRecords(records, 'json', deviceId, requestBootId(req));
+  res.json({ status: 'OK', message: 'Data received', count: records.length, duplicates });
 });
 
-// Serve status to web dashboard
-app.get('/status', (req, res) => {
+// Receive binary frames from STM32 (see bin_frame.js for the format)
+app.post('/api/energy/bin', shedIngest,
+  express.raw({ type: 'application/octet-stream', limit: '64kb' }),
+  (req, res) => {
+    let frame;
+    try {
+      frame = binFrame.decodeFrame(req.body);
+    } catch (err) {
+      return res.status(400).json({ status: 'ERROR', message: err.message });
+    }
+    if (frame.samples.length === 0) {
+      return res.json({ status: 'OK', message: 'Empty frame', seq: frame.seq, count: 0 });
+    }
+
+    const deviceId = requestDevice(req, frame.deviceId.toString(16).padStart(8, '0'));
+    if (deviceId === null) {
+      return res.status(400).json({ status: 'ERROR', message: 'Bad device id' });
+    }
+    ingestRecords(binFrame.toRecords(frame), `bin seq=${frame.seq}`, deviceId, frame.bootId);
+    res.json({ status: 'OK', message: 'Data received', seq: frame.seq, count: frame.samples.length });
+  });
+
+// Dashboard status built from a device's latest record
+function buildStatus(dev) {
+  const latestData = dev ? dev.latest : { t: 0, pA: 0, pB: 0, fan: false };
   const totalPower = latestData.pA + latestData.pB; // Total in mW
   const threshold = 600; // Default threshold in mW (matches STM32)
   
@@ -54,20 +250,24 @@ app.get('/status', (req, res) => {
   
   // Overall fan control state (from STM32 - when both cross threshold)
   const fanControlState = latestData.fan ? 'ON' : 'OFF';
+
+  const today = energy.today(dev ? dev.id : null);
   
-  res.json({
+  return {
     totals: {
       total_power: totalPower,  // in mW
-      energy_today_kWh: 0        // TODO: implement energy accumulation
+      energy_today_kWh: today.total
     },
     loads: {
       fanA: {
         power: latestData.pA,   // in mW
-        state: fanAState
+        state: fanAState,
+        energy_today_kWh: today.A
       },
       fanB: {
         power: latestData.pB,   // in mW
-        state: fanBState
+        state: fanBState,
+        energy_today_kWh: today.B
       }
     },
     fan: {
@@ -77,10 +277,194 @@ app.get('/status', (req, res) => {
     thresholds: {
       fan_power_limit: threshold,  // in mW (default threshold)
       total_power_limit: 1200      // in mW
-    }
+    },
+    device: dev ? dev.id : null,
+    last_seen: dev && dev.lastSeenAt ? new Date(dev.lastSeenAt).toISOString() : null
+  };
+}
+
+// Device selected by ?device= (the primary device without it). Sends 400
+// and returns undefined for a bad id; null means nothing has reported yet.
+function queryDevice(req, res) {
+  const id = req.query.device === undefined ? primaryDevice : requestDevice(req, null);
+  if (id === null && req.query.device !== undefined) {
+    res.status(400).json({ status: 'ERROR', message: 'Bad device id' });
+    return undefined;
+  }
+  return id;
+}
+
+// Serialized status of a device: { json, body, etag }. Built at most once
+// per ingested update (and again at local midnight, when energy_today
+// starts over) and shared by /status and /stream.
+function statusBody(dev) {
+  const now = Date.now();
+  if (dev && dev.status && now < dev.status.expires) return dev.status;
+
+  const json = JSON.stringify(buildStatus(dev));
+  const body = Buffer.from(json);
+  const midnight = new Date(now);
+  midnight.setHours(24, 0, 0, 0);
+  const status = {
+    json,
+    body,
+    etag: `"${crypto.createHash('sha1').update(body).digest('base64url')}"`,
+    expires: midnight.getTime()
+  };
+  if (dev) dev.status = status;
+  return status;
+}
+
+// True if an If-None-Match header lists etag (or is "*")
+function etagMatches(header, etag) {
+  if (!header) return false;
+  if (header.trim() === '*') return true;
+  return header.split(',').some((tag) => tag.trim().replace(/^W\//, '') === etag);
+}
+
+// Serve status to web dashboard: /status?device=<id>
+// Answers from the cached body; 304 when the client already has it.
+app.get('/status', (req, res) => {
+  const id = queryDevice(req, res);
+  if (id === undefined) return;
+  if (req.query.device !== undefined && !devices.has(id)) {
+    return res.status(404).json({ status: 'ERROR', message: 'Unknown device' });
+  }
+
+  const status = statusBody(devices.get(id));
+  res.setHeader('ETag', status.etag);
+  res.setHeader('Cache-Control', 'no-cache'); // always revalidate
+  if (etagMatches(req.headers['if-none-match'], status.etag)) {
+    res.statusCode = 304;
+    return res.end();
+  }
+  res.setHeader('Content-Type', 'application/json; charset=utf-8');
+  res.end(status.body);
+});
+
+// Fleet summary: every device's latest power and today's energy
+app.get('/devices', (req, res) => {
+  const list = [];
+  let totalPower = 0;
+  let totalEnergy = 0;
+  for (const dev of devices.values()) {
+    const today = energy.today(dev.id);
+    const power = dev.latest.pA + dev.latest.pB;
+    totalPower += power;
+    totalEnergy += today.total;
+    list.push({
+      id: dev.id,
+      total_power: power,      // in mW
+      pA: dev.latest.pA,
+      pB: dev.latest.pB,
+      fan: dev.latest.fan,
+      energy_today_kWh: today.total,
+      records: dev.records,
+      restarts: dev.restarts,
+      last_seen: new Date(dev.lastSeenAt).toISOString()
+    });
+  }
+  res.json({
+    count: list.length,
+    primary: primaryDevice,
+    totals: { total_power: totalPower, energy_today_kWh: totalEnergy },
+    devices: list
   });
 });
 
+// Push status to dashboards as Server-Sent Events:
+// /stream?interval=<ms>&device=<id>. One stream per watched device, made
+// on first use and dropped when its last client leaves; the key null
+// follows the primary device.
+const streams = new Map();
+
+function streamFor(id) {
+  let stream = streams.get(id);
+  if (!stream) {
+    const build = id === null ? () => statusBody(devices.get(primaryDevice)).json
+      : () => statusBody(devices.get(id)).json;
+    stream = new StatusStream(build, () => {
+      stream.close();
+      streams.delete(id);
+    });
+    streams.set(id, stream);
+  }
+  return stream;
+}
+
+function notifyStreams(id) {
+  const stream = streams.get(id);
+  if (stream) stream.notify();
+  if (id === primaryDevice) {
+    const primary = streams.get(null);
+    if (primary) primary.notify();
+  }
+}
+
+app.get('/stream', (req, res) => {
+  const id = req.query.device === undefined ? null : requestDevice(req, null);
+  if (id === null && req.query.device !== undefined) {
+    return res.status(400).json({ status: 'ERROR', message: 'Bad device id' });
+  }
+  if (id !== null && !devices.has(id)) {
+    return res.status(404).json({ status: 'ERROR', message: 'Unknown device' });
+  }
+  streamFor(id).handle(req, res);
+});
+
+app.get('/stream/stats', (req, res) => {
+  const out = {};
+  for (const [id, stream] of streams) out[id === null ? '(primary)' : id] = stream.stats();
+  res.json(out);
+});
+
+// Parses a query time: epoch ms or anything Date.parse() accepts
+function parseTime(value, fallback) {
+  if (value === undefined || value === '') return fallback;
+  const n = Number(value);
+  return Number.isFinite(n) ? n : Date.parse(value);
+}
+
+// Downsampled history: /history?from=&to=&step= (ms; default the last hour).
+// Returns columns { t, pA, pB, fan } of bucket means, empty buckets omitted.
+app.get('/history', (req, res) => {
+  const to = parseTime(req.query.to, Date.now());
+  const from = parseTime(req.query.from, to - 3600 * 1000);
+  const step = req.query.step === undefined ? undefined : Number(req.query.step);
+  if (!Number.isFinite(from) || !Number.isFinite(to) || from >= to ||
+      (step !== undefined && !(step > 0))) {
+    return res.status(400).json({ status: 'ERROR', message: 'Bad from/to/step' });
+  }
+  const id = queryDevice(req, res);
+  if (id === undefined) return;
+  res.json(history.query(id || 'default', from, to, step));
+});
+
+// Daily energy totals in kWh (local days, oldest first, today included)
+app.get('/energy/daily', (req, res) => {
+  const id = queryDevice(req, res);
+  if (id === undefined) return;
+  res.json({ device: id, days: energy.daily(id) });
+});
+
+// UDP telemetry: per-device loss / reordering counters
+const udpIngest = startUdpIngest({ port: UDP_PORT, onRecords: ingestRecords });
+
+app.get('/udp/stats', (req, res) => {
+  res.json(udpIngest.stats());
+});
+
+// TCP telemetry: length-prefixed frames on one connection per device
+const tcpIngest = startTcpIngest({
+  port: TCP_PORT,
+  onRecords: ingestRecords,
+  isDeviceId: (id) => DEVICE_ID_RE.test(id)
+});
+
+app.get('/tcp/stats', (req, res) => {
+  res.json(tcpIngest.stats());
+});
+
 // Control endpoint (for future use)
 app.post('/control', (req, res) => {
   const body = req.body;
@@ -96,7 +480,14 @@ app.listen(PORT, () => {
   console.log(`Server running on http://localhost:${PORT}`);
   console.log(`Web dashboard: http://localhost:${PORT}`);
   console.log(`API endpoint: http://localhost:${PORT}/api/energy`);
-  console.log(`Status endpoint: http://localhost:${PORT}/status`);
+  console.log(`Binary endpoint: http://localhost:${PORT}/api/energy/bin`);
+  console.log(`Status endpoint: http://localhost:${PORT}/status (?device=<id>)`);
+  console.log(`Fleet summary: http://localhost:${PORT}/devices`);
+  console.log(`Status stream (SSE): http://localhost:${PORT}/stream`);
+  console.log(`History: http://localhost:${PORT}/history?from=&to=&step= (${HISTORY_DIR || 'memory only'})`);
+  console.log(`Daily energy: http://localhost:${PORT}/energy/daily (${ENERGY_FILE || 'memory only'})`);
+  console.log(`UDP telemetry: udp://0.0.0.0:${UDP_PORT} (stats at /udp/stats)`);
+  console.log(`TCP telemetry: tcp://0.0.0.0:${TCP_PORT} (stats at /tcp/stats)`);
   console.log(`\nWaiting for STM32 data...\n`);
 });
 
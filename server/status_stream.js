@@ -0,0 +1,151 @@
+// status_stream.js
+// Server-Sent Events push of the dashboard status (GET /stream).
+// Nothing is sent until new telemetry arrives. Each client gets at most one
+// event per interval (?interval= ms, clamped); updates inside the interval
+// are coalesced and the client gets the newest status when it ends.
+//
+// Fan-out costs one serialization per update however many dashboards are
+// open: the event is built once into a shared Buffer, and clients are
+// grouped by interval so one timer writes that Buffer to the whole group.
+// A client whose socket stops draining is skipped (its intermediate frames
+// are dropped) and gets the newest frame once it drains; one that stays
+// stalled is disconnected and left to reconnect.
+
+const STREAM_INTERVAL_MS = Number(process.env.STREAM_INTERVAL_MS) || 250;
+const STREAM_MIN_INTERVAL_MS = 50;
+const STREAM_MAX_INTERVAL_MS = 10000;
+const STREAM_HEARTBEAT_MS = 15000; // keeps proxies from closing idle streams
+const STREAM_RETRY_MS = 2000;      // browser reconnect delay after a drop
+const STREAM_STALL_MS = 30000;     // undrained this long: disconnect
+
+const HEARTBEAT = Buffer.from(': ping\n\n');
+
+class StatusStream {
+  // build: returns the current status as JSON text
+  // onEmpty: called when the last client disconnects
+  constructor(build, onEmpty = null) {
+    this.build = build;
+    this.onEmpty = onEmpty;
+    this.groups = new Map();  // intervalMs -> { clients, lastSent, timer }
+    this.clients = 0;
+    this.version = 0;         // bumped by every notify()
+    this.frame = null;        // encoded event for this.version, built lazily
+    this.frameVersion = -1;
+    this.counters = { frames: 0, writes: 0, dropped: 0, stalled: 0 };
+
+    this.heartbeat = setInterval(() => this.ping(), STREAM_HEARTBEAT_MS);
+    this.heartbeat.unref();
+  }
+
+  // Express handler: holds the response open and registers the client
+  handle(req, res) {
+    const asked = Number(req.query.interval);
+    const intervalMs = Number.isFinite(asked)
+      ? Math.min(STREAM_MAX_INTERVAL_MS, Math.max(STREAM_MIN_INTERVAL_MS, asked))
+      : STREAM_INTERVAL_MS;
+    let group = this.groups.get(intervalMs);
+    if (!group) {
+      group = { intervalMs, clients: new Set(), lastSent: 0, timer: null };
+      this.groups.set(intervalMs, group);
+    }
+    const client = { res, version: -1, blockedSince: 0 };
+
+    res.writeHead(200, {
+      'Content-Type': 'text/event-stream',
+      'Cache-Control': 'no-cache',
+      'Connection': 'keep-alive',
+      'X-Accel-Buffering': 'no' // no proxy buffering (nginx)
+    });
+    res.write(`retry: ${STREAM_RETRY_MS}\n\n`);
+    group.clients.add(client);
+    this.clients++;
+    this.write(client, this.currentFrame()); // current state right away
+
+    res.on('drain', () => {
+      client.blockedSince = 0;
+      if (client.version !== this.version) this.write(client, this.currentFrame());
+    });
+    req.on('close', () => {
+      group.clients.delete(client);
+      this.clients--;
+      if (group.clients.size === 0) {
+        clearTimeout(group.timer);
+        this.groups.delete(intervalMs);
+      }
+      if (this.clients === 0 && this.onEmpty) this.onEmpty();
+    });
+  }
+
+  // New telemetry arrived: send now or when each group's interval ends
+  notify() {
+    this.version++;
+    const now = Date.now();
+    for (const group of this.groups.values()) {
+      if (group.timer) continue; // already due; it will pick up this update
+      const wait = group.lastSent + group.intervalMs - now;
+      if (wait <= 0) {
+        this.broadcast(group);
+      } else {
+        group.timer = setTimeout(() => {
+          group.timer = null;
+          this.broadcast(group);
+        }, wait);
+      }
+    }
+  }
+
+  // The event for the current version, serialized on first use
+  currentFrame() {
+    if (this.frameVersion !== this.version) {
+      this.frame = Buffer.from(`event: status\ndata: ${this.build()}\n\n`);
+      this.frameVersion = this.version;
+      this.counters.frames++;
+    }
+    return this.frame;
+  }
+
+  broadcast(group) {
+    group.lastSent = Date.now();
+    const frame = this.currentFrame();
+    for (const client of group.clients) this.write(client, frame);
+  }
+
+  // Writes unless the client's socket is still backed up
+  write(client, frame) {
+    if (client.blockedSince) {
+      this.counters.dropped++;
+      return;
+    }
+    client.version = this.frameVersion;
+    this.counters.writes++;
+    if (!client.res.write(frame)) client.blockedSince = Date.now();
+  }
+
+  // Heartbeat to idle clients; disconnects the ones stalled too long
+  ping() {
+    const now = Date.now();
+    for (const group of this.groups.values()) {
+      for (const client of group.clients) {
+        if (!client.blockedSince) {
+          if (!client.res.write(HEARTBEAT)) client.blockedSince = now;
+        } else if (now - client.blockedSince > STREAM_STALL_MS) {
+          this.counters.stalled++;
+          client.res.destroy();
+        }
+      }
+    }
+  }
+
+  // Stops the heartbeat; the stream must have no clients left
+  close() {
+    clearInterval(this.heartbeat);
+    for (const group of this.groups.values()) clearTimeout(group.timer);
+    this.groups.clear();
+  }
+
+  stats() {
+    return { clients: this.clients, groups: this.groups.size, ...this.counters };
+  }
+}
+
+module.exports = { StatusStream };
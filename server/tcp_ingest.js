@@ -0,0 +1,153 @@
+// tcp_ingest.js
+// Raw TCP telemetry listener: one persistent connection per device carrying
+// length-prefixed frames, with no HTTP parsing, routing or middleware.
+//
+// Each frame is a uint32 little-endian payload length followed by the
+// payload: a binary frame (bin_frame.js, starts with "EF") or a JSON record
+// / array of records as posted to /api/energy. JSON frames name the device
+// with a "dev" field on the (first) record; the connection remembers it, so
+// later frames can leave it out. Nothing is sent back: TCP delivers in
+// order, and records replayed after a reconnect are dropped by their seq.
+// A bad length closes the connection (framing is lost); a payload that does
+// not decode is counted and skipped.
+
+const net = require('net');
+const binFrame = require('./bin_frame');
+
+const TCP_MAX_FRAME = 64 * 1024;           // same cap as /api/energy/bin
+const TCP_IDLE_MS = 5 * 60 * 1000;         // silent this long: drop the connection
+const LEN_BYTES = 4;
+
+// Starts the listener. onRecords(records, source, deviceId, bootId) receives
+// decoded records (same shape as /api/energy) and the boot id of binary
+// frames (undefined for JSON); isDeviceId(id) vets JSON device ids.
+// Returns { server, stats() }.
+function startTcpIngest({ port, onRecords, isDeviceId = () => true }) {
+  const stats = {
+    connections: 0,   // open now
+    accepted: 0,
+    frames: 0,
+    records: 0,
+    bytes: 0,
+    badFrames: 0,
+    framingErrors: 0  // connections closed for a bad length
+  };
+
+  function handleFrame(conn, payload) {
+    let records;
+    let source;
+    let device;
+    let bootId;
+    try {
+      if (payload[0] === 0x45 && payload[1] === 0x46) { // "EF"
+        const frame = binFrame.decodeFrame(payload);
+        records = binFrame.toRecords(frame);
+        source = `tcp bin seq=${frame.seq}`;
+        device = frame.deviceId.toString(16).padStart(8, '0');
+        bootId = frame.bootId;
+      } else {
+        const body = JSON.parse(payload.toString('utf8'));
+        records = Array.isArray(body) ? body : [body];
+        source = 'tcp json';
+        const first = records[0];
+        device = first && typeof first === 'object' && first.dev !== undefined
+          ? String(first.dev)
+          : conn.device;
+      }
+    } catch {
+      stats.badFrames++;
+      return;
+    }
+    if (!isDeviceId(device)) {
+      stats.badFrames++;
+      return;
+    }
+    conn.device = device; // only a vetted id sticks to the connection
+
+    stats.frames++;
+    if (records.length === 0) return;
+    stats.records += records.length;
+    onRecords(records, source, device, bootId);
+  }
+
+  const server = net.createServer((socket) => {
+    const conn = { device: 'default' };
+    let pending = [];   // chunks of an incomplete frame
+    let pendingBytes = 0;
+    let need = 0;       // bytes that complete it (0: length not read yet)
+
+    stats.connections++;
+    stats.accepted++;
+    socket.setKeepAlive(true, 60 * 1000);
+    socket.setTimeout(TCP_IDLE_MS, () => socket.destroy());
+
+    // Bytes of the frame whose length prefix is at buf[off], or 0 after
+    // closing the connection for a bad length
+    function frameBytes(buf, off) {
+      const len = buf.readUInt32LE(off);
+      if (len === 0 || len > TCP_MAX_FRAME) {
+        stats.framingErrors++;
+        socket.destroy();
+        return 0;
+      }
+      return LEN_BYTES + len;
+    }
+
+    socket.on('data', (chunk) => {
+      stats.bytes += chunk.length;
+      // Frames are parsed straight out of the chunk. A partial frame at its
+      // end is kept as a list of chunks and joined once, when the chunk that
+      // completes it arrives, so a frame dribbling in costs O(frame size).
+      let buf = chunk;
+      if (pendingBytes > 0) {
+        pending.push(chunk);
+        pendingBytes += chunk.length;
+        if (pendingBytes < LEN_BYTES) return;
+        if (need === 0) {
+          need = frameBytes(Buffer.concat(pending, LEN_BYTES), 0);
+          if (need === 0) return;
+        }
+        if (pendingBytes < need) return;
+        buf = Buffer.concat(pending, pendingBytes);
+        pending = [];
+        pendingBytes = 0;
+      }
+      need = 0;
+      let off = 0;
+      while (buf.length - off >= LEN_BYTES) {
+        const bytes = frameBytes(buf, off);
+        if (bytes === 0) return;
+        if (buf.length - off < bytes) {
+          need = bytes;
+          break;
+        }
+        handleFrame(conn, buf.subarray(off + LEN_BYTES, off + bytes));
+        off += bytes;
+      }
+      if (off < buf.length) {
+        pending.push(buf.subarray(off));
+        pendingBytes = buf.length - off;
+      }
+    });
+
+    socket.on('error', () => {}); // resets from devices going away
+    socket.on('close', () => {
+      stats.connections--;
+    });
+  });
+
+  server.on('error', (err) => {
+    console.error(`TCP ingest error: ${err.message}`);
+  });
+
+  server.listen(port);
+
+  return {
+    server,
+    stats() {
+      return { ...stats };
+    }
+  };
+}
+
+module.exports = { startTcpIngest };
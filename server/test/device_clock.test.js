@@ -0,0 +1,53 @@
+// device_clock.test.js
+// Wall-clock mapping and energy integration across device reboots (node --test).
+
+const test = require('node:test');
+const assert = require('node:assert');
+const { DeviceClock } = require('../device_clock');
+const { EnergyStore } = require('../energy');
+
+const T0 = Date.UTC(2026, 0, 15, 12); // midday: no day rollover in the test
+
+// Feeds records every 1 s of device time, arriving as they are taken
+function run(clock, energy, bootId, fromTick, toTick, wall0, mW) {
+  let last;
+  for (let t = fromTick; t <= toTick; t += 1000) {
+    last = clock.map(t, wall0 + (t - fromTick), bootId);
+    energy.add('d', last, { pA: mW, pB: 0 });
+  }
+  return last;
+}
+
+test('reboot at 20 s uptime is detected from the boot id', () => {
+  const clock = new DeviceClock();
+  const energy = new EnergyStore();
+
+  run(clock, energy, 7, 0, 20000, T0, 3600);
+  const before = energy.today('d', T0).A;
+
+  // Back up 5 s later at tick 0: within RESET_SLACK_MS of the last tick
+  const first = clock.map(0, T0 + 25000, 8);
+  assert.strictEqual(first.reset, true);
+  assert.strictEqual(first.wall, T0 + 25000);
+  energy.add('d', first, { pA: 3600, pB: 0 });
+
+  const last = run(clock, energy, 8, 1000, 10000, T0 + 26000, 3600);
+  assert.strictEqual(last.wall, T0 + 35000);
+  assert.strictEqual(clock.resets, 1);
+  // 10 s at 3.6 W more, nothing bridged across the reboot gap
+  assert.ok(Math.abs(energy.today('d', T0).A - before - 1e-5) < 1e-12);
+});
+
+test('same boot id: a late record is not a reboot', () => {
+  const clock = new DeviceClock();
+  clock.map(100000, T0, 7);
+  const late = clock.map(0, T0 + 1000, 7);
+  assert.strictEqual(late.reset, false);
+  assert.ok(Math.abs(late.wall - (T0 - 100000)) < 1); // plus drift creep
+});
+
+test('without a boot id the tick step back is the fallback', () => {
+  const clock = new DeviceClock();
+  clock.map(200000, T0);
+  assert.strictEqual(clock.map(0, T0 + 1000).reset, true);
+});
@@ -0,0 +1,68 @@
+// ingest_boot.test.js
+// JSON record seq deduplication across device reboots (node --test).
+// Runs server.js on free ports with history and energy kept in memory.
+
+const test = require('node:test');
+const assert = require('node:assert');
+const net = require('net');
+const path = require('path');
+const { spawn } = require('child_process');
+
+function freePort() {
+  return new Promise((resolve) => {
+    const srv = net.createServer().listen(0, () => {
+      const { port } = srv.address();
+      srv.close(() => resolve(port));
+    });
+  });
+}
+
+async function startServer() {
+  const [port, udp, tcp] = [await freePort(), await freePort(), await freePort()];
+  const child = spawn(process.execPath, [path.join(__dirname, '..', 'server.js')], {
+    env: { ...process.env, PORT: port, UDP_PORT: udp, TCP_PORT: tcp, HISTORY_DIR: '', ENERGY_FILE: '' },
+    stdio: ['ignore', 'pipe', 'inherit']
+  });
+  await new Promise((resolve, reject) => {
+    let out = '';
+    child.stdout.on('data', (d) => {
+      out += d;
+      if (out.includes('Waiting for STM32 data')) resolve();
+    });
+    child.once('exit', (code) => reject(new Error(`server.js exited with ${code}`)));
+  });
+  return { base: `http://127.0.0.1:${port}`, child };
+}
+
+// One batch as the firmware sends it: seq on the first record only
+function batch(n, t0) {
+  return Array.from({ length: n }, (_, i) => ({
+    t: t0 + i * 10, pA: 100, pB: 200, fan: false, ...(i === 0 ? { seq: 0 } : {})
+  }));
+}
+
+async function post(base, bootId, records) {
+  const res = await fetch(`${base}/api/energy`, {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json', 'X-Device-Id': 'a1b2c3d4', 'X-Boot-Id': String(bootId) },
+    body: JSON.stringify(records)
+  });
+  assert.strictEqual(res.status, 200);
+  return res.json();
+}
+
+test('seq restarting at 0 under a new boot id is kept', async (t) => {
+  const { base, child } = await startServer();
+  t.after(() => child.kill());
+
+  assert.strictEqual((await post(base, 7, batch(5, 1000))).duplicates, 0);
+  // Same boot: a resend is still a duplicate
+  assert.strictEqual((await post(base, 7, batch(5, 1000))).duplicates, 5);
+  // Rebooted without the spool: numbering starts over
+  assert.strictEqual((await post(base, 8, batch(5, 20))).duplicates, 0);
+
+  const { devices } = await (await fetch(`${base}/devices`)).json();
+  const dev = devices.find((d) => d.id === 'a1b2c3d4');
+  assert.strictEqual(dev.records, 10);
+  assert.strictEqual(dev.restarts, 1);
+});
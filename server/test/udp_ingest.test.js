@@ -0,0 +1,77 @@
+// udp_ingest.test.js
+// Frame sequence tracking across device reboots (node --test).
+
+const test = require('node:test');
+const assert = require('node:assert');
+const dgram = require('dgram');
+const { crc16 } = require('../bin_frame');
+const { startUdpIngest, trackSequence, newDeviceStats } = require('../udp_ingest');
+
+// Version 1 frame with one sample (pA, pB, fan) at base timestamp t
+function frame(deviceId, bootId, seq, t, [pA, pB, fan]) {
+  const zz = (v) => (v << 1) ^ (v >> 31);
+  const samples = [0, zz(pA), zz(pB), zz(fan)]; // each < 128: one varint byte
+  const buf = Buffer.alloc(20 + samples.length + 2);
+  buf.write('EF', 0, 'latin1');
+  buf[2] = 1;
+  buf[3] = 3;
+  buf.writeUInt32LE(deviceId, 4);
+  buf.writeUInt32LE(seq, 8);
+  buf.writeUInt32LE(t, 12);
+  buf.writeUInt16LE(1, 16);
+  buf.writeUInt16LE(bootId, 18);
+  Buffer.from(samples).copy(buf, 20);
+  buf.writeUInt16LE(crc16(buf, buf.length - 2), buf.length - 2);
+  return buf;
+}
+
+test('loss, reordering and duplicates within one boot', () => {
+  const stats = newDeviceStats();
+  for (const seq of [0, 1, 3, 4]) assert.ok(trackSequence(stats, seq, 7));
+  assert.strictEqual(stats.lost, 1);
+  assert.ok(trackSequence(stats, 2, 7));
+  assert.strictEqual(stats.lost, 0);
+  assert.strictEqual(stats.reordered, 1);
+  assert.strictEqual(trackSequence(stats, 3, 7), false);
+  assert.strictEqual(stats.duplicates, 1);
+});
+
+test('a device rebooted early starts a new window', () => {
+  const stats = newDeviceStats();
+  for (let seq = 0; seq < 20; seq++) trackSequence(stats, seq, 7);
+
+  // Rebooted a few frames in: the new numbers are far inside the old window
+  for (let seq = 0; seq < 5; seq++) {
+    assert.ok(trackSequence(stats, seq, 8), `seq ${seq} after reboot`);
+  }
+  assert.strictEqual(stats.restarts, 1);
+  assert.strictEqual(stats.duplicates, 0);
+  assert.strictEqual(stats.lost, 0);
+  assert.strictEqual(stats.highestSeq, 4);
+
+  // Duplicates are still caught within the new boot
+  assert.strictEqual(trackSequence(stats, 3, 8), false);
+});
+
+test('frames after a reboot are ingested over UDP', async () => {
+  const got = [];
+  const ingest = startUdpIngest({ port: 0, onRecords: (records) => got.push(...records) });
+  await new Promise((resolve) => ingest.socket.once('listening', resolve));
+  const { port } = ingest.socket.address();
+  const client = dgram.createSocket('udp4');
+  const send = (buf) => new Promise((resolve) => client.send(buf, port, '127.0.0.1', resolve));
+
+  for (let seq = 0; seq < 3; seq++) await send(frame(0xabc, 1, seq, 1000 + seq * 400, [10, 20, 1]));
+  for (let seq = 0; seq < 3; seq++) await send(frame(0xabc, 2, seq, 50 + seq * 400, [30, 40, 0]));
+  await new Promise((resolve) => setTimeout(resolve, 100));
+
+  const stats = ingest.stats()['00000abc'];
+  client.close();
+  ingest.socket.close();
+
+  assert.strictEqual(got.length, 6);
+  assert.deepStrictEqual(got[3], { t: 50, pA: 30, pB: 40, fan: 0 });
+  assert.strictEqual(stats.restarts, 1);
+  assert.strictEqual(stats.duplicates, 0);
+  assert.strictEqual(stats.bootId, 2);
+});
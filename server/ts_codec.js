@@ -0,0 +1,63 @@
+// ts_codec.js
+// Decoder for the Gorilla-style sample bit stream (Core/Inc/ts_codec.h)
+//
+// MSB-first bits. Per sample: zigzag delta-of-delta of the timestamp, then
+// a zigzag delta per channel, each with the prefix-bucket code
+//   '0' = 0 | '10'+7 | '110'+9 | '1110'+12 | '1111'+32 bits
+
+const BUCKETS = [7, 9, 12, 32];
+
+class BitReader {
+  constructor(buf, start, end) {
+    this.buf = buf;
+    this.bit = start * 8;
+    this.end = end * 8;
+  }
+
+  read(n) {
+    if (this.bit + n > this.end) throw new Error('Truncated sample stream');
+    let v = 0;
+    for (let i = 0; i < n; i++) {
+      const byte = this.buf[this.bit >> 3];
+      v = v * 2 + ((byte >> (7 - (this.bit & 7))) & 1);
+      this.bit++;
+    }
+    return v;
+  }
+
+  // One prefix-bucket zigzag number, returned as a signed int32
+  readSigned() {
+    let prefix = 0;
+    while (prefix < BUCKETS.length && this.read(1) === 1) prefix++;
+    if (prefix === 0) return 0;
+    const zz = this.read(BUCKETS[prefix - 1]);
+    return (zz % 2 === 0 ? zz / 2 : -(zz + 1) / 2) | 0;
+  }
+}
+
+// Decodes count samples of channels values from buf[start, end).
+// Returns [{ t, values }]; throws on truncation or trailing data.
+function decodeSamples(buf, start, end, baseT, channels, count) {
+  const r = new BitReader(buf, start, end);
+  const prev = new Array(channels).fill(0);
+  const samples = new Array(count);
+  let t = baseT;
+  let dt = 0;
+
+  for (let i = 0; i < count; i++) {
+    dt = (dt + r.readSigned()) | 0;
+    t = (t + dt) >>> 0; // device tick wraps at 2^32
+    const values = new Array(channels);
+    for (let c = 0; c < channels; c++) {
+      prev[c] = (prev[c] + r.readSigned()) | 0;
+      values[c] = prev[c];
+    }
+    samples[i] = { t, values };
+  }
+
+  // Only zero padding up to the next byte may follow
+  if (Math.ceil(r.bit / 8) * 8 !== r.end) throw new Error('Trailing bytes in frame');
+  return samples;
+}
+
+module.exports = { decodeSamples };
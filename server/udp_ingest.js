@@ -0,0 +1,142 @@
+// udp_ingest.js
+// UDP telemetry listener: one binary frame (bin_frame.js) per datagram.
+// Tracks per-device loss, reordering and duplicates from frame sequence
+// numbers. Nothing is retransmitted; late datagrams are still ingested.
+// A device starts its sequence over at 0 when it reboots; the frame's boot
+// id changes at the same time, so the window restarts instead of the new
+// frames being taken for duplicates.
+
+const dgram = require('dgram');
+const binFrame = require('./bin_frame');
+
+// Sequences further than this behind the highest seen are treated as a
+// restart (same boot id: the counter wrapped) rather than a very late datagram
+const SEQ_WINDOW = 1024;
+
+function newDeviceStats() {
+  return {
+    received: 0,
+    lost: 0,          // gaps not (yet) filled by late datagrams
+    reordered: 0,     // arrived after a higher sequence number
+    duplicates: 0,
+    restarts: 0,
+    badFrames: 0,
+    highestSeq: -1,
+    bootId: null,
+    lastSeenAt: null,
+    missing: new Set() // sequence numbers inside the window not yet seen
+  };
+}
+
+// Updates stats for one frame's boot id and sequence number; returns false
+// for duplicates
+function trackSequence(stats, seq, bootId) {
+  if (stats.highestSeq < 0) {
+    stats.highestSeq = seq;
+    stats.bootId = bootId;
+    return true;
+  }
+
+  if (bootId !== stats.bootId) {
+    // Device rebooted: its counter began again, whatever the numbers
+    stats.restarts++;
+    stats.missing.clear();
+    stats.highestSeq = seq;
+    stats.bootId = bootId;
+    return true;
+  }
+
+  if (seq > stats.highestSeq) {
+    const gap = seq - stats.highestSeq - 1;
+    if (gap >= SEQ_WINDOW) {
+      // Jumped far ahead: count it as loss without tracking every number
+      stats.lost += gap;
+      stats.missing.clear();
+    } else {
+      for (let s = stats.highestSeq + 1; s < seq; s++) stats.missing.add(s);
+      stats.lost += gap;
+    }
+    stats.highestSeq = seq;
+  } else if (stats.highestSeq - seq >= SEQ_WINDOW) {
+    // Counter began again without a new boot id
+    stats.restarts++;
+    stats.missing.clear();
+    stats.highestSeq = seq;
+  } else if (stats.missing.delete(seq)) {
+    stats.lost--;
+    stats.reordered++;
+  } else {
+    stats.duplicates++;
+    return false;
+  }
+
+  // Forget numbers that fell out of the window; they stay counted as lost
+  for (const s of stats.missing) {
+    if (stats.highestSeq - s < SEQ_WINDOW) break;
+    stats.missing.delete(s);
+  }
+  return true;
+}
+
+// Starts the listener. onRecords(records, source, deviceId, bootId) receives
+// decoded records (same shape as /api/energy), the frame's device id as 8 hex
+// digits and its boot id. Returns { socket, stats() }.
+function startUdpIngest({ port, onRecords }) {
+  const devices = new Map();
+  const socket = dgram.createSocket('udp4');
+
+  socket.on('message', (msg, rinfo) => {
+    let frame;
+    try {
+      frame = binFrame.decodeFrame(msg);
+    } catch (err) {
+      const key = `ip:${rinfo.address}`;
+      if (!devices.has(key)) devices.set(key, newDeviceStats());
+      devices.get(key).badFrames++;
+      return;
+    }
+
+    const id = frame.deviceId.toString(16).padStart(8, '0');
+    if (!devices.has(id)) devices.set(id, newDeviceStats());
+    const stats = devices.get(id);
+
+    stats.received++;
+    stats.lastSeenAt = new Date().toISOString();
+    if (!trackSequence(stats, frame.seq, frame.bootId)) return;
+
+    if (frame.samples.length > 0) {
+      onRecords(binFrame.toRecords(frame), `udp seq=${frame.seq}`, id, frame.bootId);
+    }
+  });
+
+  socket.on('error', (err) => {
+    console.error(`UDP ingest error: ${err.message}`);
+  });
+
+  socket.bind(port);
+
+  return {
+    socket,
+    stats() {
+      const out = {};
+      for (const [id, s] of devices) {
+        const expected = s.received - s.duplicates + s.lost;
+        out[id] = {
+          received: s.received,
+          lost: s.lost,
+          reordered: s.reordered,
+          duplicates: s.duplicates,
+          restarts: s.restarts,
+          badFrames: s.badFrames,
+          highestSeq: s.highestSeq,
+          bootId: s.bootId,
+          lossRate: expected > 0 ? s.lost / expected : 0,
+          lastSeenAt: s.lastSeenAt
+        };
+      }
+      return out;
+    }
+  };
+}
+
+module.exports = { startUdpIngest, trackSequence, newDeviceStats };
@@ -0,0 +1,178 @@
+#!/usr/bin/env node
+// dlog_decode.js
+// Host-side decoder for deferred binary logs (Core/Inc/dlog.h)
+//
+// The firmware emits  0xDB | id u16 | nargs u8 | args u32[] | xor  records
+// interleaved with ordinary printf text on the debug UART. The id is the
+// offset of the format string in the .dlog_fmt section of the ELF, so the
+// table comes straight out of the build output.
+//
+// Usage:
+//   node tools/dlog_decode.js table  <firmware.elf>              > dlog.json
+//   node tools/dlog_decode.js decode <firmware.elf|dlog.json> [capture]
+//
+// capture is a file or a serial device configured beforehand, e.g.
+//   stty -F /dev/ttyACM0 115200 raw && node tools/dlog_decode.js decode build/demo.elf /dev/ttyACM0
+// Without it, the capture is read from stdin.
+
+const fs = require('fs');
+
+const SYNC = 0xdb;
+const MAX_ARGS = 8;
+const SECTION = '.dlog_fmt';
+
+// ===== Format table =====
+
+// Reads the .dlog_fmt section of a little-endian ELF32/ELF64 file and
+// returns { id: formatString }
+function readElfTable(buf) {
+  if (buf.readUInt32BE(0) !== 0x7f454c46) throw new Error('Not an ELF file');
+  if (buf[5] !== 1) throw new Error('Only little-endian ELF is supported');
+  const is64 = buf[4] === 2;
+
+  const shoff = is64 ? Number(buf.readBigUInt64LE(0x28)) : buf.readUInt32LE(0x20);
+  const shentsize = buf.readUInt16LE(is64 ? 0x3a : 0x2e);
+  const shnum = buf.readUInt16LE(is64 ? 0x3c : 0x30);
+  const shstrndx = buf.readUInt16LE(is64 ? 0x3e : 0x32);
+
+  const section = (i) => {
+    const h = shoff + i * shentsize;
+    return is64
+      ? { name: buf.readUInt32LE(h), addr: Number(buf.readBigUInt64LE(h + 0x10)),
+          offset: Number(buf.readBigUInt64LE(h + 0x18)), size: Number(buf.readBigUInt64LE(h + 0x20)) }
+      : { name: buf.readUInt32LE(h), addr: buf.readUInt32LE(h + 0x0c),
+          offset: buf.readUInt32LE(h + 0x10), size: buf.readUInt32LE(h + 0x14) };
+  };
+  const cstring = (off) => buf.toString('latin1', off, buf.indexOf(0, off));
+
+  const strtab = section(shstrndx);
+  for (let i = 0; i < shnum; i++) {
+    const sh = section(i);
+    if (cstring(strtab.offset + sh.name) !== SECTION) continue;
+
+    // Every DLOG site contributes one NUL-terminated string
+    const table = {};
+    let off = 0;
+    while (off < sh.size) {
+      const end = buf.indexOf(0, sh.offset + off);
+      if (end < 0 || end >= sh.offset + sh.size) break;
+      if (end > sh.offset + off) {
+        table[(sh.addr + off) & 0xffff] = buf.toString('latin1', sh.offset + off, end);
+      }
+      off = end - sh.offset + 1;
+    }
+    return table;
+  }
+  throw new Error(`No ${SECTION} section (built with DLOG_DEFERRED=0?)`);
+}
+
+function loadTable(path) {
+  const buf = fs.readFileSync(path);
+  return buf.readUInt32BE(0) === 0x7f454c46 ? readElfTable(buf) : JSON.parse(buf.toString('utf8'));
+}
+
+// ===== printf subset =====
+
+const SPEC = /%([-0+ #]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|t)?([diouxXcps%])/g;
+
+function pad(str, flags, width) {
+  if (!width || str.length >= width) return str;
+  if (flags.includes('-')) return str.padEnd(width);
+  if (flags.includes('0')) {
+    const sign = str[0] === '-' ? '-' : '';
+    return sign + str.slice(sign.length).padStart(width - sign.length, '0');
+  }
+  return str.padStart(width);
+}
+
+function format(fmt, args) {
+  let next = 0;
+  return fmt.replace(SPEC, (m, flags, width, prec, len, conv) => {
+    if (conv === '%') return '%';
+    const raw = next < args.length ? args[next++] : 0;
+    let out;
+    switch (conv) {
+      case 'd':
+      case 'i':
+        out = String(len === 'hh' ? (raw << 24) >> 24 : len === 'h' ? (raw << 16) >> 16 : raw | 0);
+        break;
+      case 'u': out = String(raw >>> 0); break;
+      case 'o': out = (raw >>> 0).toString(8); break;
+      case 'x': out = (raw >>> 0).toString(16); break;
+      case 'X': out = (raw >>> 0).toString(16).toUpperCase(); break;
+      case 'p': out = '0x' + (raw >>> 0).toString(16); break;
+      case 'c': out = String.fromCharCode(raw & 0xff); break;
+      default:  out = `<%${conv}>`; // strings never leave the MCU
+    }
+    if (prec && 'diouxX'.includes(conv)) out = out.padStart(Number(prec), '0');
+    return pad(out, flags, Number(width));
+  });
+}
+
+// ===== Stream decoder =====
+
+// Returns a function that takes chunks of the raw UART capture and writes
+// text to out. Records may span chunks; a bad checksum or unknown id
+// resynchronizes on the next byte.
+function createDecoder(table, out) {
+  let pending = Buffer.alloc(0);
+
+  return function feed(chunk) {
+    let buf = pending.length ? Buffer.concat([pending, chunk]) : chunk;
+    let text = 0; // start of plain text not yet written
+    let i = 0;
+
+    while (i < buf.length) {
+      if (buf[i] !== SYNC) { i++; continue; }
+
+      if (i + 4 > buf.length) break;
+      const nargs = buf[i + 3];
+      const len = 4 + 4 * nargs + 1;
+      if (nargs > MAX_ARGS) { i++; continue; }
+      if (i + len > buf.length) break;
+
+      let sum = 0;
+      for (let k = i + 1; k < i + len - 1; k++) sum ^= buf[k];
+      const id = buf.readUInt16LE(i + 1);
+      if (sum !== buf[i + len - 1] || !(id in table)) { i++; continue; }
+
+      if (i > text) out.write(buf.toString('latin1', text, i));
+      const args = [];
+      for (let a = 0; a < nargs; a++) args.push(buf.readUInt32LE(i + 4 + 4 * a));
+      out.write(format(table[id], args));
+      i += len;
+      text = i;
+    }
+
+    // Flush text; keep a possibly incomplete record for the next chunk
+    const keep = i < buf.length ? i : buf.length;
+    if (keep > text) out.write(buf.toString('latin1', text, keep));
+    pending = Buffer.from(buf.subarray(keep));
+  };
+}
+
+// ===== CLI =====
+
+function main(argv) {
+  const [cmd, tablePath, capture] = argv;
+
+  if (cmd === 'table' && tablePath) {
+    process.stdout.write(JSON.stringify(readElfTable(fs.readFileSync(tablePath)), null, 2) + '\n');
+    return;
+  }
+  if (cmd === 'decode' && tablePath) {
+    const feed = createDecoder(loadTable(tablePath), process.stdout);
+    const input = capture ? fs.createReadStream(capture) : process.stdin;
+    input.on('data', feed);
+    return;
+  }
+
+  console.error('Usage: dlog_decode.js table <elf> | decode <elf|table.json> [capture]');
+  process.exit(1);
+}
+
+if (require.main === module) {
+  main(process.argv.slice(2));
+}
+
+module.exports = { readElfTable, format, createDecoder };
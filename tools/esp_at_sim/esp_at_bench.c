@@ -0,0 +1,444 @@
+/**
+  ******************************************************************************
+  * @file    esp_at_bench.c
+  * @brief   Throughput / latency benchmark for Core/Src/esp_at.c on the host
+  ******************************************************************************
+  *
+  * Runs the firmware AT layer unchanged against esp_at_sim.py through the
+  * host HAL in host/. esp_at_poll() runs once per 1 ms tick, as in TaskNet,
+  * and the UART wire time is modelled at the link rate (-b, then whatever
+  * the bring-up negotiates), so the numbers are what the STM32 would see
+  * against a modem with the simulator's latency.
+  *
+  * Phases:
+  *   0. with -R, esp_at_reset() (AT+RST until "ready", rate renegotiated)
+  *   1. -a "AT" round trips
+  *   2. esp_at_init_wifi_async() (AT+CWSTATE?, then a stored-AP rejoin or
+  *      CWMODE / CWAUTOCONN / CWJAP) and AT+CIPSTART
+  *   3. -n HTTP POSTs of -r JSON records each, back to back; a failed post
+  *      is followed by AT+CIPCLOSE + AT+CIPSTART before the next one, a
+  *      non-2xx answer by the server's retry delay (or BENCH_BACKOFF_MS);
+  *      with -s through esp_at_send_http_post_stream_async()
+  *
+  * The report ends with the esp_at_get_boot_times() stages: how long the
+  * module took from reset (or esp_at_init_async()) to the first delivered post.
+  *
+  * Latency is enqueue to completion callback; posts cover the whole
+  * AT+CIPSEND / "> " / payload / SEND OK exchange and the HTTP response.
+  */
+
+#include "esp_at.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define BENCH_JOIN_ATTEMPTS 5
+#define BENCH_BACKOFF_MS    500   // After a non-2xx answer without a retry delay
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    OP_RESET = 0,
+    OP_AT,
+    OP_JOIN,
+    OP_CIPSTART,
+    OP_POST,
+    OP_CIPCLOSE,
+    OP_COUNT
+} bench_op_t;
+
+typedef struct {
+    uint32_t *us;           // Latency samples
+    uint32_t  n;
+    uint32_t  cap;
+    uint32_t  errors;
+    uint32_t  timeouts;
+    uint64_t  t0;           // Enqueue time of the one in flight
+} bench_stat_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const char *op_names[OP_COUNT] = {
+    "AT+RST", "AT", "JOIN", "AT+CIPSTART", "POST", "AT+CIPCLOSE"
+};
+
+static UART_HandleTypeDef huart;
+static bench_stat_t stats[OP_COUNT];
+static esp_at_status_t last_status;
+static uint32_t bytes_posted;
+static uint32_t paused_ms;        // Waited on server retry delays
+
+static uint32_t init_us;
+
+static struct {
+    const char *device;
+    uint32_t    baud;
+    uint32_t    posts;
+    uint32_t    records;
+    uint32_t    pings;
+    const char *host;
+    uint16_t    port;
+    const char *endpoint;
+    int         json;
+    int         reset;
+    int         stream;
+} cfg = { "/tmp/esp", 115200, 200, 40, 20, "127.0.0.1", 3000, "/api/energy", 0, 0, 0 };
+
+/* -s: body handed out in chunks as esp_at pulls it */
+static char     stream_body[ESP_AT_HTTP_BODY_MAX + 1];
+static uint16_t stream_pos;
+
+/* Private functions ---------------------------------------------------------*/
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *h)
+{
+    esp_at_uart_rx_callback(h);
+}
+
+/**
+  * @brief  Completion callback shared by every measured command
+  */
+static void bench_done(esp_at_status_t status, const char *response, void *ctx)
+{
+    bench_stat_t *s = (bench_stat_t *)ctx;
+    (void)response;
+
+    last_status = status;
+    if (status == ESP_AT_OK) {
+        if (s->n == s->cap) {
+            s->cap = s->cap ? s->cap * 2 : 64;
+            s->us = realloc(s->us, s->cap * sizeof(*s->us));
+        }
+        s->us[s->n++] = (uint32_t)(hal_host_micros() - s->t0);
+    } else if (status == ESP_AT_TIMEOUT) {
+        s->timeouts++;
+    } else {
+        s->errors++;
+    }
+}
+
+static void *bench_start(bench_op_t op)
+{
+    stats[op].t0 = hal_host_micros();
+    return &stats[op];
+}
+
+/**
+  * @brief  Service the UART and run esp_at_poll() on each new 1 ms tick
+  *         until the engine is idle
+  */
+static void bench_run(void)
+{
+    static uint32_t last_tick;
+
+    while (esp_at_is_busy()) {
+        hal_host_service(&huart, 200U);
+        uint32_t tick = HAL_GetTick();
+        if (tick != last_tick) {
+            last_tick = tick;
+            esp_at_poll();
+        }
+    }
+}
+
+static esp_at_status_t bench_cmd(bench_op_t op, const char *cmd, uint32_t timeout_ms)
+{
+    last_status = ESP_AT_BUSY;
+    if (esp_at_enqueue_cmd(cmd, NULL, timeout_ms, bench_done, bench_start(op)) != ESP_AT_OK) {
+        return ESP_AT_ERROR;
+    }
+    bench_run();
+    return last_status;
+}
+
+static esp_at_status_t bench_join(void)
+{
+    last_status = ESP_AT_BUSY;
+    if (esp_at_init_wifi_async("bench", "bench", bench_done,
+                               bench_start(OP_JOIN)) != ESP_AT_OK) {
+        return ESP_AT_ERROR;
+    }
+    bench_run();
+    return last_status;
+}
+
+static esp_at_status_t bench_connect(void)
+{
+    last_status = ESP_AT_BUSY;
+    if (esp_at_connect_tcp_async(cfg.host, cfg.port, bench_done,
+                                 bench_start(OP_CIPSTART)) != ESP_AT_OK) {
+        return ESP_AT_ERROR;
+    }
+    bench_run();
+    return last_status;
+}
+
+/**
+  * @brief  Wait out a server retry delay with the UART still serviced
+  */
+static void bench_pause(uint32_t ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (HAL_GetTick() - start < ms) {
+        hal_host_service(&huart, 1000U);
+        esp_at_poll();
+    }
+    paused_ms += ms;
+}
+
+/**
+  * @brief  JSON batch shaped like telemetry_build_json_batch(): "seq" on the
+  *         first record only, the rest are consecutive
+  */
+static int bench_body(char *buf, size_t size, uint32_t seq, uint32_t records)
+{
+    size_t len = 0;
+
+    buf[len++] = '[';
+    for (uint32_t i = 0; i < records; i++) {
+        uint32_t s = seq + i;
+        int n = (i == 0) ? snprintf(&buf[len], size - len, "{\"seq\":%u,", s)
+                         : snprintf(&buf[len], size - len, ",{");
+        if (n < 0 || (size_t)n >= size - len - 1) {
+            return -1;
+        }
+        len += (size_t)n;
+        n = snprintf(&buf[len], size - len, "\"t\":%u,\"pA\":%u,\"pB\":%u,\"fan\":%s}",
+                     s * 10U, 400U + (s * 37U) % 400U, 300U + (s * 53U) % 500U,
+                     (s & 8U) ? "true" : "false");
+        if (n < 0 || (size_t)n >= size - len - 1) {
+            return -1;
+        }
+        len += (size_t)n;
+    }
+    buf[len++] = ']';
+    buf[len] = '\0';
+    return (int)len;
+}
+
+/* esp_at_body_fn_t over stream_body */
+static int bench_pull(uint8_t *buf, uint16_t size, void *ctx)
+{
+    (void)ctx;
+    memcpy(buf, &stream_body[stream_pos], size);
+    stream_pos += size;
+    return size;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Boot stage relative to its start in ms, -1 if not reached */
+static long boot_ms(uint32_t tick)
+{
+    const esp_at_boot_times_t *bt = esp_at_get_boot_times();
+    return tick ? (long)(tick - bt->start) : -1L;
+}
+
+static void bench_report(double elapsed_s, uint32_t posted)
+{
+    double rate = elapsed_s > 0 ? posted / elapsed_s : 0;
+    bool flow = (huart.Init.HwFlowCtl != UART_HWCONTROL_NONE);
+    const esp_at_boot_times_t *bt = esp_at_get_boot_times();
+    const esp_at_http_stats_t *hs = esp_at_get_http_stats();
+
+    if (cfg.json) {
+        printf("{\"baud\":%u,\"flow_ctrl\":%s,\"init_ms\":%.1f,\"records\":%u,\"posts\":%u,"
+               "\"elapsed_s\":%.3f,\"msgs_per_s\":%.2f,\"records_per_s\":%.1f,"
+               "\"bytes_per_s\":%.0f,\"commands\":{",
+               esp_at_get_baud(), flow ? "true" : "false", init_us / 1000.0, cfg.records,
+               posted, elapsed_s, rate, rate * cfg.records,
+               elapsed_s > 0 ? bytes_posted / elapsed_s : 0);
+    } else {
+        printf("link %u baud%s (bring-up %.1f ms)\n", esp_at_get_baud(),
+               flow ? " RTS/CTS" : "", init_us / 1000.0);
+        printf("posts %u in %.2f s: %.2f msg/s, %.0f records/s, %.0f B/s\n\n",
+               posted, elapsed_s, rate, rate * cfg.records,
+               elapsed_s > 0 ? bytes_posted / elapsed_s : 0);
+        printf("%-12s %6s %6s %6s %8s %8s %8s %8s %8s\n", "command", "ok", "err", "tmo",
+               "min ms", "p50 ms", "p95 ms", "max ms", "mean ms");
+    }
+
+    for (int op = 0, first = 1; op < OP_COUNT; op++) {
+        bench_stat_t *s = &stats[op];
+        double mean = 0;
+
+        if (s->n + s->errors + s->timeouts == 0) {
+            continue;
+        }
+        qsort(s->us, s->n, sizeof(*s->us), cmp_u32);
+        for (uint32_t i = 0; i < s->n; i++) {
+            mean += s->us[i];
+        }
+        mean = s->n ? mean / s->n / 1000.0 : 0;
+
+        double mn  = s->n ? s->us[0] / 1000.0 : 0;
+        double p50 = s->n ? s->us[s->n / 2] / 1000.0 : 0;
+        double p95 = s->n ? s->us[(s->n * 95U) / 100U] / 1000.0 : 0;
+        double mx  = s->n ? s->us[s->n - 1] / 1000.0 : 0;
+
+        if (cfg.json) {
+            printf("%s\"%s\":{\"ok\":%u,\"errors\":%u,\"timeouts\":%u,\"min_ms\":%.3f,"
+                   "\"p50_ms\":%.3f,\"p95_ms\":%.3f,\"max_ms\":%.3f,\"mean_ms\":%.3f}",
+                   first ? "" : ",", op_names[op], s->n, s->errors, s->timeouts,
+                   mn, p50, p95, mx, mean);
+        } else {
+            printf("%-12s %6u %6u %6u %8.2f %8.2f %8.2f %8.2f %8.2f\n", op_names[op],
+                   s->n, s->errors, s->timeouts, mn, p50, p95, mx, mean);
+        }
+        first = 0;
+    }
+    if (cfg.json) {
+        printf("},\"boot_ms\":{\"ready\":%ld,\"got_ip\":%ld,\"link_up\":%ld,"
+               "\"first_send\":%ld},\"http\":{\"responses\":%u,\"2xx\":%u,\"4xx\":%u,"
+               "\"5xx\":%u,\"throttled\":%u,\"timeouts\":%u,\"last_status\":%u,"
+               "\"last_rtt_ms\":%u,\"paused_ms\":%u}}\n",
+               boot_ms(bt->ready), boot_ms(bt->got_ip), boot_ms(bt->link_up),
+               boot_ms(bt->first_send), hs->responses, hs->status_2xx, hs->status_4xx,
+               hs->status_5xx, hs->throttled, hs->timeouts, hs->last_status,
+               hs->last_rtt_ms, paused_ms);
+    } else {
+        printf("\nhttp: %u responses (%u 2xx, %u 4xx, %u 5xx), %u throttled, %u timeouts, "
+               "last %u in %u ms, %u ms paused on retry delays\n",
+               hs->responses, hs->status_2xx, hs->status_4xx, hs->status_5xx, hs->throttled,
+               hs->timeouts, hs->last_status, hs->last_rtt_ms, paused_ms);
+        printf("\nboot (%s): ready +%ld ms, ip +%ld ms, link +%ld ms, first post +%ld ms\n",
+               cfg.reset ? "AT+RST" : "bring-up", boot_ms(bt->ready), boot_ms(bt->got_ip),
+               boot_ms(bt->link_up), boot_ms(bt->first_send));
+    }
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "usage: %s [-d tty] [-b baud] [-n posts] [-r records] [-a pings]\n"
+        "          [-H host] [-p port] [-e endpoint] [-R] [-s] [-j]\n"
+        "  -d  simulator pty (default /tmp/esp)\n"
+        "  -b  UART rate before the bring-up negotiates ESP_AT_LINK_BAUD (default 115200)\n"
+        "  -n  HTTP posts to send (default 200)\n"
+        "  -r  JSON records per post (default 40)\n"
+        "  -a  AT round trips measured first (default 20)\n"
+        "  -H  -p  CIPSTART address (default 127.0.0.1 3000)\n"
+        "  -e  endpoint (default /api/energy)\n"
+        "  -R  reset the module (AT+RST) first and time its boot\n"
+        "  -s  streamed posts: the body is pulled a chunk at a time while sending\n"
+        "  -j  one JSON object on stdout instead of the table\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:b:n:r:a:H:p:e:Rsjh")) != -1) {
+        switch (opt) {
+        case 'd': cfg.device = optarg; break;
+        case 'b': cfg.baud = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'n': cfg.posts = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'r': cfg.records = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'a': cfg.pings = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'H': cfg.host = optarg; break;
+        case 'p': cfg.port = (uint16_t)strtoul(optarg, NULL, 0); break;
+        case 'e': cfg.endpoint = optarg; break;
+        case 'R': cfg.reset = 1; break;
+        case 's': cfg.stream = 1; break;
+        case 'j': cfg.json = 1; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (cfg.baud == 0 || cfg.records == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (hal_host_uart_open(&huart, cfg.device, cfg.baud) != 0) {
+        perror(cfg.device);
+        return 1;
+    }
+    uint64_t t_init = hal_host_micros();
+    if (esp_at_init_async(&huart) != ESP_AT_OK) {
+        fprintf(stderr, "esp_at_init_async failed\n");
+        return 1;
+    }
+    bench_run(); // Probe and rate negotiation, polled as TaskNet does
+    init_us = (uint32_t)(hal_host_micros() - t_init);
+
+    // 0. Reboot: waits for "ready", not a fixed delay
+    if (cfg.reset) {
+        bench_stat_t *s = bench_start(OP_RESET);
+        bench_done(esp_at_reset(), NULL, s);
+    }
+
+    // 1. Bare round trips
+    for (uint32_t i = 0; i < cfg.pings; i++) {
+        bench_cmd(OP_AT, "AT", ESP_AT_RESPONSE_TIMEOUT_MS);
+    }
+
+    // 2. Join (retried, injected faults hit it too) and connect
+    bool joined = false;
+    for (int attempt = 0; attempt < BENCH_JOIN_ATTEMPTS && !joined; attempt++) {
+        joined = (bench_join() == ESP_AT_OK);
+    }
+    if (!joined) {
+        fprintf(stderr, "Wi-Fi join failed\n");
+        bench_report(0, 0);
+        return 1;
+    }
+    bool link_up = (bench_connect() == ESP_AT_OK);
+
+    // 3. Back-to-back posts
+    uint32_t posted = 0;
+    uint64_t t0 = hal_host_micros();
+
+    for (uint32_t i = 0; i < cfg.posts; i++) {
+        if (!link_up) {
+            // Drop whatever is left of the old link, then reconnect
+            bench_cmd(OP_CIPCLOSE, "AT+CIPCLOSE", ESP_AT_RESPONSE_TIMEOUT_MS);
+            link_up = (bench_connect() == ESP_AT_OK);
+            if (!link_up) {
+                continue;
+            }
+        }
+
+        // Serialized in place, as the firmware does, or pulled while sending
+        uint16_t size = sizeof(stream_body);
+        char *body = cfg.stream ? stream_body : (char*)esp_at_http_body_buffer(&size);
+        int len = (body != NULL) ? bench_body(body, size, i * cfg.records + 1U, cfg.records) : -1;
+        if (len < 0) {
+            fprintf(stderr, "-r %u does not fit in one post\n", cfg.records);
+            return 2;
+        }
+
+        last_status = ESP_AT_BUSY;
+        stream_pos = 0;
+        esp_at_status_t queued = cfg.stream
+            ? esp_at_send_http_post_stream_async(cfg.endpoint, "application/json", (uint16_t)len,
+                                                 bench_pull, NULL, bench_done, bench_start(OP_POST))
+            : esp_at_send_http_post_async(cfg.endpoint, body, (uint16_t)len, bench_done,
+                                          bench_start(OP_POST));
+        if (queued != ESP_AT_OK) {
+            fprintf(stderr, "post of %d bytes rejected (body buffer is %u)\n", len, size);
+            return 2;
+        }
+        bench_run();
+
+        if (last_status == ESP_AT_OK) {
+            posted++;
+            bytes_posted += (uint32_t)len;
+            if (esp_at_get_http_stats()->retry_after_ms > 0) {
+                bench_pause(esp_at_get_http_stats()->retry_after_ms);
+            }
+        } else if (last_status == ESP_AT_HTTP_ERROR) {
+            uint32_t ms = esp_at_get_http_stats()->retry_after_ms;
+            bench_pause(ms ? ms : BENCH_BACKOFF_MS); // Link is fine, the server pushed back
+        } else {
+            link_up = false;
+        }
+    }
+
+    bench_report((hal_host_micros() - t0) / 1e6, posted);
+    return 0;
+}
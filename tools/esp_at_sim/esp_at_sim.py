@@ -0,0 +1,457 @@
+#!/usr/bin/env python3
+# esp_at_sim.py
+# ESP-AT modem simulator on a Linux pseudo-terminal
+#
+# Speaks the command subset used by Core/Src/esp_at.c and forwards the
+# CIPSTART link to a real socket, so the firmware AT layer (built for the
+# host, see esp_at_bench.c) can be driven against server/server.js.
+#
+#   AT, ATE0/ATE1, AT+RST, AT+CWMODE=<n>, AT+CWJAP="ssid","pw",
+#   AT+CIPSTART="TCP"|"UDP","ip",port[,...], AT+CIPSEND=<n>,
+#   AT+CIPMODE=<0|1>, AT+CIPSEND (passthrough, left with a guarded "+++"),
+#   AT+CIPCLOSE, AT+GMR, AT+UART_CUR=<baud>,8,1,0,<flow>,
+#   AT+CWSTATE?, AT+CWAUTOCONN=<0|1>
+#
+# AT+RST is a real reboot: input is ignored until "ready" (--boot-ms), and
+# with a stored AP (an earlier AT+CWJAP, or --stored-ap) and auto-connect on
+# the module rejoins by itself, printing "WIFI CONNECTED" / "WIFI GOT IP"
+# --join-ms after "ready".
+#
+# A pty has no line rate, so AT+UART_CUR only records the setting; the host
+# HAL models wire time itself. --no-flow-ctrl acts as if RTS/CTS were not
+# wired: while flow control is on, nothing the module sends arrives.
+#
+# Server replies come back as "+IPD,<n>:<data>" (raw in passthrough) and a
+# remote close as "CLOSED". Faults can be injected per command: reply
+# latency and jitter, ERROR / SEND FAIL replies, silently dropped replies
+# (firmware timeouts) and periodic link drops.
+#
+# Usage:
+#   python3 tools/esp_at_sim/esp_at_sim.py --link /tmp/esp --forward 127.0.0.1:3000
+#   python3 tools/esp_at_sim/esp_at_sim.py --link /tmp/esp --latency-ms 20 --error-rate 0.05
+#
+# The pty path (or --link symlink) is the "UART" to open on the other side.
+
+import argparse
+import heapq
+import os
+import random
+import re
+import select
+import signal
+import socket
+import sys
+import time
+import tty
+
+ESCAPE_GUARD_S = 0.020   # ESP-AT requires >= 20 ms idle around "+++"
+CIPSEND_MAX = 2048
+
+
+class Modem:
+    def __init__(self, fd, args):
+        self.fd = fd
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.echo = True
+        self.line = bytearray()
+        self.mode = 'cmd'            # cmd | data | passthrough
+        self.cipmode = 0
+        self.data_left = 0
+        self.data = bytearray()
+        self.sock = None
+        self.sock_udp = False
+        self.joined = args.stored_ap   # Already running and joined
+        self.stored_ap = args.stored_ap
+        self.autoconn = True
+        self.boot_until = 0.0        # Input ignored while booting
+        self.autojoin_at = None
+        self.baud = 115200
+        self.flow = False
+        self.sends = 0
+        self.out = []                # heap of (due, seq, bytes)
+        self.out_seq = 0
+        self.out_last_due = 0.0
+        self.last_rx = 0.0           # last byte from the MCU (escape guard)
+        self.plus_pending = b''
+        self.plus_t = 0.0
+        self.stats = {'commands': 0, 'sends': 0, 'bytes_up': 0, 'bytes_down': 0,
+                      'errors': 0, 'drops': 0, 'disconnects': 0}
+
+    # ===== Output =====
+
+    # Queue bytes for the MCU. Reply order is preserved: a reply is never
+    # due before one queued earlier.
+    # Unsolicited messages (urc) are not held back by pending replies.
+    def emit(self, data, delay=0.0, urc=False):
+        if self.flow and self.args.no_flow_ctrl:
+            return  # Our CTS never asserts
+        due = time.monotonic() + delay
+        if not urc:
+            due = max(due, self.out_last_due)
+            self.out_last_due = due
+        heapq.heappush(self.out, (due, self.out_seq, data))
+        self.out_seq += 1
+
+    def reply(self, data):
+        latency = self.args.latency_ms + self.rng.uniform(0, self.args.jitter_ms)
+        self.emit(data, latency / 1000.0)
+
+    def flush(self):
+        now = time.monotonic()
+        while self.out and self.out[0][0] <= now:
+            _, _, data = heapq.heappop(self.out)
+            try:
+                os.write(self.fd, data)
+            except OSError:
+                pass  # No reader on the slave side yet
+
+    def next_due(self):
+        return self.out[0][0] if self.out else None
+
+    # ===== Input from the MCU =====
+
+    def feed(self, data):
+        now = time.monotonic()
+        if now < self.boot_until:
+            return  # Still in the bootloader
+        idle = now - self.last_rx
+        self.last_rx = now
+
+        if self.mode == 'passthrough':
+            self.feed_passthrough(data, idle, now)
+            return
+
+        i = 0
+        while i < len(data):
+            if self.mode == 'data':
+                take = min(self.data_left, len(data) - i)
+                self.data += data[i:i + take]
+                self.data_left -= take
+                i += take
+                if self.data_left == 0:
+                    self.finish_send()
+                continue
+            if self.mode == 'passthrough':
+                self.feed_passthrough(data[i:], 0.0, now)
+                return
+
+            b = data[i:i + 1]
+            i += 1
+            if self.echo and not (self.flow and self.args.no_flow_ctrl):
+                os.write(self.fd, b)
+            if b == b'\n':
+                cmd = self.line.rstrip(b'\r').decode('latin-1')
+                self.line.clear()
+                if cmd:
+                    self.command(cmd)
+            else:
+                self.line += b
+
+    def feed_passthrough(self, data, idle, now):
+        # "+++" alone, with idle line before and after, leaves passthrough
+        if self.plus_pending:
+            self.plus_pending += data
+        elif idle >= ESCAPE_GUARD_S and data.startswith(b'+'):
+            self.plus_pending = bytes(data)
+        else:
+            self.forward(data)
+            return
+        self.plus_t = now
+        if not b'+++'.startswith(self.plus_pending):
+            self.forward(self.plus_pending)  # Ordinary data after all
+            self.plus_pending = b''
+
+    def tick(self):
+        # Auto-connect to the stored AP after boot
+        if self.autojoin_at is not None and time.monotonic() >= self.autojoin_at:
+            self.autojoin_at = None
+            self.joined = True
+            self.emit(b'WIFI CONNECTED\r\n', urc=True)
+            self.emit(b'WIFI GOT IP\r\n', urc=True)
+
+        # Escape sequence completes once the trailing guard time has passed
+        if self.plus_pending and time.monotonic() - self.plus_t >= ESCAPE_GUARD_S:
+            if self.plus_pending == b'+++':
+                self.mode = 'cmd'
+                self.line.clear()
+            else:
+                self.forward(self.plus_pending)
+            self.plus_pending = b''
+
+    def forward(self, data):
+        if self.sock is None:
+            return
+        try:
+            self.sock.send(bytes(data))
+            self.stats['bytes_up'] += len(data)
+        except OSError:
+            self.remote_closed()
+
+    # ===== Commands =====
+
+    def fault(self):
+        if self.rng.random() < self.args.drop_rate:
+            self.stats['drops'] += 1
+            return 'drop'
+        if self.rng.random() < self.args.error_rate:
+            self.stats['errors'] += 1
+            return 'error'
+        return None
+
+    def command(self, cmd):
+        self.stats['commands'] += 1
+        if self.args.verbose:
+            print('<< ' + cmd, file=sys.stderr)
+
+        f = self.fault()
+        if f == 'drop':
+            return
+        if f == 'error':
+            self.reply(b'\r\nERROR\r\n')
+            return
+
+        up = cmd.upper()
+        if up == 'AT':
+            self.reply(b'\r\nOK\r\n')
+        elif up in ('ATE0', 'ATE1'):
+            self.echo = up == 'ATE1'
+            self.reply(b'\r\nOK\r\n')
+        elif up == 'AT+RST':
+            self.reply(b'\r\nOK\r\n')
+            self.close_link(notify=False)
+            self.joined = False
+            self.echo = True
+            self.cipmode = 0
+            self.baud = 115200
+            self.flow = False
+            self.boot_until = self.out_last_due + self.args.boot_ms / 1000.0
+            self.emit(b'\r\nready\r\n', self.args.boot_ms / 1000.0)
+            if self.stored_ap and self.autoconn:
+                self.autojoin_at = self.boot_until + self.args.join_ms / 1000.0
+        elif up == 'AT+GMR':
+            self.reply(b'AT version:2.2.0.0(esp_at_sim)\r\n'
+                       b'SDK version:v4.2.2-76-gefa6eca\r\n'
+                       b'compile time(0000000):Jan  1 2024 00:00:00\r\n'
+                       b'Bin version:2.2.0(ESP32_SIM)\r\n\r\nOK\r\n')
+        elif up.startswith('AT+UART_CUR='):
+            self.uart_cur(up)
+        elif re.fullmatch(r'AT\+CWMODE=[0-3]', up):
+            self.reply(b'\r\nOK\r\n')
+        elif up == 'AT+CWSTATE?':
+            state = 2 if self.joined else (3 if self.autojoin_at is not None else 0)
+            ssid = b'sim' if self.joined or self.autojoin_at is not None else b''
+            self.reply(b'+CWSTATE:%d,"%s"\r\n\r\nOK\r\n' % (state, ssid))
+        elif re.fullmatch(r'AT\+CWAUTOCONN=[01]', up):
+            self.autoconn = up[-1] == '1'
+            self.reply(b'\r\nOK\r\n')
+        elif up.startswith('AT+CWJAP='):
+            self.joined = True
+            self.stored_ap = True
+            self.autojoin_at = None
+            self.emit(b'WIFI CONNECTED\r\n', self.args.join_ms / 2000.0)
+            self.emit(b'WIFI GOT IP\r\n', self.args.join_ms / 1000.0)
+            self.reply(b'\r\nOK\r\n')
+        elif up.startswith('AT+CIPSTART='):
+            self.cipstart(cmd)
+        elif re.fullmatch(r'AT\+CIPMODE=[01]', up):
+            self.cipmode = int(up[-1])
+            self.reply(b'\r\nOK\r\n')
+        elif up == 'AT+CIPSEND' and self.cipmode == 1:
+            if self.sock is None:
+                self.reply(b'\r\nERROR\r\n')
+                return
+            self.mode = 'passthrough'
+            self.reply(b'\r\nOK\r\n\r\n>')
+        elif up.startswith('AT+CIPSEND='):
+            n = int(up.split('=', 1)[1]) if up.split('=', 1)[1].isdigit() else 0
+            if self.sock is None or n <= 0 or n > CIPSEND_MAX or self.cipmode != 0:
+                self.reply(b'\r\nERROR\r\n')
+                return
+            self.mode = 'data'
+            self.data_left = n
+            self.data = bytearray()
+            self.reply(b'\r\nOK\r\n> ')
+        elif up == 'AT+CIPCLOSE':
+            if self.sock is None:
+                self.reply(b'\r\nERROR\r\n')
+                return
+            self.close_link(notify=False)
+            self.reply(b'CLOSED\r\n\r\nOK\r\n')
+        else:
+            self.reply(b'\r\nERROR\r\n')
+
+    def uart_cur(self, up):
+        m = re.fullmatch(r'AT\+UART_CUR=(\d+),8,1,0,([0-3])', up)
+        if m is None or not 80 <= int(m.group(1)) <= self.args.max_baud:
+            self.reply(b'\r\nERROR\r\n')
+            return
+        self.reply(b'\r\nOK\r\n')  # Still at the old setting
+        self.baud = int(m.group(1))
+        self.flow = m.group(2) == '3'
+        if self.args.verbose:
+            print('   UART %d baud%s' % (self.baud, ', RTS/CTS' if self.flow else ''),
+                  file=sys.stderr)
+
+    def cipstart(self, cmd):
+        m = re.fullmatch(r'AT\+CIPSTART="(TCP|UDP)","([^"]+)",(\d+)(,.*)?', cmd, re.I)
+        if m is None or not self.joined:
+            self.reply(b'\r\nERROR\r\n')
+            return
+        if self.sock is not None:
+            self.reply(b'ALREADY CONNECTED\r\n\r\nERROR\r\n')
+            return
+
+        udp = m.group(1).upper() == 'UDP'
+        host, port = m.group(2), int(m.group(3))
+        if self.args.forward:
+            host, port = self.args.forward
+        try:
+            if udp:
+                s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+                s.connect((host, port))
+            else:
+                s = socket.create_connection((host, port), timeout=5)
+                s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            s.setblocking(False)
+        except OSError as e:
+            print('CIPSTART %s:%d failed: %s' % (host, port, e), file=sys.stderr)
+            self.reply(b'\r\nERROR\r\nCLOSED\r\n')
+            return
+        self.sock = s
+        self.sock_udp = udp
+        self.reply(b'CONNECT\r\n\r\nOK\r\n')
+
+    def finish_send(self):
+        self.mode = 'cmd'
+        n = len(self.data)
+        self.stats['sends'] += 1
+        self.sends += 1
+
+        f = self.fault()
+        if f == 'drop':
+            return
+        if f == 'error' or self.sock is None:
+            self.reply(('\r\nRecv %d bytes\r\n\r\nSEND FAIL\r\n' % n).encode())
+            return
+
+        self.forward(self.data)
+        self.reply(('\r\nRecv %d bytes\r\n\r\nSEND OK\r\n' % n).encode())
+
+        every = self.args.disconnect_every
+        if every > 0 and self.sends % every == 0 and self.sock is not None:
+            self.stats['disconnects'] += 1
+            self.close_link(notify=True)
+
+    # ===== Link =====
+
+    def close_link(self, notify):
+        if self.sock is None:
+            return
+        self.sock.close()
+        self.sock = None
+        if self.mode == 'passthrough':
+            self.mode = 'cmd'
+        if notify:
+            self.reply(b'CLOSED\r\n')
+
+    def remote_closed(self):
+        self.close_link(notify=True)
+
+    def sock_readable(self):
+        try:
+            data = self.sock.recv(4096)
+        except BlockingIOError:
+            return
+        except OSError:
+            data = b''
+        if not data:
+            self.remote_closed()
+            return
+        self.stats['bytes_down'] += len(data)
+        if self.mode == 'passthrough':
+            self.emit(data)
+        else:
+            self.emit(b'\r\n+IPD,%d:' % len(data) + data)
+
+
+def parse_forward(s):
+    host, _, port = s.rpartition(':')
+    return (host or '127.0.0.1', int(port))
+
+
+def main():
+    p = argparse.ArgumentParser(description='ESP-AT modem simulator on a pty')
+    p.add_argument('--link', help='create a symlink to the pty slave at this path')
+    p.add_argument('--forward', type=parse_forward, metavar='HOST:PORT',
+                   help='connect CIPSTART here instead of the requested address')
+    p.add_argument('--latency-ms', type=float, default=0.0, help='reply delay')
+    p.add_argument('--jitter-ms', type=float, default=0.0, help='extra random reply delay')
+    p.add_argument('--error-rate', type=float, default=0.0,
+                   help='probability of ERROR / SEND FAIL per command')
+    p.add_argument('--drop-rate', type=float, default=0.0,
+                   help='probability of no reply at all per command')
+    p.add_argument('--disconnect-every', type=int, default=0, metavar='N',
+                   help='drop the link after every N sends')
+    p.add_argument('--max-baud', type=int, default=5000000,
+                   help='AT+UART_CUR rates above this are refused')
+    p.add_argument('--no-flow-ctrl', action='store_true',
+                   help='RTS/CTS not wired: output is lost while flow control is on')
+    p.add_argument('--boot-ms', type=float, default=300.0, help='AT+RST to "ready"')
+    p.add_argument('--join-ms', type=float, default=0.0,
+                   help='AT+CWJAP / auto-connect association time')
+    p.add_argument('--stored-ap', action='store_true',
+                   help='start joined, with an AP stored for auto-connect after AT+RST')
+    p.add_argument('--seed', type=int, default=None)
+    p.add_argument('-v', '--verbose', action='store_true')
+    args = p.parse_args()
+
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    path = os.ttyname(slave)
+    if args.link:
+        if os.path.islink(args.link):
+            os.unlink(args.link)
+        os.symlink(path, args.link)
+    print('ESP-AT simulator on %s%s' % (path, ' -> ' + args.link if args.link else ''),
+          file=sys.stderr)
+    sys.stderr.flush()
+
+    modem = Modem(master, args)
+    running = [True]
+
+    def stop(signum, frame):
+        running[0] = False
+    signal.signal(signal.SIGINT, stop)
+    signal.signal(signal.SIGTERM, stop)
+
+    try:
+        while running[0]:
+            fds = [master] + ([modem.sock] if modem.sock is not None else [])
+            timeout = 0.005
+            due = modem.next_due()
+            if due is not None:
+                timeout = min(timeout, max(0.0, due - time.monotonic()))
+            try:
+                readable, _, _ = select.select(fds, [], [], timeout)
+            except InterruptedError:
+                continue
+            for r in readable:
+                if r == master:
+                    try:
+                        modem.feed(os.read(master, 4096))
+                    except OSError:
+                        pass  # Slave not opened yet
+                elif modem.sock is not None:
+                    modem.sock_readable()
+            modem.tick()
+            modem.flush()
+    finally:
+        if args.link and os.path.islink(args.link):
+            os.unlink(args.link)
+        print('stats: ' + ' '.join('%s=%d' % kv for kv in modem.stats.items()),
+              file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
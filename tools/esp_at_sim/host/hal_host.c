@@ -0,0 +1,236 @@
+/**
+  ******************************************************************************
+  * @file    hal_host.c
+  * @brief   Host stand-in for the STM32 HAL subset used by esp_at.c
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private variables ---------------------------------------------------------*/
+static uint64_t start_us;
+
+/* The one UART HAL_Delay() keeps servicing, like interrupts on the target */
+static UART_HandleTypeDef *delay_huart;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Wire time of n bytes at 10 bits per byte (8N1)
+  */
+static uint64_t wire_us(const UART_HandleTypeDef *huart, uint32_t n)
+{
+    return (uint64_t)n * 10U * 1000000U / huart->Init.BaudRate;
+}
+
+/**
+  * @brief  Write everything, retrying short writes on the non-blocking tty
+  */
+static int write_all(int fd, const uint8_t *data, uint16_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                struct pollfd p = { .fd = fd, .events = POLLOUT };
+                poll(&p, 1, 10);
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        size -= (uint16_t)n;
+    }
+    return 0;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+uint64_t hal_host_micros(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    if (start_us == 0) {
+        start_us = hal_host_micros();
+    }
+    return (uint32_t)((hal_host_micros() - start_us) / 1000U);
+}
+
+void HAL_Delay(uint32_t ms)
+{
+    uint64_t end = hal_host_micros() + (uint64_t)ms * 1000U;
+    uint64_t now;
+
+    while ((now = hal_host_micros()) < end) {
+        uint64_t left = end - now;
+        if (delay_huart != NULL) {
+            hal_host_service(delay_huart, left > 1000U ? 1000U : (uint32_t)left);
+        } else {
+            usleep((useconds_t)left);
+        }
+    }
+}
+
+int hal_host_uart_open(UART_HandleTypeDef *huart, const char *path, uint32_t baud)
+{
+    struct termios tio;
+
+    memset(huart, 0, sizeof(*huart));
+    huart->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (huart->fd < 0) {
+        return -1;
+    }
+    if (tcgetattr(huart->fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(huart->fd, TCSANOW, &tio);
+    }
+    huart->Init.BaudRate = baud;
+    huart->Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    huart->gState = HAL_UART_STATE_READY;
+    delay_huart = huart;
+    return 0;
+}
+
+void hal_host_service(UART_HandleTypeDef *huart, uint32_t wait_us)
+{
+    uint64_t now = hal_host_micros();
+
+    // Shift out the TX bytes whose wire time has elapsed; "TX complete
+    // interrupt" after the last one
+    if (huart->gState == HAL_UART_STATE_BUSY_TX) {
+        uint64_t due = (now - huart->tx_start_us) * huart->Init.BaudRate / 10U / 1000000U;
+        if (due > huart->tx_size) {
+            due = huart->tx_size;
+        }
+        if (due > huart->tx_sent) {
+            uint16_t n = (uint16_t)due - huart->tx_sent;
+            write_all(huart->fd, &huart->tx_ptr[huart->tx_sent], n);
+            huart->tx_sent += n;
+        }
+        if (huart->tx_sent == huart->tx_size) {
+            huart->gState = HAL_UART_STATE_READY;
+        }
+    }
+
+    // Sleep until input, the next due RX byte or the TX end, whichever first
+    uint64_t wake = now + wait_us;
+    if (huart->rx_fifo_len > 0 && huart->rx_left > 0 &&
+        huart->rx_next_us + wire_us(huart, 1) < wake) {
+        wake = huart->rx_next_us + wire_us(huart, 1);
+    }
+    if (huart->gState == HAL_UART_STATE_BUSY_TX) {
+        uint64_t next_tx = huart->tx_start_us + wire_us(huart, huart->tx_sent + 1U);
+        if (next_tx < wake) {
+            wake = next_tx;
+        }
+    }
+    if (wake > now && huart->rx_fifo_len < sizeof(huart->rx_fifo)) {
+        struct pollfd p = { .fd = huart->fd, .events = POLLIN };
+        poll(&p, 1, (int)((wake - now + 999U) / 1000U));
+    }
+
+    // Pull whatever the modem has sent into the wire model
+    while (huart->rx_fifo_len < sizeof(huart->rx_fifo)) {
+        uint16_t tail = (huart->rx_fifo_head + huart->rx_fifo_len) % sizeof(huart->rx_fifo);
+        uint16_t room = sizeof(huart->rx_fifo) - huart->rx_fifo_len;
+        if (room > sizeof(huart->rx_fifo) - tail) {
+            room = sizeof(huart->rx_fifo) - tail;
+        }
+        ssize_t n = read(huart->fd, &huart->rx_fifo[tail], room);
+        if (n <= 0) {
+            break;
+        }
+        if (huart->rx_fifo_len == 0 && huart->rx_next_us < hal_host_micros()) {
+            huart->rx_next_us = hal_host_micros(); // Line was idle
+        }
+        huart->rx_fifo_len += (uint16_t)n;
+    }
+
+    // RX "interrupts": one byte per wire slot that has already elapsed
+    now = hal_host_micros();
+    while (huart->rx_fifo_len > 0 && huart->rx_left > 0 &&
+           now >= huart->rx_next_us + wire_us(huart, 1)) {
+        *huart->rx_ptr++ = huart->rx_fifo[huart->rx_fifo_head];
+        huart->rx_fifo_head = (huart->rx_fifo_head + 1) % sizeof(huart->rx_fifo);
+        huart->rx_fifo_len--;
+        huart->rx_next_us += wire_us(huart, 1);
+        if (--huart->rx_left == 0) {
+            HAL_UART_RxCpltCallback(huart); // Re-arms with HAL_UART_Receive_IT()
+        }
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data,
+                                    uint16_t size, uint32_t timeout)
+{
+    (void)timeout;
+    if (HAL_UART_Transmit_IT(huart, data, size) != HAL_OK) {
+        return HAL_BUSY;
+    }
+    while (huart->gState != HAL_UART_STATE_READY) {
+        hal_host_service(huart, 1000U);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *data,
+                                       uint16_t size)
+{
+    if (huart->gState != HAL_UART_STATE_READY) {
+        return HAL_BUSY;
+    }
+    if (size == 0) {
+        return HAL_ERROR;
+    }
+    huart->tx_ptr = data;
+    huart->tx_size = size;
+    huart->tx_sent = 0;
+    huart->tx_start_us = hal_host_micros();
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size)
+{
+    if (huart->rx_left > 0) {
+        return HAL_BUSY;
+    }
+    huart->rx_ptr = data;
+    huart->rx_left = size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart)
+{
+    huart->tx_size = huart->tx_sent; // Bytes not yet shifted out are dropped
+    huart->gState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    huart->rx_left = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    // New Init.BaudRate applies from the next byte; the wire is idle here
+    if (huart->Init.BaudRate == 0 || huart->gState != HAL_UART_STATE_READY) {
+        return HAL_ERROR;
+    }
+    huart->rx_next_us = hal_host_micros();
+    return HAL_OK;
+}
@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file    main.h
+  * @brief   Host stand-in for the STM32 HAL subset used by esp_at.c
+  ******************************************************************************
+  *
+  * Force-included (-include host/main.h) so that Core/Src/esp_at.c builds
+  * unchanged on Linux: the shared __MAIN_H guard then turns the STM32
+  * main.h, which esp_at.h pulls in from its own directory, into a no-op. The UART is a tty (the esp_at_sim.py pty) with the
+  * wire time of every byte modelled at huart->Init.BaudRate, so command/response
+  * timings match a real link at that rate.
+  */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef enum {
+    HAL_UART_STATE_RESET   = 0x00U,
+    HAL_UART_STATE_READY   = 0x20U,
+    HAL_UART_STATE_BUSY_TX = 0x21U
+} HAL_UART_StateTypeDef;
+
+typedef struct {
+    uint32_t  BaudRate;                  // Modelled line rate (8N1)
+    uint32_t  HwFlowCtl;                 // Accepted, no effect on a pty
+} UART_InitTypeDef;
+
+typedef struct {
+    int       fd;                        // tty file descriptor
+    UART_InitTypeDef Init;
+    volatile HAL_UART_StateTypeDef gState;
+    const uint8_t *tx_ptr;               // HAL_UART_Transmit_IT() buffer
+    uint16_t  tx_size;
+    uint16_t  tx_sent;                   // Bytes already on the wire
+    uint64_t  tx_start_us;
+    uint8_t  *rx_ptr;                    // Armed HAL_UART_Receive_IT() target
+    uint16_t  rx_left;
+    uint8_t   rx_fifo[4096];             // Bytes read from the tty, not yet "on the wire"
+    uint16_t  rx_fifo_head;
+    uint16_t  rx_fifo_len;
+    uint64_t  rx_next_us;                // Wire time of the last delivered byte
+} UART_HandleTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define HAL_MAX_DELAY   0xFFFFFFFFU
+
+#define UART_HWCONTROL_NONE     0x00U
+#define UART_HWCONTROL_RTS_CTS  0x03U
+
+/* Exported functions --------------------------------------------------------*/
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data,
+                                    uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *data,
+                                       uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+
+/* Provided by the application, as on the target */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  Open a tty as a raw UART
+  * @param  huart: Handle to initialize
+  * @param  path: Device path (pty slave from esp_at_sim.py)
+  * @param  baud: Modelled line rate
+  * @retval 0 on success, -1 on error
+  */
+int hal_host_uart_open(UART_HandleTypeDef *huart, const char *path, uint32_t baud);
+
+/**
+  * @brief  Stand-in for the UART interrupts: finish due TX, deliver due RX
+  * @param  huart: UART handle
+  * @param  wait_us: Longest time to block waiting for input
+  */
+void hal_host_service(UART_HandleTypeDef *huart, uint32_t wait_us);
+
+/**
+  * @brief  Monotonic time in microseconds
+  */
+uint64_t hal_host_micros(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
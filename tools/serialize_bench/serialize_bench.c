@@ -0,0 +1,1007 @@
+/**
+  ******************************************************************************
+  * @file    serialize_bench.c
+  * @brief   Host benchmark and correctness check for the telemetry encoders
+  ******************************************************************************
+  *
+  * Runs the firmware serializers unchanged on Linux:
+  *
+  *   builder   json_builder_t, one flat object per record (the pre-template
+  *             telemetry path)
+  *   template  telemetry_build_json_batch() / json_template_render()
+  *   stream    telemetry_write_json_batch() / json_stream_t through a
+  *             BENCH_CHUNK_SIZE buffer and a memcpy sink
+  *   binary    telemetry_build_bin_batch() / bin_frame_t
+  *
+  * over three record shapes:
+  *
+  *   single    one telemetry record (t, pA, pB, fan, seq) as a batch of one
+  *   batch50   50 telemetry records, consecutive seq
+  *   ch16      10 samples of 16 int32 channels ({"t":..,"c0":..,..,"c15":..})
+  *
+  * Before timing, every encoder/shape pair encodes BENCH_CHECK_ROUNDS random
+  * inputs (edge values included) and the output is decoded independently:
+  * JSON with the strict RFC 8259 parser below, binary frames with a decoder
+  * written from the bin_frame.h / ts_codec.h format description and a
+  * bitwise CRC. Any mismatch fails the run (exit 1).
+  *
+  * Fixed-point fields are checked the same way, against a printf reference:
+  * 0, +-1, INT32_MIN / INT32_MAX and BENCH_FIXED_RANDOM random values at
+  * every scale through json_format_fixed(), json_add_fixed(), a
+  * JSON_SLOT_FIXED template slot and json_stream_fixed(), and a scale above
+  * JSON_FIXED_MAX_DECIMALS must be refused by all four.
+  *
+  * ns/msg is the mean time of one encode call; bytes/msg its output size.
+  */
+
+#include "json_builder.h"
+#include "telemetry.h"
+#include "bin_frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define BENCH_MAX_SAMPLES   50
+#define BENCH_MAX_CHANNELS  16
+#define BENCH_OUT_SIZE      8192
+#define BENCH_CHUNK_SIZE    256    // Stream encoder chunk
+#define BENCH_CHECK_ROUNDS  500
+#define BENCH_MIN_NS        200000000ULL   // Timing window per case (-t)
+#define BENCH_DEVICE_ID     0x5EED0001U
+#define BENCH_BOOT_ID       0xB007U
+#define BENCH_FIXED_RANDOM  1000   // Random values per scale, after the edges
+#define JREF_MAX_NODES      2048
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    SHAPE_SINGLE = 0,
+    SHAPE_BATCH50,
+    SHAPE_CH16,
+    SHAPE_COUNT
+} bench_shape_t;
+
+typedef enum {
+    ENC_BUILDER = 0,
+    ENC_TEMPLATE,
+    ENC_STREAM,
+    ENC_BINARY,
+    ENC_COUNT
+} bench_enc_t;
+
+/* One message worth of input; telemetry shapes use channels 0..2 as pA, pB, fan */
+typedef struct {
+    bench_shape_t shape;
+    uint16_t n;
+    uint8_t  channels;
+    uint32_t t[BENCH_MAX_SAMPLES];
+    uint32_t seq[BENCH_MAX_SAMPLES];
+    int32_t  v[BENCH_MAX_SAMPLES][BENCH_MAX_CHANNELS];
+    telemetry_record_t recs[BENCH_MAX_SAMPLES];
+} bench_input_t;
+
+typedef struct {
+    uint8_t *out;
+    uint32_t len;
+    uint32_t size;
+} bench_sink_t;
+
+/* Reference parser DOM node */
+typedef enum {
+    JREF_NULL = 0,
+    JREF_FALSE,
+    JREF_TRUE,
+    JREF_NUMBER,
+    JREF_STRING,
+    JREF_ARRAY,
+    JREF_OBJECT
+} jref_type_t;
+
+typedef struct {
+    jref_type_t type;
+    const char *key;       // Member name (raw, escapes not expanded), NULL in arrays
+    uint16_t    key_len;
+    double      num;
+    int         first;     // First child, -1 if none
+    int         next;      // Next sibling, -1 if last
+    int         count;     // Children
+} jref_node_t;
+
+typedef struct {
+    const char *p;
+    const char *end;
+    jref_node_t nodes[JREF_MAX_NODES];
+    int         n;
+    int         depth;
+} jref_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const char *shape_names[SHAPE_COUNT] = { "single", "batch50", "ch16" };
+static const uint16_t shape_samples[SHAPE_COUNT] = { 1, 50, 10 };
+static const uint8_t shape_channels[SHAPE_COUNT] = { 3, 3, 16 };
+static const char *enc_names[ENC_COUNT] = { "builder", "template", "stream", "binary" };
+
+static const char *ch_keys[BENCH_MAX_CHANNELS] = {
+    "c0", "c1", "c2", "c3", "c4", "c5", "c6", "c7",
+    "c8", "c9", "c10", "c11", "c12", "c13", "c14", "c15"
+};
+
+static json_template_t tpl_ch16;
+static uint32_t rng_state = 0x12345678U;
+static jref_t jref;
+
+static struct {
+    uint64_t min_ns;
+    int      json;
+} cfg = { BENCH_MIN_NS, 0 };
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng(void)
+{
+    // xorshift32: reproducible across runs and hosts
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/**
+  * @brief  Value that exercises every digit count and sign now and then
+  */
+static int32_t rng_edge(int32_t lo, int32_t hi)
+{
+    static const int32_t edges[] = { 0, 1, -1, 9, 10, 99, 100, 65535,
+                                     INT32_MAX, INT32_MIN, 999999999, -1000000000 };
+    int32_t v = edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+    if (v < lo || v > hi) {
+        v = lo;
+    }
+    return v;
+}
+
+/**
+  * @brief  Fill one message of the given shape
+  * @param  in: Input to fill
+  * @param  shape: Record shape
+  * @param  edge: Mix in extreme values (correctness rounds)
+  */
+static void bench_make_input(bench_input_t *in, bench_shape_t shape, int edge)
+{
+    uint32_t t = edge && (rng() & 1U) ? 0xFFFFFF00U + (rng() & 0xFFU) : 1000U + (rng() % 100000U);
+    uint32_t seq = edge && (rng() & 1U) ? 0xFFFFFFF0U : rng() % 1000000U;
+    int32_t level[BENCH_MAX_CHANNELS];
+
+    in->shape = shape;
+    in->n = shape_samples[shape];
+    in->channels = shape_channels[shape];
+
+    for (uint8_t c = 0; c < BENCH_MAX_CHANNELS; c++) {
+        level[c] = 300 + (int32_t)(rng() % 500U);
+    }
+
+    for (uint16_t i = 0; i < in->n; i++) {
+        // 10 ms sampling with a little jitter; the tick may wrap
+        t += (edge && (rng() % 8U) == 0) ? rng() % 100000U : 9U + rng() % 3U;
+        in->t[i] = t;
+        // Mostly consecutive, with the occasional gap that forces "seq"
+        seq += (edge && (rng() % 5U) == 0) ? 2U + rng() % 1000U : 1U;
+        in->seq[i] = seq;
+
+        for (uint8_t c = 0; c < in->channels; c++) {
+            level[c] += (int32_t)(rng() % 41U) - 20;
+            in->v[i][c] = level[c];
+        }
+        if (in->channels == 3) {
+            // Telemetry: mW in uint16_t, fan 0/1
+            if (edge && (rng() % 4U) == 0) {
+                in->v[i][0] = rng_edge(0, 65535);
+                in->v[i][1] = (int32_t)(rng() % 65536U);
+            }
+            in->v[i][0] &= 0xFFFF;
+            in->v[i][1] &= 0xFFFF;
+            in->v[i][2] = (level[2] & 64) ? 1 : 0;
+            in->recs[i].t = in->t[i];
+            in->recs[i].seq = in->seq[i];
+            in->recs[i].pA = (uint16_t)in->v[i][0];
+            in->recs[i].pB = (uint16_t)in->v[i][1];
+            in->recs[i].fan = (uint8_t)in->v[i][2];
+        } else if (edge && (rng() % 4U) == 0) {
+            in->v[i][rng() % in->channels] = rng_edge(INT32_MIN, INT32_MAX);
+        }
+    }
+}
+
+/**
+  * @brief  Whether record i carries an explicit "seq" (telemetry.h rule)
+  */
+static int bench_has_seq(const bench_input_t *in, uint16_t i)
+{
+    return i == 0 || in->seq[i] != in->seq[i - 1] + 1U;
+}
+
+/* Encoders ------------------------------------------------------------------*/
+
+static int enc_builder(const bench_input_t *in, uint8_t *out, uint16_t size)
+{
+    char *buf = (char*)out;
+    json_builder_t jb;
+    uint16_t pos = 0;
+
+    buf[pos++] = '[';
+    for (uint16_t i = 0; i < in->n; i++) {
+        if (i > 0) {
+            buf[pos++] = ',';
+        }
+        json_init(&jb, &buf[pos], size - pos);
+        json_start(&jb);
+        if (json_add_uint(&jb, "t", in->t[i]) != 0) return -1;
+        if (in->channels == 3) {
+            if (json_add_uint(&jb, "pA", in->recs[i].pA) != 0) return -1;
+            if (json_add_uint(&jb, "pB", in->recs[i].pB) != 0) return -1;
+            if (json_add_bool(&jb, "fan", in->recs[i].fan) != 0) return -1;
+            if (bench_has_seq(in, i) && json_add_uint(&jb, "seq", in->seq[i]) != 0) return -1;
+        } else {
+            for (uint8_t c = 0; c < in->channels; c++) {
+                if (json_add_int(&jb, ch_keys[c], in->v[i][c]) != 0) return -1;
+            }
+        }
+        if (json_end(&jb) != 0) return -1;
+        pos += json_get_length(&jb);
+        if (pos + 2 > size) return -1;
+    }
+    buf[pos++] = ']';
+    return pos;
+}
+
+static int enc_template(const bench_input_t *in, uint8_t *out, uint16_t size)
+{
+    uint32_t values[1 + BENCH_MAX_CHANNELS];
+    uint16_t pos = 0;
+    int len;
+
+    if (in->channels == 3) {
+        return telemetry_build_json_batch(in->recs, in->n, (char*)out, size);
+    }
+
+    out[pos++] = '[';
+    for (uint16_t i = 0; i < in->n; i++) {
+        if (i > 0) {
+            out[pos++] = ',';
+        }
+        values[0] = in->t[i];
+        for (uint8_t c = 0; c < in->channels; c++) {
+            values[1 + c] = (uint32_t)in->v[i][c];
+        }
+        len = json_template_render(&tpl_ch16, values, (char*)&out[pos], size - pos - 2);
+        if (len < 0) return -1;
+        pos += len;
+    }
+    out[pos++] = ']';
+    return pos;
+}
+
+static int bench_sink(void *ctx, const char *data, uint16_t len)
+{
+    bench_sink_t *s = ctx;
+
+    if (s->len + len > s->size) {
+        return -1;
+    }
+    memcpy(&s->out[s->len], data, len);
+    s->len += len;
+    return 0;
+}
+
+static int enc_stream(const bench_input_t *in, uint8_t *out, uint16_t size)
+{
+    static char chunk[BENCH_CHUNK_SIZE];
+    bench_sink_t sink = { out, 0, size };
+    json_stream_t js;
+
+    json_stream_init(&js, chunk, sizeof(chunk), bench_sink, &sink);
+    if (in->channels == 3) {
+        telemetry_write_json_batch(in->recs, in->n, &js, NULL);
+    } else {
+        json_stream_begin_array(&js, NULL);
+        for (uint16_t i = 0; i < in->n; i++) {
+            json_stream_begin_object(&js, NULL);
+            json_stream_uint(&js, "t", in->t[i]);
+            for (uint8_t c = 0; c < in->channels; c++) {
+                json_stream_int(&js, ch_keys[c], in->v[i][c]);
+            }
+            json_stream_end_object(&js);
+        }
+        json_stream_end_array(&js);
+    }
+    return (json_stream_flush(&js) == 0) ? (int)sink.len : -1;
+}
+
+static int enc_binary(const bench_input_t *in, uint8_t *out, uint16_t size)
+{
+    bin_frame_t bf;
+    uint16_t len = 0;
+
+    if (in->channels == 3) {
+        int n = telemetry_build_bin_batch(in->recs, in->n, BENCH_DEVICE_ID, BENCH_BOOT_ID,
+                                          in->seq[0], out, size, &len);
+        return (n == in->n) ? len : -1;
+    }
+
+    if (bin_frame_begin(&bf, out, size, BENCH_DEVICE_ID, BENCH_BOOT_ID, in->seq[0], in->t[0],
+                        in->channels) != 0) {
+        return -1;
+    }
+    for (uint16_t i = 0; i < in->n; i++) {
+        if (bin_frame_add(&bf, in->t[i], in->v[i]) != 0) {
+            return -1;
+        }
+    }
+    return bin_frame_end(&bf);
+}
+
+static int bench_encode(bench_enc_t enc, const bench_input_t *in, uint8_t *out, uint16_t size)
+{
+    switch (enc) {
+    case ENC_BUILDER:  return enc_builder(in, out, size);
+    case ENC_TEMPLATE: return enc_template(in, out, size);
+    case ENC_STREAM:   return enc_stream(in, out, size);
+    default:           return enc_binary(in, out, size);
+    }
+}
+
+/* Reference JSON parser (strict RFC 8259, independent of json_builder.c) ----*/
+
+static void jref_ws(jref_t *j)
+{
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r')) {
+        j->p++;
+    }
+}
+
+static int jref_lit(jref_t *j, const char *lit)
+{
+    size_t n = strlen(lit);
+    if ((size_t)(j->end - j->p) < n || memcmp(j->p, lit, n) != 0) {
+        return -1;
+    }
+    j->p += n;
+    return 0;
+}
+
+static int jref_digits(jref_t *j)
+{
+    const char *s = j->p;
+    while (j->p < j->end && *j->p >= '0' && *j->p <= '9') {
+        j->p++;
+    }
+    return (j->p > s) ? 0 : -1;
+}
+
+static int jref_string(jref_t *j, const char **s, uint16_t *len)
+{
+    if (j->p >= j->end || *j->p != '"') {
+        return -1;
+    }
+    *s = ++j->p;
+    while (j->p < j->end && *j->p != '"') {
+        unsigned char ch = (unsigned char)*j->p;
+        if (ch < 0x20) {
+            return -1;
+        }
+        if (ch == '\\') {
+            j->p++;
+            if (j->p >= j->end) return -1;
+            if (*j->p == 'u') {
+                for (int k = 0; k < 4; k++) {
+                    j->p++;
+                    if (j->p >= j->end || !strchr("0123456789abcdefABCDEF", *j->p)) return -1;
+                }
+            } else if (!strchr("\"\\/bfnrt", *j->p)) {
+                return -1;
+            }
+        }
+        j->p++;
+    }
+    if (j->p >= j->end) {
+        return -1;
+    }
+    *len = (uint16_t)(j->p - *s);
+    j->p++;
+    return 0;
+}
+
+static int jref_value(jref_t *j, const char *key, uint16_t key_len)
+{
+    int id;
+    jref_node_t *nd;
+
+    if (j->n >= JREF_MAX_NODES || ++j->depth > 64) {
+        return -1;
+    }
+    id = j->n++;
+    nd = &j->nodes[id];
+    memset(nd, 0, sizeof(*nd));
+    nd->key = key;
+    nd->key_len = key_len;
+    nd->first = -1;
+    nd->next = -1;
+
+    jref_ws(j);
+    if (j->p >= j->end) {
+        return -1;
+    }
+
+    if (*j->p == '{' || *j->p == '[') {
+        int object = (*j->p == '{');
+        int prev = -1;
+        nd->type = object ? JREF_OBJECT : JREF_ARRAY;
+        j->p++;
+        jref_ws(j);
+        if (j->p < j->end && *j->p == (object ? '}' : ']')) {
+            j->p++;
+            j->depth--;
+            return id;
+        }
+        for (;;) {
+            const char *k = NULL;
+            uint16_t klen = 0;
+            int child;
+            if (object) {
+                jref_ws(j);
+                if (jref_string(j, &k, &klen) != 0) return -1;
+                jref_ws(j);
+                if (j->p >= j->end || *j->p++ != ':') return -1;
+            }
+            child = jref_value(j, k, klen);
+            if (child < 0) return -1;
+            nd = &j->nodes[id];
+            if (prev < 0) nd->first = child; else j->nodes[prev].next = child;
+            prev = child;
+            nd->count++;
+            jref_ws(j);
+            if (j->p >= j->end) return -1;
+            if (*j->p == ',') { j->p++; continue; }
+            if (*j->p++ != (object ? '}' : ']')) return -1;
+            break;
+        }
+    } else if (*j->p == '"') {
+        const char *s;
+        uint16_t len;
+        nd->type = JREF_STRING;
+        if (jref_string(j, &s, &len) != 0) return -1;
+    } else if (*j->p == 't') {
+        nd->type = JREF_TRUE;
+        if (jref_lit(j, "true") != 0) return -1;
+    } else if (*j->p == 'f') {
+        nd->type = JREF_FALSE;
+        if (jref_lit(j, "false") != 0) return -1;
+    } else if (*j->p == 'n') {
+        nd->type = JREF_NULL;
+        if (jref_lit(j, "null") != 0) return -1;
+    } else {
+        // -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+        const char *s = j->p;
+        char tmp[64];
+        nd->type = JREF_NUMBER;
+        if (*j->p == '-') j->p++;
+        if (j->p < j->end && *j->p == '0') {
+            j->p++;
+        } else if (jref_digits(j) != 0) {
+            return -1;
+        }
+        if (j->p < j->end && *j->p == '.') {
+            j->p++;
+            if (jref_digits(j) != 0) return -1;
+        }
+        if (j->p < j->end && (*j->p == 'e' || *j->p == 'E')) {
+            j->p++;
+            if (j->p < j->end && (*j->p == '+' || *j->p == '-')) j->p++;
+            if (jref_digits(j) != 0) return -1;
+        }
+        if ((size_t)(j->p - s) >= sizeof(tmp)) return -1;
+        memcpy(tmp, s, (size_t)(j->p - s));
+        tmp[j->p - s] = '\0';
+        nd->num = strtod(tmp, NULL);
+    }
+    j->depth--;
+    return id;
+}
+
+/**
+  * @brief  Parse a whole document
+  * @retval Root node, or NULL on a syntax error or trailing bytes
+  */
+static const jref_node_t *jref_parse(const char *text, size_t len)
+{
+    int root;
+
+    jref.p = text;
+    jref.end = text + len;
+    jref.n = 0;
+    jref.depth = 0;
+    root = jref_value(&jref, NULL, 0);
+    jref_ws(&jref);
+    return (root < 0 || jref.p != jref.end) ? NULL : &jref.nodes[root];
+}
+
+static const jref_node_t *jref_at(int id)
+{
+    return (id < 0) ? NULL : &jref.nodes[id];
+}
+
+/**
+  * @brief  Check the next member of an object: name and numeric value
+  */
+static int jref_expect_num(const jref_node_t **m, const char *key, double value)
+{
+    const jref_node_t *nd = *m;
+
+    if (nd == NULL || nd->type != JREF_NUMBER || nd->key_len != strlen(key) ||
+        memcmp(nd->key, key, nd->key_len) != 0 || nd->num != value) {
+        return -1;
+    }
+    *m = jref_at(nd->next);
+    return 0;
+}
+
+/**
+  * @brief  Check a JSON encoding of the input against the reference parse
+  */
+static int bench_check_json(const bench_input_t *in, const uint8_t *out, int len)
+{
+    const jref_node_t *root = jref_parse((const char*)out, (size_t)len);
+    const jref_node_t *rec;
+
+    if (root == NULL || root->type != JREF_ARRAY || root->count != in->n) {
+        return -1;
+    }
+    rec = jref_at(root->first);
+    for (uint16_t i = 0; i < in->n; i++, rec = jref_at(rec->next)) {
+        const jref_node_t *m;
+        if (rec->type != JREF_OBJECT) {
+            return -1;
+        }
+        m = jref_at(rec->first);
+        if (jref_expect_num(&m, "t", in->t[i]) != 0) {
+            return -1;
+        }
+        if (in->channels == 3) {
+            if (jref_expect_num(&m, "pA", in->recs[i].pA) != 0 ||
+                jref_expect_num(&m, "pB", in->recs[i].pB) != 0) {
+                return -1;
+            }
+            if (m == NULL || m->type != (in->recs[i].fan ? JREF_TRUE : JREF_FALSE) ||
+                m->key_len != 3 || memcmp(m->key, "fan", 3) != 0) {
+                return -1;
+            }
+            m = jref_at(m->next);
+            if (bench_has_seq(in, i) && jref_expect_num(&m, "seq", in->seq[i]) != 0) {
+                return -1;
+            }
+        } else {
+            for (uint8_t c = 0; c < in->channels; c++) {
+                if (jref_expect_num(&m, ch_keys[c], in->v[i][c]) != 0) {
+                    return -1;
+                }
+            }
+        }
+        if (m != NULL) {
+            return -1; // Unexpected extra member
+        }
+    }
+    return 0;
+}
+
+/* Reference binary frame decoder (from the bin_frame.h layout) --------------*/
+
+static uint16_t ref_crc16(const uint8_t *d, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)(d[i] << 8);
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t ref_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int32_t ref_unzigzag(uint32_t zz)
+{
+    return (int32_t)((zz >> 1) ^ (0U - (zz & 1U)));
+}
+
+static uint32_t ref_bits(const uint8_t *buf, uint32_t *bit, uint32_t end_bit, uint8_t n, int *err)
+{
+    uint32_t v = 0;
+    for (uint8_t k = 0; k < n; k++) {
+        if (*bit >= end_bit) {
+            *err = 1;
+            return 0;
+        }
+        v = (v << 1) | ((buf[*bit >> 3] >> (7U - (*bit & 7U))) & 1U);
+        (*bit)++;
+    }
+    return v;
+}
+
+static int32_t ref_bucket(const uint8_t *buf, uint32_t *bit, uint32_t end_bit, int *err)
+{
+    static const uint8_t widths[4] = { 7, 9, 12, 32 };
+    uint8_t prefix = 0;
+    while (prefix < 4 && ref_bits(buf, bit, end_bit, 1, err) == 1U) {
+        prefix++;
+    }
+    return prefix ? ref_unzigzag(ref_bits(buf, bit, end_bit, widths[prefix - 1], err)) : 0;
+}
+
+static uint32_t ref_varint(const uint8_t *buf, uint32_t *off, uint32_t end, int *err)
+{
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (*off >= end) {
+            break;
+        }
+        uint8_t b = buf[(*off)++];
+        v |= (uint32_t)(b & 0x7FU) << shift;
+        if ((b & 0x80U) == 0) {
+            return v;
+        }
+    }
+    *err = 1;
+    return 0;
+}
+
+static int bench_check_binary(const bench_input_t *in, const uint8_t *out, int len)
+{
+    uint32_t end = (uint32_t)len - BIN_FRAME_CRC_SIZE;
+    int32_t prev[BENCH_MAX_CHANNELS] = { 0 };
+    uint32_t t, off = BIN_FRAME_HEADER_SIZE, bit = BIN_FRAME_HEADER_SIZE * 8U;
+    int32_t dt = 0;
+    int err = 0;
+
+    if (len < BIN_FRAME_HEADER_SIZE + BIN_FRAME_CRC_SIZE || out[0] != 'E' || out[1] != 'F' ||
+        out[3] != in->channels || ref_le32(&out[4]) != BENCH_DEVICE_ID ||
+        ref_le32(&out[8]) != in->seq[0] || ref_le32(&out[12]) != in->t[0] ||
+        (uint16_t)(out[16] | (out[17] << 8)) != in->n ||
+        (uint16_t)(out[18] | (out[19] << 8)) != BENCH_BOOT_ID ||
+        ref_crc16(out, end) != (uint16_t)(out[end] | (out[end + 1] << 8))) {
+        return -1;
+    }
+
+    t = in->t[0];
+    for (uint16_t i = 0; i < in->n; i++) {
+        if (out[2] == BIN_FRAME_VERSION_TS_CODEC) {
+            dt = (int32_t)((uint32_t)dt + (uint32_t)ref_bucket(out, &bit, end * 8U, &err));
+            t += (uint32_t)dt;
+        } else {
+            t += ref_varint(out, &off, end, &err);
+        }
+        if (err || t != in->t[i]) {
+            return -1;
+        }
+        for (uint8_t c = 0; c < in->channels; c++) {
+            int32_t d = (out[2] == BIN_FRAME_VERSION_TS_CODEC)
+                            ? ref_bucket(out, &bit, end * 8U, &err)
+                            : ref_unzigzag(ref_varint(out, &off, end, &err));
+            prev[c] = (int32_t)((uint32_t)prev[c] + (uint32_t)d);
+            if (err || prev[c] != in->v[i][c]) {
+                return -1;
+            }
+        }
+    }
+
+    // Nothing but padding may follow the last sample
+    if (out[2] == BIN_FRAME_VERSION_TS_CODEC) {
+        return ((bit + 7U) / 8U == end) ? 0 : -1;
+    }
+    return (off == end) ? 0 : -1;
+}
+
+/* Fixed-point fields --------------------------------------------------------*/
+
+/**
+  * @brief  printf reference for a fixed-point value
+  * @retval Length of ref
+  */
+static int ref_fixed(char *ref, size_t size, int32_t value, uint8_t decimals)
+{
+    long long mag = (value < 0) ? -(long long)value : (long long)value;
+    long long scale = 1;
+
+    for (uint8_t d = 0; d < decimals; d++) {
+        scale *= 10;
+    }
+    if (decimals == 0) {
+        return snprintf(ref, size, "%ld", (long)value);
+    }
+    return snprintf(ref, size, "%s%lld.%0*lld", (value < 0) ? "-" : "",
+                    mag / scale, (int)decimals, mag % scale);
+}
+
+/**
+  * @brief  Encode one value through every fixed-point writer and compare
+  * @retval 0 if all match the reference
+  */
+static int bench_check_fixed_value(int32_t value, uint8_t decimals)
+{
+    static uint8_t out[BENCH_CHUNK_SIZE];
+    char ref[32], doc[48], num[JSON_FIXED_MAX_LEN];
+    int ref_len = ref_fixed(ref, sizeof(ref), value, decimals);
+    int doc_len = snprintf(doc, sizeof(doc), "{\"v\":%s}", ref);
+    uint8_t len;
+
+    // Raw, and never longer than the worst case callers reserve
+    len = json_format_fixed(num, value, decimals);
+    if (len != ref_len || len > JSON_FIXED_MAX_LEN || memcmp(num, ref, len) != 0) {
+        return -1;
+    }
+
+    // Builder; the document must also parse as JSON
+    json_builder_t jb;
+    json_init(&jb, (char *)out, sizeof(out));
+    json_start(&jb);
+    if (json_add_fixed(&jb, "v", value, decimals) != 0 || json_end(&jb) != 0 ||
+        json_get_length(&jb) != doc_len || memcmp(out, doc, (size_t)doc_len) != 0 ||
+        jref_parse((const char *)out, (size_t)doc_len) == NULL) {
+        return -1;
+    }
+
+    // Template slot
+    json_template_t tpl;
+    uint32_t slot = (uint32_t)value;
+    json_template_init(&tpl);
+    if (json_template_add_fixed(&tpl, "v", decimals) != 0 || json_template_end(&tpl) != 0 ||
+        json_template_render(&tpl, &slot, (char *)out, sizeof(out)) != doc_len ||
+        memcmp(out, doc, (size_t)doc_len) != 0) {
+        return -1;
+    }
+
+    // Stream
+    static char chunk[BENCH_CHUNK_SIZE];
+    bench_sink_t sink = { out, 0, sizeof(out) };
+    json_stream_t js;
+    json_stream_init(&js, chunk, sizeof(chunk), bench_sink, &sink);
+    json_stream_begin_object(&js, NULL);
+    json_stream_fixed(&js, "v", value, decimals);
+    json_stream_end_object(&js);
+    if (json_stream_flush(&js) != 0 || sink.len != (uint32_t)doc_len ||
+        memcmp(out, doc, (size_t)doc_len) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+  * @brief  A scale above JSON_FIXED_MAX_DECIMALS writes nothing anywhere
+  * @retval 0 if every writer refuses it
+  */
+static int bench_check_fixed_reject(uint8_t decimals)
+{
+    static uint8_t out[BENCH_CHUNK_SIZE];
+    char num[JSON_FIXED_MAX_LEN];
+    int failed = 0;
+
+    if (json_format_fixed(num, 1, decimals) != 0) {
+        failed = -1;
+    }
+
+    json_builder_t jb;
+    json_init(&jb, (char *)out, sizeof(out));
+    json_start(&jb);
+    uint16_t before = json_get_length(&jb);
+    if (json_add_fixed(&jb, "v", 1, decimals) != -1 || json_get_length(&jb) != before) {
+        failed = -1;
+    }
+
+    json_template_t tpl;
+    json_template_init(&tpl);
+    if (json_template_add_fixed(&tpl, "v", decimals) != -1 || tpl.slots != 0) {
+        failed = -1;
+    }
+
+    static char chunk[BENCH_CHUNK_SIZE];
+    bench_sink_t sink = { out, 0, sizeof(out) };
+    json_stream_t js;
+    json_stream_init(&js, chunk, sizeof(chunk), bench_sink, &sink);
+    json_stream_begin_object(&js, NULL);
+    if (json_stream_fixed(&js, "v", 1, decimals) != -1) {
+        failed = -1;
+    }
+    return failed;
+}
+
+/**
+  * @brief  Edge and random values at every scale, then out-of-range scales
+  * @param  cases: Receives the number of cases run
+  * @retval Number of failed cases
+  */
+static uint32_t bench_check_fixed(uint32_t *cases)
+{
+    static const int32_t edges[] = { 0, 1, -1, INT32_MIN, INT32_MAX };
+    uint32_t failed = 0;
+
+    *cases = 0;
+    for (uint8_t d = 0; d <= JSON_FIXED_MAX_DECIMALS; d++) {
+        for (uint32_t i = 0; i < sizeof(edges) / sizeof(edges[0]) + BENCH_FIXED_RANDOM; i++) {
+            // Past the edges: any digit count, either sign
+            int32_t value = (i < sizeof(edges) / sizeof(edges[0])) ? edges[i] :
+                            (int32_t)rng() / (int32_t)(1U << (rng() % 31U));
+            (*cases)++;
+            if (bench_check_fixed_value(value, d) != 0) {
+                if (failed == 0) {
+                    fprintf(stderr, "fixed: %ld with %u decimals failed\n", (long)value, d);
+                }
+                failed++;
+            }
+        }
+    }
+    for (unsigned d = JSON_FIXED_MAX_DECIMALS + 1U; d <= UINT8_MAX; d++) {
+        (*cases)++;
+        if (bench_check_fixed_reject((uint8_t)d) != 0) {
+            if (failed == 0) {
+                fprintf(stderr, "fixed: %u decimals not refused\n", d);
+            }
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/* Driver --------------------------------------------------------------------*/
+
+/**
+  * @brief  Encode BENCH_CHECK_ROUNDS random inputs and verify each one
+  * @retval Number of failed rounds
+  */
+static uint32_t bench_check(bench_enc_t enc, bench_shape_t shape)
+{
+    static bench_input_t in;
+    static uint8_t out[BENCH_OUT_SIZE];
+    static uint8_t ref[BENCH_OUT_SIZE];
+    uint32_t failed = 0;
+
+    for (uint32_t r = 0; r < BENCH_CHECK_ROUNDS; r++) {
+        bench_make_input(&in, shape, (r & 1U) != 0);
+        int len = bench_encode(enc, &in, out, sizeof(out));
+        int ok = (len > 0);
+
+        if (ok && enc == ENC_BINARY) {
+            ok = (bench_check_binary(&in, out, len) == 0);
+        } else if (ok) {
+            ok = (bench_check_json(&in, out, len) == 0);
+            // All JSON encoders produce the same document byte for byte
+            if (ok && enc != ENC_BUILDER) {
+                int ref_len = enc_builder(&in, ref, sizeof(ref));
+                ok = (ref_len == len && memcmp(ref, out, (size_t)len) == 0);
+            }
+        }
+        if (!ok) {
+            if (failed == 0) {
+                fprintf(stderr, "%s/%s: round %u failed (len %d)\n",
+                        enc_names[enc], shape_names[shape], r, len);
+            }
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/**
+  * @brief  Time encode calls over a fixed set of inputs
+  * @param  bytes: Receives the mean output size
+  * @retval Mean ns per call
+  */
+static double bench_time(bench_enc_t enc, bench_shape_t shape, double *bytes)
+{
+    enum { INPUTS = 16 };
+    static bench_input_t in[INPUTS];
+    static uint8_t out[BENCH_OUT_SIZE];
+    uint64_t calls = 0, total = 0, t0, elapsed;
+    volatile int sink = 0;
+
+    rng_state = 0x9E3779B9U; // Same inputs for every encoder
+    for (int k = 0; k < INPUTS; k++) {
+        bench_make_input(&in[k], shape, 0);
+    }
+
+    // Warm-up, then batches of INPUTS calls until the window is full
+    for (int k = 0; k < INPUTS; k++) {
+        sink += bench_encode(enc, &in[k], out, sizeof(out));
+    }
+    t0 = now_ns();
+    do {
+        for (int k = 0; k < INPUTS; k++) {
+            int len = bench_encode(enc, &in[k], out, sizeof(out));
+            total += (uint64_t)len;
+            sink += out[0];
+        }
+        calls += INPUTS;
+        elapsed = now_ns() - t0;
+    } while (elapsed < cfg.min_ns);
+
+    (void)sink;
+    *bytes = (double)total / (double)calls;
+    return (double)elapsed / (double)calls;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "usage: %s [-t ms] [-j]\n"
+        "  -t  timing window per encoder/shape (default %llu ms)\n"
+        "  -j  one JSON object per case on stdout instead of the table\n",
+        argv0, (unsigned long long)(BENCH_MIN_NS / 1000000ULL));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t failed_total = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:jh")) != -1) {
+        switch (opt) {
+        case 't': cfg.min_ns = strtoull(optarg, NULL, 0) * 1000000ULL; break;
+        case 'j': cfg.json = 1; break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    json_template_init(&tpl_ch16);
+    json_template_add(&tpl_ch16, "t", JSON_SLOT_UINT);
+    for (uint8_t c = 0; c < BENCH_MAX_CHANNELS; c++) {
+        json_template_add(&tpl_ch16, ch_keys[c], JSON_SLOT_INT);
+    }
+    if (json_template_end(&tpl_ch16) != 0) {
+        fprintf(stderr, "ch16 template does not fit; check JSON_TEMPLATE_* in the Makefile\n");
+        return 2;
+    }
+
+    uint32_t fixed_cases;
+    uint32_t fixed_failed = bench_check_fixed(&fixed_cases);
+    failed_total += fixed_failed;
+    if (cfg.json) {
+        printf("{\"check\":\"fixed\",\"cases\":%u,\"failed\":%u}\n",
+               fixed_cases, fixed_failed);
+    } else {
+        printf("fixed-point: %u cases %s\n\n", fixed_cases, fixed_failed ? "FAIL" : "ok");
+        printf("%-8s %-9s %10s %10s %10s %7s\n",
+               "shape", "encoder", "ns/msg", "ns/record", "bytes/msg", "check");
+    }
+    for (int s = 0; s < SHAPE_COUNT; s++) {
+        for (int e = 0; e < ENC_COUNT; e++) {
+            double bytes;
+            uint32_t failed = bench_check((bench_enc_t)e, (bench_shape_t)s);
+            double ns = bench_time((bench_enc_t)e, (bench_shape_t)s, &bytes);
+
+            failed_total += failed;
+            if (cfg.json) {
+                printf("{\"shape\":\"%s\",\"encoder\":\"%s\",\"records\":%u,\"channels\":%u,"
+                       "\"ns_per_msg\":%.1f,\"ns_per_record\":%.1f,\"bytes_per_msg\":%.1f,"
+                       "\"check_rounds\":%u,\"check_failed\":%u}\n",
+                       shape_names[s], enc_names[e], shape_samples[s], shape_channels[s],
+                       ns, ns / shape_samples[s], bytes, BENCH_CHECK_ROUNDS, failed);
+            } else {
+                printf("%-8s %-9s %10.1f %10.1f %10.1f %7s\n",
+                       shape_names[s], enc_names[e], ns, ns / shape_samples[s], bytes,
+                       failed ? "FAIL" : "ok");
+            }
+        }
+    }
+    return failed_total ? 1 : 0;
+}
@@ -15,11 +15,17 @@ const els = {
 };
 
 let chart;
-let cumulativeEnergy = 0; // Energy in mWh
-let lastUpdateTime = null;
 
-const maxPoints = 120; // ~60s if we refresh every 500ms
-const UPDATE_INTERVAL_MS = 500; // Update every 500ms
+const CHART_WINDOW_MS = 60000; // chart shows the last 60 s
+// Board to show (index.html?device=<id>); the server's primary device if unset
+const DEVICE = new URLSearchParams(location.search).get("device");
+const DEVICE_QUERY = DEVICE ? `?device=${encodeURIComponent(DEVICE)}` : "";
+
+const POLL_INTERVAL_MS = 500; // fallback polling of /status (2 Hz)
+const STREAM_RETRY_MS = 30000; // retry /stream this long after it failed
+
+let chartTimes = []; // update time (ms) of each chart point
+let pollTimer = null;
 
 // === notifications / vibration for alerts ===
 
@@ -63,7 +69,7 @@ function initChart() {
           yAxisID: 'y',
         },
         {
-          label: "Cumulative Energy (mWh)",
+          label: "Energy Today (mWh)",
           data: [],
           tension: 0.25,
           borderColor: "#f59e0b",
@@ -130,78 +136,76 @@ function toast(msg) {
   setTimeout(() => els.toast.classList.remove("show"), 1500);
 }
 
+// === rendering ===
+
+function renderStatus(j) {
+  // Totals (in mW)
+  const totals = j.totals || { total_power: 0, energy_today_kWh: 0 };
+  const totalPower = totals.total_power ?? 0; // Already in mW
+  const energyToday = totals.energy_today_kWh ?? 0;
+  els.totalPower.textContent = `${Math.round(totalPower)} mW`;
+  els.energyToday.textContent = energyToday.toFixed(3);
+
+  // Per-load data
+  const loads = j.loads || {};
+  const fanA = loads.fanA || {};
+  const fanB = loads.fanB || {};
+  const fanControl = j.fan || {};
+
+  // Fan A (in mW)
+  const fanAPower = fanA.power ?? 0;
+  els.fanAPower.textContent = `${Math.round(fanAPower)} mW`;
+  els.fanAState.textContent = fanA.state || "OFF";
+
+  // Fan B (in mW)
+  const fanBPower = fanB.power ?? 0;
+  els.fanBPower.textContent = `${Math.round(fanBPower)} mW`;
+  els.fanBState.textContent = fanB.state || "OFF";
+
+  // Fan Control State (overall - when both cross threshold)
+  const fanControlState = fanControl.state || "OFF";
+  els.fanControlState.textContent = fanControlState;
+
+  // Alert bar + notification
+  if (j.alert && j.alert.active) {
+    const msg = j.alert.message || "Alert";
+    const wasHidden = els.alertBar.classList.contains("hidden");
+    els.alertBar.textContent = msg;
+    els.alertBar.classList.remove("hidden");
+    if (wasHidden) {
+      ensureNotifyPermission().then((ok) => {
+        if (ok) notifyAlert("Energy Alert", msg);
+      });
+    }
+  } else {
+    els.alertBar.classList.add("hidden");
+  }
+
+  // Chart update (energy is integrated by the server from device timestamps)
+  const now = Date.now();
+  chart.data.labels.push("");
+  chart.data.datasets[0].data.push(totalPower); // Power in mW
+  chart.data.datasets[1].data.push(energyToday * 1e6); // Energy in mWh
+  chartTimes.push(now);
+
+  while (chartTimes[0] < now - CHART_WINDOW_MS) {
+    chartTimes.shift();
+    chart.data.labels.shift();
+    chart.data.datasets[0].data.shift();
+    chart.data.datasets[1].data.shift();
+  }
+  chart.update();
+}
+
 // === API calls ===
 
 async function fetchStatus() {
   try {
-    const res = await fetch(`${BASE_URL}/status`, { cache: "no-store" });
+    const res = await fetch(`${BASE_URL}/status${DEVICE_QUERY}`, { cache: "no-cache" }); // revalidates by ETag
     if (!res.ok) throw new Error(res.statusText);
     const j = await res.json();
     setOnline(true);
-
-    // Totals (in mW)
-    const totals = j.totals || { total_power: 0, energy_today_kWh: 0 };
-    const totalPower = totals.total_power ?? 0; // Already in mW
-    const energyToday = totals.energy_today_kWh ?? 0;
-    els.totalPower.textContent = `${Math.round(totalPower)} mW`;
-    els.energyToday.textContent = energyToday.toFixed(3);
-
-    // Per-load data
-    const loads = j.loads || {};
-    const fanA = loads.fanA || {};
-    const fanB = loads.fanB || {};
-    const fanControl = j.fan || {};
-
-    // Fan A (in mW)
-    const fanAPower = fanA.power ?? 0;
-    els.fanAPower.textContent = `${Math.round(fanAPower)} mW`;
-    els.fanAState.textContent = fanA.state || "OFF";
-
-    // Fan B (in mW)
-    const fanBPower = fanB.power ?? 0;
-    els.fanBPower.textContent = `${Math.round(fanBPower)} mW`;
-    els.fanBState.textContent = fanB.state || "OFF";
-
-    // Fan Control State (overall - when both cross threshold)
-    const fanControlState = fanControl.state || "OFF";
-    els.fanControlState.textContent = fanControlState;
-
-    // Alert bar + notification
-    if (j.alert && j.alert.active) {
-      const msg = j.alert.message || "Alert";
-      const wasHidden = els.alertBar.classList.contains("hidden");
-      els.alertBar.textContent = msg;
-      els.alertBar.classList.remove("hidden");
-      if (wasHidden) {
-        ensureNotifyPermission().then((ok) => {
-          if (ok) notifyAlert("Energy Alert", msg);
-        });
-      }
-    } else {
-      els.alertBar.classList.add("hidden");
-    }
-
-    // Calculate energy (integral of power over time)
-    const now = Date.now();
-    if (lastUpdateTime !== null) {
-      // Time delta in hours (500ms = 0.0001389 hours)
-      const timeDeltaHours = UPDATE_INTERVAL_MS / (1000 * 60 * 60);
-      // Energy = Power * Time (in mWh)
-      cumulativeEnergy += totalPower * timeDeltaHours;
-    }
-    lastUpdateTime = now;
-
-    // Chart update
-    chart.data.labels.push("");
-    chart.data.datasets[0].data.push(totalPower); // Power in mW
-    chart.data.datasets[1].data.push(cumulativeEnergy); // Energy in mWh
-    
-    if (chart.data.labels.length > maxPoints) {
-      chart.data.labels.shift();
-      chart.data.datasets[0].data.shift();
-      chart.data.datasets[1].data.shift();
-    }
-    chart.update();
+    renderStatus(j);
   } catch (err) {
     setOnline(false);
     // Optional: show offline message
@@ -225,12 +229,55 @@ async function postControl(body) {
   }
 }
 
+// === live updates ===
+// The server pushes status over Server-Sent Events (/stream) when telemetry
+// arrives. Without EventSource, or while the stream is down, poll /status.
+
+function startPolling() {
+  if (pollTimer !== null) return;
+  fetchStatus();
+  pollTimer = setInterval(fetchStatus, POLL_INTERVAL_MS);
+}
+
+function stopPolling() {
+  clearInterval(pollTimer);
+  pollTimer = null;
+}
+
+function connectStream() {
+  if (!("EventSource" in window)) {
+    startPolling();
+    return;
+  }
+
+  const es = new EventSource(`${BASE_URL}/stream${DEVICE_QUERY}`);
+  let opened = false;
+
+  es.onopen = () => {
+    opened = true;
+    stopPolling();
+  };
+  es.addEventListener("status", (e) => {
+    setOnline(true);
+    renderStatus(JSON.parse(e.data));
+  });
+  es.onerror = () => {
+    startPolling();
+    if (!opened || es.readyState === EventSource.CLOSED) {
+      // Never got through (no /stream on the server, a buffering proxy):
+      // stay on polling and try the stream again later
+      es.close();
+      setTimeout(connectStream, STREAM_RETRY_MS);
+    }
+    // Otherwise the browser reconnects on its own; onopen stops polling
+  };
+}
+
 // === event handlers ===
 // (No settings controls needed - STM32 handles its own thresholds)
 
 // === boot ===
 
 initChart();
-fetchStatus();
-setInterval(fetchStatus, 500); // 2 Hz UI updates
+connectStream();
 
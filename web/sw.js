@@ -2,7 +2,7 @@
 // Service worker for PWA functionality
 // Caches the UI shell; keeps API calls live over the network.
 
-const CACHE_NAME = "energy-ui-v1";
+const CACHE_NAME = "energy-ui-v2";
 
 const ASSETS = [
   "/",
@@ -37,6 +37,9 @@ self.addEventListener("activate", (event) => {
 
 self.addEventListener("fetch", (event) => {
   const url = new URL(event.request.url);
+  // Live event stream: leave it to the browser, never cache
+  if (url.pathname.startsWith("/stream")) return;
+
   // API endpoints: always try network first
   if (
     url.pathname.startsWith("/status") ||